@@ -0,0 +1,453 @@
+from __future__ import annotations
+
+import base64
+import gzip
+import hashlib
+import tempfile
+import unittest
+from pathlib import Path
+from unittest.mock import patch
+
+import msgpack
+from flask import Flask
+
+from zen_backend.devices import events
+from zen_backend.devices.delta import DeviceStateHistory, build_state_delta
+from zen_backend.devices.firmware import FirmwareCatalog, parse_version
+from zen_backend.devices.snapshot_cache import OwnerSnapshotCache
+from zen_backend.devices.routes import devices_bp
+from zen_backend.devices.service import (
+    DEVICE_STATE_DELTA_SCHEMA_VERSION,
+    DEVICE_STATE_SCHEMA_VERSION,
+    DeviceRecord,
+    DEFAULT_DEVICE_MODEL,
+    build_compact_delta,
+    build_compact_state,
+    build_device_view,
+    compute_state_etag,
+    device_endpoints,
+    posix_timezone,
+    sanitize_device_perf,
+)
+
+
+def _record() -> DeviceRecord:
+    return DeviceRecord(
+        id="device123",
+        hardware_id="aa:bb",
+        owner_uid="user123",
+        status="active",
+        bluetooth_name="ZenDisplay-0123",
+        firmware_version="0.2.0",
+        device_secret_hash="",
+        pairing_token_hash=None,
+        pairing_token_expires_at=None,
+        last_seen_at=None,
+        created_at=None,
+        updated_at=None,
+    )
+
+
+STATE = {
+    "calendar": {"connected": True, "items": [{"id": "e1", "summary": "Standup", "start": "2026-01-08T09:00:00+01:00"}]},
+    "email": {"connected": True, "items": []},
+}
+
+DEVICE_HEADERS = {"X-Device-Id": "device123", "X-Device-Secret": "secret"}
+
+
+class DeviceStateApiTestCase(unittest.TestCase):
+    def setUp(self) -> None:
+        app = Flask(__name__)
+        app.config["TESTING"] = True
+        app.register_blueprint(devices_bp)
+        self.client = app.test_client()
+        self.auth_patcher = patch("zen_backend.devices.routes.authenticate_device", return_value=_record())
+        self.auth_patcher.start()
+        self.state_patcher = patch("zen_backend.devices.routes.get_device_state", return_value=build_device_view(STATE))
+        self.state_patcher.start()
+        self.history_patcher = patch("zen_backend.devices.routes.get_state_history", return_value=DeviceStateHistory())
+        self.history_patcher.start()
+
+    def tearDown(self) -> None:
+        self.history_patcher.stop()
+        self.state_patcher.stop()
+        self.auth_patcher.stop()
+
+    def test_etag_is_stable_for_equal_content(self) -> None:
+        reordered = {"email": STATE["email"], "calendar": STATE["calendar"]}
+        self.assertEqual(compute_state_etag(STATE), compute_state_etag(reordered))
+        changed = {"calendar": {"connected": False, "items": []}, "email": STATE["email"]}
+        self.assertNotEqual(compute_state_etag(STATE), compute_state_etag(changed))
+
+    def test_state_returns_etag(self) -> None:
+        response = self.client.get("/devices/state", headers=DEVICE_HEADERS)
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.get_json(), STATE)
+        self.assertEqual(response.headers["ETag"], f'"{compute_state_etag(STATE)}"')
+
+    def test_matching_if_none_match_returns_304(self) -> None:
+        etag = self.client.get("/devices/state", headers=DEVICE_HEADERS).headers["ETag"]
+        response = self.client.get("/devices/state", headers={**DEVICE_HEADERS, "If-None-Match": etag})
+        self.assertEqual(response.status_code, 304)
+        self.assertEqual(response.data, b"")
+        self.assertEqual(response.headers["ETag"], etag)
+
+    def test_msgpack_is_negotiated_by_accept(self) -> None:
+        headers = {**DEVICE_HEADERS, "Accept": "application/msgpack, application/json;q=0.5"}
+        response = self.client.get("/devices/state", headers=headers)
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.mimetype, "application/msgpack")
+        self.assertIn("Accept", response.headers["Vary"])
+        decoded = msgpack.unpackb(response.data, raw=False)
+        self.assertEqual(decoded, build_compact_state(STATE))
+        self.assertEqual(decoded[0], DEVICE_STATE_SCHEMA_VERSION)
+        self.assertEqual(decoded[1], [True, [["2026-01-08T09:00:00+01:00", "Standup", None, "e1"]]])
+        self.assertNotEqual(response.headers["ETag"], f'"{compute_state_etag(STATE)}"')
+
+        repeat = self.client.get("/devices/state", headers={**headers, "If-None-Match": response.headers["ETag"]})
+        self.assertEqual(repeat.status_code, 304)
+
+    def test_stale_if_none_match_returns_full_state(self) -> None:
+        response = self.client.get("/devices/state", headers={**DEVICE_HEADERS, "If-None-Match": '"stale"'})
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.get_json(), STATE)
+
+    def test_since_known_version_returns_delta(self) -> None:
+        version = self.client.get("/devices/state", headers=DEVICE_HEADERS).headers["ETag"].strip('"')
+        updated = {
+            "calendar": {
+                "connected": True,
+                "items": [
+                    {"id": "e1", "summary": "Standup", "start": "2026-01-08T09:00:00+01:00"},
+                    {"id": "e2", "summary": "Review", "start": "2026-01-08T11:00:00+01:00"},
+                ],
+            },
+            "email": {"connected": True, "items": []},
+        }
+        self.state_patcher.stop()
+        self.state_patcher = patch("zen_backend.devices.routes.get_device_state", return_value=build_device_view(updated))
+        self.state_patcher.start()
+
+        response = self.client.get(f"/devices/state?since={version}", headers=DEVICE_HEADERS)
+        self.assertEqual(response.status_code, 200)
+        body = response.get_json()
+        self.assertEqual(body["base"], version)
+        self.assertEqual(body["calendar"]["changed"], [updated["calendar"]["items"][1]])
+        self.assertEqual(body["calendar"]["removed"], [])
+        self.assertEqual(body["calendar"]["order"], ["e1", "e2"])
+        self.assertEqual(body["email"], {"connected": True, "changed": [], "removed": [], "order": []})
+        self.assertEqual(response.headers["ETag"], f'"{compute_state_etag(updated)}"')
+
+    def test_since_unknown_version_returns_full_state(self) -> None:
+        response = self.client.get("/devices/state?since=unknown", headers=DEVICE_HEADERS)
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.get_json(), STATE)
+
+    def test_msgpack_delta_uses_compact_schema(self) -> None:
+        headers = {**DEVICE_HEADERS, "Accept": "application/msgpack"}
+        etag = self.client.get("/devices/state", headers=headers).headers["ETag"].strip('"')
+        self.state_patcher.stop()
+        self.state_patcher = patch(
+            "zen_backend.devices.routes.get_device_state",
+            return_value=build_device_view({"calendar": {"connected": True, "items": []}, "email": STATE["email"]}),
+        )
+        self.state_patcher.start()
+
+        response = self.client.get(f"/devices/state?since={etag}", headers=headers)
+        decoded = msgpack.unpackb(response.data, raw=False)
+        self.assertEqual(decoded, [DEVICE_STATE_DELTA_SCHEMA_VERSION, etag, [True, [], ["e1"], []], [True, [], [], []]])
+
+    def test_delta_requires_item_ids(self) -> None:
+        anonymous = {"calendar": {"connected": True, "items": [{"summary": "No id"}]}, "email": STATE["email"]}
+        self.assertIsNone(build_state_delta(STATE, anonymous))
+
+    def test_timezone_is_appended_to_compact_schemas(self) -> None:
+        zoned = {**STATE, "timezone": {"name": "Europe/Berlin", "posix": "CET-1CEST,M3.5.0,M10.5.0/3"}}
+        self.assertEqual(build_compact_state(zoned)[-1], "CET-1CEST,M3.5.0,M10.5.0/3")
+        self.assertEqual(len(build_compact_state(STATE)), 3)
+        delta = build_state_delta(STATE, zoned)
+        self.assertEqual(delta["timezone"], zoned["timezone"])
+        self.assertEqual(build_compact_delta({**delta, "base": "v1"})[-1], "CET-1CEST,M3.5.0,M10.5.0/3")
+
+    def test_posix_timezone_rejects_unknown_zones(self) -> None:
+        self.assertIsNone(posix_timezone(None))
+        self.assertIsNone(posix_timezone("Nowhere/Invalid"))
+        self.assertIsNone(posix_timezone("../etc/passwd"))
+
+    def test_device_view_fits_model_limits(self) -> None:
+        events = [{"id": f"e{i}", "summary": "\u00e9" * 60, "start": "2026-01-08T09:00:00+01:00"} for i in range(20)]
+        state = {"calendar": {"connected": True, "items": events}, "email": STATE["email"]}
+        view = build_device_view(state, "unknown-model")
+        items = view.state["calendar"]["items"]
+        self.assertEqual(len(items), 16)
+        self.assertEqual(items[0]["summary"], "\u00e9" * 44)
+        self.assertEqual(view.compact, build_compact_state(view.state))
+        self.assertEqual(view.etag, compute_state_etag(view.state))
+        self.assertEqual(len(state["calendar"]["items"]), 20)
+        self.assertIs(build_device_view(STATE, DEFAULT_DEVICE_MODEL).state, STATE)
+
+    def test_history_keeps_recent_versions_per_device(self) -> None:
+        history = DeviceStateHistory(per_device=2, max_devices=1)
+        history.remember("d1", "v1", STATE)
+        history.remember("d1", "v2", STATE)
+        history.remember("d1", "v3", STATE)
+        self.assertIsNone(history.lookup("d1", "v1"))
+        self.assertEqual(history.lookup("d1", "v3"), STATE)
+        history.remember("d2", "v1", STATE)
+        self.assertIsNone(history.lookup("d1", "v3"))
+
+
+class OwnerSnapshotCacheTestCase(unittest.TestCase):
+    def setUp(self) -> None:
+        self.hub = events.DeviceEventHub()
+        self.now = 0.0
+        self.cache = OwnerSnapshotCache(hub=self.hub, ttl_seconds=60, error_ttl_seconds=5, clock=lambda: self.now)
+        self.builds = 0
+
+    def _build(self) -> dict:
+        self.builds += 1
+        return {"calendar": {"connected": True, "items": []}, "email": {"connected": True, "items": []}}
+
+    def test_repeated_polls_build_once(self) -> None:
+        first = self.cache.get("user123", self._build)
+        self.assertIs(self.cache.get("user123", self._build), first)
+        self.assertEqual(self.builds, 1)
+
+    def test_owner_change_invalidates(self) -> None:
+        self.cache.get("user123", self._build)
+        self.hub.notify("user456")
+        self.cache.get("user123", self._build)
+        self.assertEqual(self.builds, 1)
+        self.hub.notify("user123")
+        self.cache.get("user123", self._build)
+        self.assertEqual(self.builds, 2)
+
+    def test_entries_expire(self) -> None:
+        self.cache.get("user123", self._build)
+        self.now = 61.0
+        self.cache.get("user123", self._build)
+        self.assertEqual(self.builds, 2)
+
+    def test_views_are_derived_once_per_snapshot(self) -> None:
+        derived = []
+
+        def derive(state: dict) -> dict:
+            derived.append(state)
+            return {"view": state}
+
+        first = self.cache.get_view("user123", "zen-290", self._build, derive)
+        self.assertIs(self.cache.get_view("user123", "zen-290", self._build, derive), first)
+        self.cache.get_view("user123", "other", self._build, derive)
+        self.assertEqual((self.builds, len(derived)), (1, 2))
+        self.hub.notify("user123")
+        self.cache.get_view("user123", "zen-290", self._build, derive)
+        self.assertEqual((self.builds, len(derived)), (2, 3))
+
+    def test_failed_builds_expire_sooner(self) -> None:
+        def failing() -> dict:
+            return {"calendar": {"connected": False, "error": "quota"}, "email": {"connected": True, "items": []}}
+
+        self.cache.get("user123", failing)
+        self.now = 6.0
+        self.cache.get("user123", self._build)
+        self.assertEqual(self.builds, 1)
+
+
+class DeviceEventsTestCase(unittest.TestCase):
+    def setUp(self) -> None:
+        self.hub = events.DeviceEventHub()
+        self.coalesce_patcher = patch.object(events, "PUSH_COALESCE_SECONDS", 0)
+        self.coalesce_patcher.start()
+        self.keepalive_patcher = patch.object(events, "PUSH_KEEPALIVE_SECONDS", 0.01)
+        self.keepalive_patcher.start()
+
+    def tearDown(self) -> None:
+        self.keepalive_patcher.stop()
+        self.coalesce_patcher.stop()
+
+    def test_wait_returns_after_notify(self) -> None:
+        self.hub.notify("user123")
+        self.assertEqual(self.hub.wait("user123", 0, timeout=0.01), 1)
+        self.assertEqual(self.hub.wait("other", 0, timeout=0.01), 0)
+
+    def test_stream_coalesces_burst_into_one_event(self) -> None:
+        stream = events.stream_owner_events("user123", hub=self.hub)
+        self.assertEqual(next(stream), ": connected\n\n")
+        self.assertEqual(next(stream), ": keepalive\n\n")
+        for _ in range(3):
+            self.hub.notify("user123")
+        self.assertEqual(next(stream), "event: state\ndata: 3\n\n")
+        self.assertEqual(next(stream), ": keepalive\n\n")
+
+    def test_events_route_rejects_unclaimed_device(self) -> None:
+        app = Flask(__name__)
+        app.register_blueprint(devices_bp)
+        unclaimed = _record()
+        unclaimed.owner_uid = None
+        with patch("zen_backend.devices.routes.authenticate_device", return_value=unclaimed):
+            response = app.test_client().get("/devices/events", headers=DEVICE_HEADERS)
+        self.assertEqual(response.status_code, 409)
+
+
+REGISTRATION = {
+    "deviceId": "device123",
+    "deviceSecret": "secret",
+    "pairingToken": "token",
+    "bluetoothName": "ZenDisplay-0123",
+    "status": "pending",
+}
+
+
+class DeviceRegistrationTestCase(unittest.TestCase):
+    def _register(self, endpoints):
+        app = Flask(__name__)
+        app.config["DEVICE_ENDPOINTS"] = endpoints
+        app.register_blueprint(devices_bp)
+        with patch("zen_backend.devices.routes.register_device", return_value=dict(REGISTRATION)):
+            return app.test_client().post("/devices/register", json={"hardwareId": "aa:bb", "model": "zen-290"})
+
+    def test_registration_lists_configured_endpoints(self) -> None:
+        response = self._register(("https://eu.example.com", "https://us.example.com/"))
+        self.assertEqual(response.status_code, 201)
+        self.assertEqual(response.get_json()["endpoints"], ["https://eu.example.com", "https://us.example.com"])
+
+    def test_registration_without_endpoints_omits_the_list(self) -> None:
+        response = self._register(())
+        self.assertEqual(response.status_code, 201)
+        self.assertNotIn("endpoints", response.get_json())
+
+    def test_endpoints_are_limited_to_what_displays_accept(self) -> None:
+        configured = [
+            "http://plain.example.com",
+            "https://a.example.com",
+            "https://a.example.com/",
+            "https://" + "x" * 120 + ".com",
+            "https://b.example.com",
+            "https://c.example.com",
+            "https://d.example.com",
+            "https://e.example.com",
+        ]
+        self.assertEqual(
+            device_endpoints(configured),
+            ["https://a.example.com", "https://b.example.com", "https://c.example.com", "https://d.example.com"],
+        )
+        self.assertEqual(device_endpoints("https://only.example.com"), ["https://only.example.com"])
+        self.assertEqual(device_endpoints(None), [])
+
+
+PERF_REPORT = {
+    "windowMs": 60000,
+    "heap": {"free": 120000, "minFree": 90000, "largestBlock": 65536},
+    "timings": {
+        "httpGet": {"count": 2, "totalMs": 840, "maxMs": 500, "buckets": [0] * 9 + [2, 0, 0]},
+    },
+}
+
+
+class DeviceHeartbeatTestCase(unittest.TestCase):
+    def test_heartbeat_forwards_perf_report(self) -> None:
+        app = Flask(__name__)
+        app.register_blueprint(devices_bp)
+        payload = {"wifiRssi": -60, "firmwareVersion": "0.2.0", "model": "zen-290", "perf": PERF_REPORT}
+        with patch("zen_backend.devices.routes.authenticate_device", return_value=_record()), patch(
+            "zen_backend.devices.routes.update_device_presence"
+        ) as update:
+            response = app.test_client().post("/devices/heartbeat", json=payload, headers=DEVICE_HEADERS)
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(update.call_args.kwargs["perf"], PERF_REPORT)
+        self.assertEqual(update.call_args.kwargs["rssi"], -60)
+        self.assertEqual(update.call_args.kwargs["model"], "zen-290")
+
+    def test_sanitize_keeps_known_fields(self) -> None:
+        self.assertEqual(sanitize_device_perf(PERF_REPORT), PERF_REPORT)
+
+    def test_sanitize_drops_unknown_and_malformed_values(self) -> None:
+        report = {
+            "windowMs": -5,
+            "heap": {"free": "lots", "minFree": 1000, "extra": 1},
+            "timings": {
+                "httpGet": {"count": 1, "totalMs": 10, "maxMs": True, "buckets": [1, "x"]},
+                "stateParse": {"count": 0, "totalMs": 0},
+                "bogus": {"count": 3},
+            },
+            "arbitrary": {"nested": "data"},
+        }
+        self.assertEqual(
+            sanitize_device_perf(report),
+            {"heap": {"minFree": 1000}, "timings": {"httpGet": {"count": 1, "totalMs": 10}}},
+        )
+        self.assertIsNone(sanitize_device_perf({"timings": {}}))
+        self.assertIsNone(sanitize_device_perf("not-a-dict"))
+
+
+IMAGE = bytes(range(256)) * 64
+SIGNATURE = b"0E\x02\x21signature"
+
+
+class DeviceFirmwareTestCase(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp = tempfile.TemporaryDirectory()
+        self.directory = Path(self.tmp.name)
+        (self.directory / "zen-290-0.2.0.bin").write_bytes(b"old")
+        (self.directory / "zen-290-0.10.0.bin.gz").write_bytes(gzip.compress(IMAGE))
+        (self.directory / "zen-290-0.3.0.bin").write_bytes(b"older than 0.10")
+        # Unsigned, so never offered
+        (self.directory / "zen-290-0.11.0.bin").write_bytes(b"unsigned")
+        for name in ("zen-290-0.2.0.bin", "zen-290-0.10.0.bin.gz", "zen-290-0.3.0.bin"):
+            (self.directory / f"{name}.sig").write_bytes(SIGNATURE)
+        (self.directory / "notes.txt").write_text("ignored")
+        self.catalog = FirmwareCatalog(self.directory)
+        app = Flask(__name__)
+        app.register_blueprint(devices_bp)
+        self.client = app.test_client()
+
+    def tearDown(self) -> None:
+        self.tmp.cleanup()
+
+    def test_versions_compare_numerically(self) -> None:
+        self.assertLess(parse_version("0.9.1"), parse_version("0.10.0"))
+        self.assertEqual(parse_version("1.2"), parse_version("1.2.0"))
+        self.assertIsNone(parse_version("dev-build"))
+        self.assertIsNone(parse_version(None))
+
+    def test_offer_picks_newest_build_for_model(self) -> None:
+        build = self.catalog.offer("zen-290", "0.2.0")
+        self.assertEqual(build.version, "0.10.0")
+        self.assertEqual(build.encoding, "gzip")
+        self.assertEqual(build.image_size, len(IMAGE))
+        self.assertEqual(build.image_sha256, hashlib.sha256(IMAGE).hexdigest())
+        self.assertEqual(build.signature, base64.b64encode(SIGNATURE).decode("ascii"))
+        self.assertIsNone(self.catalog.offer("zen-290", "0.10.0"))
+        self.assertIsNone(self.catalog.offer("zen-290", "unknown"))
+        self.assertIsNone(self.catalog.offer("zen-420", "0.1.0"))
+
+    def test_heartbeat_advertises_newer_build(self) -> None:
+        with patch("zen_backend.devices.routes.authenticate_device", return_value=_record()), patch(
+            "zen_backend.devices.routes.update_device_presence"
+        ), patch("zen_backend.devices.routes.get_firmware_catalog", return_value=self.catalog):
+            response = self.client.post("/devices/heartbeat", json={"firmwareVersion": "0.2.0"}, headers=DEVICE_HEADERS)
+            current = self.client.post("/devices/heartbeat", json={"firmwareVersion": "0.10.0"}, headers=DEVICE_HEADERS)
+        firmware = response.get_json()["firmware"]
+        self.assertEqual(firmware["version"], "0.10.0")
+        self.assertEqual(firmware["path"], "/devices/firmware/0.10.0")
+        self.assertEqual(firmware["imageSize"], len(IMAGE))
+        self.assertEqual(firmware["signature"], base64.b64encode(SIGNATURE).decode("ascii"))
+        self.assertEqual(current.get_json(), {"status": "ok"})
+
+    def test_firmware_download_sends_stored_file(self) -> None:
+        with patch("zen_backend.devices.routes.authenticate_device", return_value=_record()), patch(
+            "zen_backend.devices.routes.get_firmware_catalog", return_value=self.catalog
+        ):
+            response = self.client.get("/devices/firmware/0.10.0", headers=DEVICE_HEADERS)
+            missing = self.client.get("/devices/firmware/9.9.9", headers=DEVICE_HEADERS)
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(gzip.decompress(response.data), IMAGE)
+        self.assertEqual(response.headers["X-Firmware-Encoding"], "gzip")
+        self.assertEqual(response.headers["X-Firmware-Sha256"], hashlib.sha256(IMAGE).hexdigest())
+        response.close()
+        self.assertEqual(missing.status_code, 404)
+
+
+if __name__ == "__main__":  # pragma: no cover
+    unittest.main()
@@ -102,6 +102,8 @@ def create_app(config: AppConfig | None = None) -> Flask:
         AI_PROVIDER=config.ai_provider,
         AI_SERVER_URL=config.ai_server_url,
         AI_API_KEY=config.ai_api_key,
+        FIRMWARE_DIR=str(config.firmware_dir) if config.firmware_dir else None,
+        DEVICE_ENDPOINTS=config.device_endpoints,
     )
 
     # Configure CORS with regex origins for dev and prod
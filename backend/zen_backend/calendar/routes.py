@@ -7,6 +7,7 @@ from typing import Any
 from flask import Blueprint, current_app, jsonify, request
 
 from ..auth.utils import AuthError, require_firebase_user
+from ..devices.events import notify_owner_changed
 from .service import (
     CalendarError,
     GoogleCalendarConfig,
@@ -94,6 +95,7 @@ def exchange_google_code():
         redirect_uri=redirect_uri,
         code_verifier=code_verifier,
     )
+    notify_owner_changed(auth_ctx.uid, "calendar_connection")
     return jsonify(_serialize_connection(record)), HTTPStatus.OK
 
 
@@ -112,6 +114,7 @@ def delete_google_connection():
     auth_ctx = require_firebase_user()
     service = _build_service()
     service.revoke_connection(auth_ctx.uid)
+    notify_owner_changed(auth_ctx.uid, "calendar_connection")
     return ("", HTTPStatus.NO_CONTENT)
 
 
@@ -161,6 +164,7 @@ def create_calendar_event():
 
     service = _build_service()
     created = service.create_event(auth_ctx.uid, event=event_payload, calendar_id=calendar_id)
+    notify_owner_changed(auth_ctx.uid, "calendar")
     return jsonify(created), HTTPStatus.CREATED
 
 
@@ -171,4 +175,5 @@ def delete_calendar_event(event_id: str):
     calendar_id = request.args.get("calendarId", "primary")
     service = _build_service()
     service.delete_event(auth_ctx.uid, event_id, calendar_id=calendar_id)
+    notify_owner_changed(auth_ctx.uid, "calendar")
     return ("", HTTPStatus.NO_CONTENT)
\ No newline at end of file
@@ -35,6 +35,8 @@ class AppConfig:
     ai_provider: str = "openrouter"  # "openrouter" or "hackclub"
     ai_server_url: Optional[str] = None
     ai_api_key: Optional[str] = None
+    firmware_dir: Optional[Path] = None
+    device_endpoints: tuple[str, ...] = ()
 
 
 def _resolve_path(path_str: str, base_dir: Path) -> Path:
@@ -107,6 +109,18 @@ def load_config() -> AppConfig:
 
     uploads_dir.mkdir(parents=True, exist_ok=True)
 
+    # Display firmware builds offered through the heartbeat; may not exist
+    firmware_dir_raw = os.getenv("FIRMWARE_DIR")
+    if firmware_dir_raw:
+        firmware_dir = _resolve_path(firmware_dir_raw, backend_dir)
+    else:
+        firmware_dir = (backend_dir / "firmware").resolve()
+
+    # Base URLs displays may fail over between, handed out at registration
+    device_endpoints = tuple(
+        token.strip() for token in re.split(r"[\s,]+", os.getenv("DEVICE_ENDPOINTS", "")) if token.strip()
+    )
+
     max_inline_attachment_raw = os.getenv("MAX_INLINE_ATTACHMENT_BYTES", "350000")
     try:
         max_inline_attachment_bytes = max(1, int(max_inline_attachment_raw))
@@ -172,4 +186,6 @@ def load_config() -> AppConfig:
         ai_provider=ai_provider,
         ai_server_url=ai_server_url,
         ai_api_key=ai_api_key,
+        firmware_dir=firmware_dir,
+        device_endpoints=device_endpoints,
     )
@@ -0,0 +1,91 @@
+"""Delta sync of device state against a version the device already holds.
+
+Devices pass the ETag of the state they last applied as ``?since=``. The
+backend remembers the last few states it served per device, so it can answer
+with only the items that were added, removed or changed instead of the full
+snapshot. Unknown versions (process restart, another worker) simply fall back
+to a full snapshot, so the history is a cache and never a source of truth.
+"""
+
+from __future__ import annotations
+
+from collections import OrderedDict
+from threading import Lock
+from typing import Any, Optional
+
+STATE_HISTORY_PER_DEVICE = 2
+STATE_HISTORY_MAX_DEVICES = 1024
+
+STATE_SECTIONS = ("calendar", "email")
+
+
+class DeviceStateHistory:
+    """Bounded in-process record of the states recently served to each device."""
+
+    def __init__(
+        self,
+        *,
+        per_device: int = STATE_HISTORY_PER_DEVICE,
+        max_devices: int = STATE_HISTORY_MAX_DEVICES,
+    ) -> None:
+        self._per_device = per_device
+        self._max_devices = max_devices
+        self._lock = Lock()
+        self._devices: OrderedDict[str, OrderedDict[str, dict[str, Any]]] = OrderedDict()
+
+    def remember(self, device_id: str, version: str, state: dict[str, Any]) -> None:
+        with self._lock:
+            versions = self._devices.pop(device_id, None) or OrderedDict()
+            versions.pop(version, None)
+            versions[version] = state
+            while len(versions) > self._per_device:
+                versions.popitem(last=False)
+            self._devices[device_id] = versions
+            while len(self._devices) > self._max_devices:
+                self._devices.popitem(last=False)
+
+    def lookup(self, device_id: str, version: str) -> Optional[dict[str, Any]]:
+        with self._lock:
+            versions = self._devices.get(device_id)
+            if not versions:
+                return None
+            return versions.get(version)
+
+
+_history = DeviceStateHistory()
+
+
+def get_state_history() -> DeviceStateHistory:
+    return _history
+
+
+def build_state_delta(base: dict[str, Any], state: dict[str, Any]) -> Optional[dict[str, Any]]:
+    """Return the per-section changes that turn ``base`` into ``state``.
+
+    Each section carries ``changed`` (added or modified items, in full),
+    ``removed`` (ids no longer present) and ``order`` (ids of the resulting
+    list, which is authoritative for membership and order). The owner's
+    ``timezone`` is small and carried whole whenever the state has one.
+    Returns None when an item has no id, since such a list cannot be diffed
+    reliably.
+    """
+
+    delta: dict[str, Any] = {}
+    for section in STATE_SECTIONS:
+        current = state.get(section) or {}
+        previous = base.get(section) or {}
+        items = current.get("items") or []
+        if any(not item.get("id") for item in items):
+            return None
+        previous_by_id = {item["id"]: item for item in previous.get("items") or [] if item.get("id")}
+        order = [item["id"] for item in items]
+        kept = set(order)
+        delta[section] = {
+            "connected": bool(current.get("connected")),
+            "changed": [item for item in items if previous_by_id.get(item["id"]) != item],
+            "removed": [item_id for item_id in previous_by_id if item_id not in kept],
+            "order": order,
+        }
+    if state.get("timezone"):
+        delta["timezone"] = state["timezone"]
+    return delta
@@ -0,0 +1,87 @@
+"""In-process change notifications for the device push channel.
+
+Writers (email analysis, calendar routes) call ``notify_owner_changed`` when
+data shown on a display may have changed. ``/devices/events`` streams wait on
+the per-owner version counter and emit a single coalesced ``state`` event per
+burst. The hub lives in the current process only; devices fall back to
+polling ``/devices/state`` when the stream is unavailable.
+"""
+
+from __future__ import annotations
+
+import logging
+import threading
+import time
+from typing import Iterator
+
+log = logging.getLogger(__name__)
+
+PUSH_KEEPALIVE_SECONDS = 25
+PUSH_COALESCE_SECONDS = 2.0
+PUSH_STREAM_MAX_SECONDS = 600
+
+
+class DeviceEventHub:
+    """Per-owner version counters that push streams block on."""
+
+    def __init__(self) -> None:
+        self._cond = threading.Condition()
+        self._versions: dict[str, int] = {}
+
+    def version(self, owner_uid: str) -> int:
+        with self._cond:
+            return self._versions.get(owner_uid, 0)
+
+    def notify(self, owner_uid: str) -> int:
+        with self._cond:
+            version = self._versions.get(owner_uid, 0) + 1
+            self._versions[owner_uid] = version
+            self._cond.notify_all()
+            return version
+
+    def wait(self, owner_uid: str, since: int, timeout: float) -> int:
+        """Block until the owner's version moves past ``since`` or ``timeout`` elapses."""
+
+        with self._cond:
+            self._cond.wait_for(lambda: self._versions.get(owner_uid, 0) != since, timeout)
+            return self._versions.get(owner_uid, 0)
+
+
+_hub = DeviceEventHub()
+
+
+def get_event_hub() -> DeviceEventHub:
+    return _hub
+
+
+def notify_owner_changed(owner_uid: str | None, reason: str) -> None:
+    """Tell connected displays of ``owner_uid`` that their state may have changed."""
+
+    if not owner_uid:
+        return
+    version = _hub.notify(owner_uid)
+    log.debug("Device state change for %s (%s), version %s", owner_uid, reason, version)
+
+
+def stream_owner_events(owner_uid: str, *, hub: DeviceEventHub | None = None) -> Iterator[str]:
+    """Yield Server-Sent Events for one device stream.
+
+    Emits ``event: state`` once per burst of changes (changes arriving within
+    ``PUSH_COALESCE_SECONDS`` are folded into one event) and a comment line as
+    keep-alive. The stream ends after ``PUSH_STREAM_MAX_SECONDS`` so worker
+    threads are recycled; devices reconnect.
+    """
+
+    hub = hub or _hub
+    version = hub.version(owner_uid)
+    deadline = time.monotonic() + PUSH_STREAM_MAX_SECONDS
+    # Flush headers right away so the device sees the stream is up
+    yield ": connected\n\n"
+    while time.monotonic() < deadline:
+        latest = hub.wait(owner_uid, version, PUSH_KEEPALIVE_SECONDS)
+        if latest == version:
+            yield ": keepalive\n\n"
+            continue
+        time.sleep(PUSH_COALESCE_SECONDS)
+        version = hub.version(owner_uid)
+        yield f"event: state\ndata: {version}\n\n"
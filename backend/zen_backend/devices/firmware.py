@@ -0,0 +1,178 @@
+"""Firmware builds offered to displays through the heartbeat.
+
+Builds are plain files in the firmware directory (``FIRMWARE_DIR``, default
+``backend/firmware``) named ``<model>-<version>.bin`` or, gzip-compressed,
+``<model>-<version>.bin.gz``. A heartbeat whose ``firmwareVersion`` is older
+than the newest build for the display's model gets that build advertised in
+its response; the display then downloads it from ``GET /devices/firmware``
+and inflates it straight into its inactive OTA partition. The advertised
+SHA-256 and size describe the decompressed image, which is what the display
+writes and verifies. Hashes are computed once per file and reused until the
+file changes.
+
+Every build needs a signature next to it, ``<build file>.sig``: the DER
+ECDSA P-256 signature over ``<image sha256 hex>|<version>|<model>`` made
+with the publisher's key, as written by
+
+    printf '%s|%s|%s' "$sha256" 0.3.0 zen-290 | openssl dgst -sha256 -sign ota_signing.pem > zen-290-0.3.0.bin.gz.sig
+
+The display checks it against the public key compiled into its firmware,
+so the backend never holds the private key. Unsigned builds are not
+offered; the display would refuse them.
+"""
+
+from __future__ import annotations
+
+import base64
+import gzip
+import hashlib
+import re
+from dataclasses import dataclass
+from pathlib import Path
+from threading import Lock
+from typing import Any, Optional
+
+from flask import current_app
+
+FIRMWARE_FILE_PATTERN = re.compile(r"^(?P<model>[a-z0-9][a-z0-9-]*?)-(?P<version>\d+(?:\.\d+){0,3})\.bin(?P<gz>\.gz)?$")
+FIRMWARE_MIMETYPE = "application/octet-stream"
+_HASH_CHUNK_BYTES = 64 * 1024
+
+
+def parse_version(value: Any) -> Optional[tuple[int, ...]]:
+    """``"0.2.0"`` -> ``(0, 2, 0)``; None for anything that is not dotted numbers."""
+    if not isinstance(value, str) or not re.fullmatch(r"\d+(?:\.\d+){0,3}", value.strip()):
+        return None
+    parts = tuple(int(part) for part in value.strip().split("."))
+    # "1.2" and "1.2.0" are the same version
+    while len(parts) > 1 and parts[-1] == 0:
+        parts = parts[:-1]
+    return parts
+
+
+@dataclass(frozen=True, slots=True)
+class FirmwareBuild:
+    model: str
+    version: str
+    path: Path
+    encoding: str  # "gzip" or "identity", how the download is sent
+    size: int  # bytes sent
+    image_size: int  # bytes written to the OTA partition
+    image_sha256: str
+    signature: str  # base64 of the .sig file
+
+    def advertisement(self) -> dict[str, Any]:
+        """The ``firmware`` object of a heartbeat response."""
+        return {
+            "version": self.version,
+            "path": f"/devices/firmware/{self.version}",
+            "encoding": self.encoding,
+            "size": self.size,
+            "imageSize": self.image_size,
+            "sha256": self.image_sha256,
+            "signature": self.signature,
+        }
+
+
+def _hash_image(path: Path, compressed: bool) -> tuple[int, str]:
+    digest = hashlib.sha256()
+    size = 0
+    opener = gzip.open if compressed else open
+    with opener(path, "rb") as handle:
+        while chunk := handle.read(_HASH_CHUNK_BYTES):
+            digest.update(chunk)
+            size += len(chunk)
+    return size, digest.hexdigest()
+
+
+class FirmwareCatalog:
+    """Builds found in one directory, rescanned on each lookup."""
+
+    def __init__(self, directory: Path) -> None:
+        self._directory = directory
+        self._lock = Lock()
+        # (path, mtime_ns, size, signature mtime_ns) -> build, so unchanged
+        # files are hashed once
+        self._builds: dict[tuple[str, int, int, int], FirmwareBuild] = {}
+
+    def _scan(self) -> list[FirmwareBuild]:
+        if not self._directory.is_dir():
+            return []
+        builds: list[FirmwareBuild] = []
+        seen: set[tuple[str, int, int, int]] = set()
+        for path in self._directory.iterdir():
+            match = FIRMWARE_FILE_PATTERN.match(path.name)
+            signature_path = path.with_name(path.name + ".sig")
+            if not match or not path.is_file() or not signature_path.is_file():
+                continue
+            stat = path.stat()
+            key = (str(path), stat.st_mtime_ns, stat.st_size, signature_path.stat().st_mtime_ns)
+            seen.add(key)
+            with self._lock:
+                build = self._builds.get(key)
+            if build is None:
+                compressed = match.group("gz") is not None
+                try:
+                    image_size, image_sha256 = _hash_image(path, compressed)
+                    signature = base64.b64encode(signature_path.read_bytes()).decode("ascii")
+                except (OSError, EOFError, gzip.BadGzipFile):
+                    continue
+                build = FirmwareBuild(
+                    model=match.group("model"),
+                    version=match.group("version"),
+                    path=path,
+                    encoding="gzip" if compressed else "identity",
+                    size=stat.st_size,
+                    image_size=image_size,
+                    image_sha256=image_sha256,
+                    signature=signature,
+                )
+                with self._lock:
+                    self._builds[key] = build
+            builds.append(build)
+        with self._lock:
+            for key in list(self._builds):
+                if key not in seen:
+                    del self._builds[key]
+        return builds
+
+    def latest(self, model: str) -> Optional[FirmwareBuild]:
+        candidates = [build for build in self._scan() if build.model == model]
+        if not candidates:
+            return None
+        # A compressed file wins over an uncompressed one of the same version
+        return max(candidates, key=lambda build: (parse_version(build.version), build.encoding == "gzip"))
+
+    def find(self, model: str, version: str) -> Optional[FirmwareBuild]:
+        wanted = parse_version(version)
+        matches = [build for build in self._scan() if build.model == model and parse_version(build.version) == wanted]
+        if not matches:
+            return None
+        return max(matches, key=lambda build: build.encoding == "gzip")
+
+    def offer(self, model: str, current_version: Any) -> Optional[FirmwareBuild]:
+        """Newest build for ``model`` if it is newer than ``current_version``.
+
+        Displays that report no parsable version are not offered anything,
+        so an unknown firmware is never replaced blindly.
+        """
+        current = parse_version(current_version)
+        if current is None:
+            return None
+        build = self.latest(model)
+        if build is None or parse_version(build.version) <= current:
+            return None
+        return build
+
+
+_catalogs: dict[str, FirmwareCatalog] = {}
+_catalogs_lock = Lock()
+
+
+def get_firmware_catalog() -> FirmwareCatalog:
+    directory = current_app.config.get("FIRMWARE_DIR") or str(Path(__file__).resolve().parents[2] / "firmware")
+    with _catalogs_lock:
+        catalog = _catalogs.get(directory)
+        if catalog is None:
+            catalog = _catalogs[directory] = FirmwareCatalog(Path(directory))
+        return catalog
@@ -4,19 +4,27 @@ from functools import wraps
 from http import HTTPStatus
 from typing import Any, Callable
 
-from flask import Blueprint, jsonify, request
+import msgpack
+from flask import Blueprint, Response, current_app, jsonify, make_response, request, send_file, stream_with_context
 
 from ..auth.utils import AuthError, require_firebase_user
+from .delta import build_state_delta, get_state_history
+from .events import stream_owner_events
+from .firmware import FIRMWARE_MIMETYPE, get_firmware_catalog
 from .service import (
+    MSGPACK_MIMETYPE,
     DeviceAuthError,
     DeviceError,
     DeviceNotFound,
     DeviceRecord,
     DeviceUnclaimed,
     authenticate_device,
+    build_compact_delta,
     claim_device,
+    device_endpoints,
     get_device_state,
     register_device,
+    resolve_device_model,
     update_device_presence,
 )
 
@@ -60,7 +68,11 @@ def register_device_route():
     registration = register_device(
         hardware_id=hardware_id,
         firmware_version=firmware_version,
+        model=payload.get("model"),
     )
+    endpoints = device_endpoints(current_app.config.get("DEVICE_ENDPOINTS"))
+    if endpoints:
+        registration["endpoints"] = endpoints
     return jsonify(registration), HTTPStatus.CREATED
 
 
@@ -88,13 +100,73 @@ def heartbeat_route():
         rssi=payload.get("wifiRssi"),
         battery_mv=payload.get("batteryMv"),
         firmware_version=payload.get("firmwareVersion"),
+        model=payload.get("model"),
+        perf=payload.get("perf"),
     )
-    return jsonify({"status": "ok"}), HTTPStatus.OK
+    body: dict[str, Any] = {"status": "ok"}
+    model = resolve_device_model(payload.get("model") or record.model)
+    build = get_firmware_catalog().offer(model, payload.get("firmwareVersion") or record.firmware_version)
+    if build is not None:
+        body["firmware"] = build.advertisement()
+    return jsonify(body), HTTPStatus.OK
+
+
+@devices_bp.get("/firmware/<version>")
+@_device_error_handler
+def firmware_route(version: str):
+    record = _require_device_context()
+    build = get_firmware_catalog().find(resolve_device_model(record.model), version)
+    if build is None:
+        raise DeviceNotFound(f"No firmware {version} for this display model")
+    # Sent as stored; the display inflates gzip builds itself
+    response = send_file(build.path, mimetype=FIRMWARE_MIMETYPE, conditional=True, etag=build.image_sha256)
+    response.headers["X-Firmware-Encoding"] = build.encoding
+    response.headers["X-Firmware-Sha256"] = build.image_sha256
+    return response
 
 
 @devices_bp.get("/state")
 @_device_error_handler
 def device_state_route():
     record = _require_device_context()
-    state = get_device_state(record)
-    return jsonify(state), HTTPStatus.OK
+    # Shared by every display of this owner and model; encoded once per change
+    view = get_device_state(record)
+    state = view.state
+    wants_msgpack = request.accept_mimetypes.best_match(["application/json", MSGPACK_MIMETYPE]) == MSGPACK_MIMETYPE
+    etag = view.compact_etag if wants_msgpack else view.etag
+    history = get_state_history()
+    if request.if_none_match.contains(etag):
+        # Unchanged since the device's last fetch: skip the body entirely
+        response = make_response("", HTTPStatus.NOT_MODIFIED)
+    else:
+        since = (request.args.get("since") or "").strip().strip('"')
+        base = history.lookup(record.id, since) if since else None
+        delta = build_state_delta(base, state) if base is not None else None
+        if delta is not None:
+            # The device holds `since`: send only what changed relative to it
+            delta["base"] = since
+            body = build_compact_delta(delta) if wants_msgpack else delta
+        else:
+            body = view.compact if wants_msgpack else state
+        if wants_msgpack:
+            response = make_response(msgpack.packb(body, use_bin_type=True), HTTPStatus.OK)
+            response.mimetype = MSGPACK_MIMETYPE
+        else:
+            response = jsonify(body)
+    history.remember(record.id, etag, state)
+    response.set_etag(etag)
+    response.vary.add("Accept")
+    return response
+
+
+@devices_bp.get("/events")
+@_device_error_handler
+def device_events_route():
+    record = _require_device_context()
+    if not record.owner_uid:
+        raise DeviceUnclaimed("Device has not been paired to a user")
+    return Response(
+        stream_with_context(stream_owner_events(record.owner_uid)),
+        mimetype="text/event-stream",
+        headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"},
+    )
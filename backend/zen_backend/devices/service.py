@@ -2,11 +2,15 @@ from __future__ import annotations
 
 from dataclasses import dataclass
 from datetime import datetime, timedelta, timezone
-from typing import Any, Optional
+from functools import lru_cache
+from pathlib import Path
+from typing import Any, Callable, Optional
 import hashlib
+import json
 import logging
 import secrets
 import uuid
+import zoneinfo
 
 from firebase_admin import firestore as firebase_firestore
 from flask import current_app
@@ -23,9 +27,56 @@ from ..email.service import (
     GmailService,
 )
 from ..email.analyzer import list_analyses
+from .snapshot_cache import get_snapshot_cache
 
 log = logging.getLogger(__name__)
 
+# Compact binary representation of GET /devices/state, see build_compact_state
+# and build_compact_delta
+DEVICE_STATE_SCHEMA_VERSION = 1
+DEVICE_STATE_DELTA_SCHEMA_VERSION = 2
+MSGPACK_MIMETYPE = "application/msgpack"
+
+# Firmware telemetry sent as "perf" with each heartbeat, see sanitize_device_perf
+PERF_TIMING_METRICS = ("wifiConnect", "tlsHandshake", "httpGet", "stateParse", "rasterise", "panelRefresh")
+PERF_HEAP_FIELDS = ("free", "minFree", "largestBlock")
+PERF_BUCKETS = 12
+
+# Longest POSIX TZ rule the firmware stores, see posix_timezone
+POSIX_TZ_MAX_LENGTH = 47
+
+# Backend URLs a display keeps for failover, see device_endpoints
+DEVICE_MAX_ENDPOINTS = 4
+DEVICE_ENDPOINT_MAX_LENGTH = 127
+
+# Items collected per owner snapshot; per-model views may show fewer. Each
+# email costs one Gmail request when the snapshot is built.
+SNAPSHOT_MAX_EVENTS = 16
+SNAPSHOT_MAX_MAILS = 16
+
+
+@dataclass(frozen=True, slots=True)
+class DeviceModelHints:
+    """What one display model can render, applied once per snapshot and model."""
+
+    max_events: int
+    max_mails: int
+    # UTF-8 bytes kept per text field; the firmware's fixed buffers minus NUL
+    field_bytes: dict[str, int]
+
+
+# Displays report their model at registration and in heartbeats; records
+# from older firmware fall back to the original 2.9" panel
+DEFAULT_DEVICE_MODEL = "zen-290"
+DEVICE_MODEL_HINTS: dict[str, DeviceModelHints] = {
+    "zen-290": DeviceModelHints(
+        # Kept on the display and paged through with its mode button
+        max_events=16,
+        max_mails=16,
+        field_bytes={"start": 31, "summary": 89, "location": 47, "from": 63, "snippet": 191},
+    ),
+}
+
 
 class DeviceError(Exception):
     """Base exception for device operations."""
@@ -59,6 +110,21 @@ class DeviceRecord:
     last_seen_at: Optional[datetime]
     created_at: Optional[datetime]
     updated_at: Optional[datetime]
+    model: Optional[str] = None
+
+
+@dataclass(slots=True)
+class DeviceStateView:
+    """A snapshot prepared for one display model, shared by all its devices.
+
+    The JSON and compact encodings and their ETags are computed once when
+    the view is built, so each poll only compares and sends them.
+    """
+
+    state: dict[str, Any]
+    etag: str
+    compact: list[Any]
+    compact_etag: str
 
 
 def _now() -> datetime:
@@ -81,7 +147,36 @@ def _coerce_timestamp(value: Any) -> Optional[datetime]:
     return None
 
 
-def register_device(*, hardware_id: str | None, firmware_version: str | None = None) -> dict[str, Any]:
+def device_endpoints(configured: Any) -> list[str]:
+    """The configured base URLs in the form displays accept, in order of preference.
+
+    Displays only connect over TLS and keep at most DEVICE_MAX_ENDPOINTS URLs
+    of up to DEVICE_ENDPOINT_MAX_LENGTH bytes; anything else is dropped here
+    rather than silently on the device.
+    """
+    if isinstance(configured, str):
+        configured = [configured]
+    endpoints: list[str] = []
+    for value in configured or ():
+        if not isinstance(value, str):
+            continue
+        url = value.strip().rstrip("/")
+        if not url.startswith("https://") or len(url.encode("utf-8")) > DEVICE_ENDPOINT_MAX_LENGTH:
+            log.warning("Ignoring device endpoint %r", value)
+            continue
+        if url not in endpoints:
+            endpoints.append(url)
+        if len(endpoints) == DEVICE_MAX_ENDPOINTS:
+            break
+    return endpoints
+
+
+def register_device(
+    *,
+    hardware_id: str | None,
+    firmware_version: str | None = None,
+    model: str | None = None,
+) -> dict[str, Any]:
     """Create a pending device registration and return secrets for the ESP32."""
 
     device_id = uuid.uuid4().hex
@@ -93,6 +188,7 @@ def register_device(*, hardware_id: str | None, firmware_version: str | None = N
         "deviceId": device_id,
         "hardwareId": hardware_id,
         "firmwareVersion": firmware_version,
+        "model": model,
         "status": "pending",
         "ownerUid": None,
         "bluetoothName": bluetooth_name,
@@ -175,6 +271,7 @@ def get_device(device_id: str) -> DeviceRecord:
         last_seen_at=_coerce_timestamp(data.get("lastSeenAt")),
         created_at=_coerce_timestamp(data.get("createdAt")),
         updated_at=_coerce_timestamp(data.get("updatedAt")),
+        model=data.get("model"),
     )
 
 
@@ -194,6 +291,8 @@ def update_device_presence(
     rssi: int | None = None,
     battery_mv: int | None = None,
     firmware_version: str | None = None,
+    model: str | None = None,
+    perf: Any = None,
 ) -> None:
     updates: dict[str, Any] = {
         "lastSeenAt": firebase_firestore.SERVER_TIMESTAMP,
@@ -207,38 +306,295 @@ def update_device_presence(
         updates["batteryMv"] = battery_mv
     if firmware_version is not None:
         updates["firmwareVersion"] = firmware_version
+    if isinstance(model, str) and model != record.model:
+        updates["model"] = model
+    sanitized_perf = sanitize_device_perf(perf)
+    if sanitized_perf is not None:
+        # Tag the window with the firmware that produced it so regressions can
+        # be compared across versions
+        sanitized_perf["firmwareVersion"] = firmware_version or record.firmware_version
+        sanitized_perf["reportedAt"] = firebase_firestore.SERVER_TIMESTAMP
+        updates["perf"] = sanitized_perf
 
     _collection().document(record.id).set(updates, merge=True)
 
 
-def get_device_state(record: DeviceRecord) -> dict[str, Any]:
+def _non_negative_int(value: Any) -> Optional[int]:
+    if isinstance(value, bool) or not isinstance(value, int) or value < 0:
+        return None
+    return value
+
+
+def sanitize_device_perf(perf: Any) -> Optional[dict[str, Any]]:
+    """Keep only the known, well-typed fields of a heartbeat telemetry report.
+
+    Unknown metrics and malformed values are dropped so a misbehaving
+    firmware cannot write arbitrary data into the device document. Returns
+    None when nothing usable remains.
+    """
+
+    if not isinstance(perf, dict):
+        return None
+    result: dict[str, Any] = {}
+    window_ms = _non_negative_int(perf.get("windowMs"))
+    if window_ms is not None:
+        result["windowMs"] = window_ms
+
+    heap = perf.get("heap")
+    if isinstance(heap, dict):
+        clean_heap: dict[str, int] = {}
+        for field in PERF_HEAP_FIELDS:
+            value = _non_negative_int(heap.get(field))
+            if value is not None:
+                clean_heap[field] = value
+        if clean_heap:
+            result["heap"] = clean_heap
+
+    timings = perf.get("timings")
+    if isinstance(timings, dict):
+        clean_timings: dict[str, Any] = {}
+        for metric in PERF_TIMING_METRICS:
+            entry = timings.get(metric)
+            if not isinstance(entry, dict):
+                continue
+            count = _non_negative_int(entry.get("count"))
+            if not count:
+                continue
+            clean_entry: dict[str, Any] = {"count": count}
+            for field in ("totalMs", "maxMs"):
+                value = _non_negative_int(entry.get(field))
+                if value is not None:
+                    clean_entry[field] = value
+            buckets = entry.get("buckets")
+            if isinstance(buckets, list) and len(buckets) <= PERF_BUCKETS:
+                values = [_non_negative_int(value) for value in buckets]
+                if all(value is not None for value in values):
+                    clean_entry["buckets"] = values
+            clean_timings[metric] = clean_entry
+        if clean_timings:
+            result["timings"] = clean_timings
+
+    return result or None
+
+
+def get_device_state(record: DeviceRecord) -> DeviceStateView:
+    """Return the state view for ``record``'s model.
+
+    The owner's snapshot is built once per change and shared by all of the
+    owner's displays; each model's view of it is derived once as well.
+    """
+
     if not record.owner_uid:
         raise DeviceUnclaimed("Device has not been paired to a user")
 
-    calendar_state = _get_calendar_snapshot(record.owner_uid)
-    email_state = _get_email_snapshot(record.owner_uid)
+    owner_uid = record.owner_uid
+    model = resolve_device_model(record.model)
+    return get_snapshot_cache().get_view(
+        owner_uid,
+        model,
+        lambda: _build_owner_snapshot(owner_uid),
+        lambda state: build_device_view(state, model),
+    )
+
 
-    return {
+def resolve_device_model(model: str | None) -> str:
+    return model if model in DEVICE_MODEL_HINTS else DEFAULT_DEVICE_MODEL
+
+
+def build_device_view(state: dict[str, Any], model: str = DEFAULT_DEVICE_MODEL) -> DeviceStateView:
+    hints = DEVICE_MODEL_HINTS[resolve_device_model(model)]
+    fitted = dict(state)
+    for key, limit in (("calendar", hints.max_events), ("email", hints.max_mails)):
+        section = state.get(key)
+        if isinstance(section, dict) and section.get("items"):
+            fitted[key] = {**section, "items": [_fit_item(item, hints) for item in section["items"][:limit]]}
+    # Views of an untouched snapshot keep the original dict, so equal
+    # content still hashes and compares equal
+    if fitted == state:
+        fitted = state
+    compact = build_compact_state(fitted)
+    return DeviceStateView(
+        state=fitted,
+        etag=compute_state_etag(fitted),
+        compact=compact,
+        compact_etag=compute_state_etag(compact),
+    )
+
+
+def _fit_item(item: dict[str, Any], hints: DeviceModelHints) -> dict[str, Any]:
+    fitted = dict(item)
+    for field, limit in hints.field_bytes.items():
+        value = fitted.get(field)
+        if isinstance(value, str) and len(value.encode("utf-8")) > limit:
+            # Cut on a character boundary so the display never sees half a glyph
+            fitted[field] = value.encode("utf-8")[:limit].decode("utf-8", errors="ignore")
+    return fitted
+
+
+def _build_owner_snapshot(owner_uid: str) -> dict[str, Any]:
+    calendar_state = _get_calendar_snapshot(owner_uid)
+    email_state = _get_email_snapshot(owner_uid)
+
+    state: dict[str, Any] = {
         "calendar": calendar_state,
         "email": email_state,
     }
+    time_zone = calendar_state.pop("timeZone", None)
+    posix = posix_timezone(time_zone)
+    if posix:
+        state["timezone"] = {"name": time_zone, "posix": posix}
+    return state
+
+
+@lru_cache(maxsize=64)
+def posix_timezone(name: str | None) -> Optional[str]:
+    """Return the POSIX TZ rule for an IANA zone name, or None if unknown.
 
+    TZif files from version 2 on end with the rule that applies after the
+    last transition, which is exactly what newlib's ``setenv("TZ")`` expects
+    on the display. Rules longer than the firmware buffer are dropped.
+    """
 
+    if not name or not isinstance(name, str):
+        return None
+    try:
+        zoneinfo.ZoneInfo(name)
+    except (zoneinfo.ZoneInfoNotFoundError, ValueError):
+        return None
+    for root in zoneinfo.TZPATH:
+        path = Path(root) / name
+        if path.is_file():
+            return _tzif_footer(path.read_bytes())
+    try:
+        from importlib import resources
+
+        data = resources.files("tzdata.zoneinfo").joinpath(*name.split("/")).read_bytes()
+    except (ImportError, OSError):
+        return None
+    return _tzif_footer(data)
+
+
+def _tzif_footer(data: bytes) -> Optional[str]:
+    if not data.startswith(b"TZif") or data[4:5] in (b"\x00", b""):
+        return None
+    lines = data.rstrip(b"\n").rsplit(b"\n", 1)
+    if len(lines) != 2:
+        return None
+    try:
+        rule = lines[1].decode("ascii")
+    except UnicodeDecodeError:
+        return None
+    if not rule or len(rule) > POSIX_TZ_MAX_LENGTH:
+        return None
+    return rule
+
+
+def compute_state_etag(state: dict[str, Any]) -> str:
+    """Return a stable content hash of a device state payload for use as ETag."""
+
+    canonical = json.dumps(state, sort_keys=True, separators=(",", ":"), default=str)
+    return _hash(canonical)[:32]
+
+
+def _compact_event(item: dict[str, Any]) -> list[Any]:
+    return [item.get("start"), item.get("summary"), item.get("location"), item.get("id")]
+
+
+def _compact_mail(item: dict[str, Any]) -> list[Any]:
+    return [item.get("from"), item.get("snippet"), item.get("id")]
+
+
+def build_compact_state(state: dict[str, Any]) -> list[Any]:
+    """Return the positional form of a device state for MessagePack encoding.
+
+    Schema version 1 keeps only what the display renders:
+    ``[version, [calConnected, [[start, summary, location, id], ...]],
+    [mailConnected, [[from, snippet, id], ...]], posixTz]`` where the
+    trailing POSIX TZ rule is only present when the owner's zone is known.
+    Firmware skips unknown trailing elements, so later versions may append
+    fields.
+    """
+
+    calendar = state.get("calendar") or {}
+    email = state.get("email") or {}
+    compact = [
+        DEVICE_STATE_SCHEMA_VERSION,
+        [
+            bool(calendar.get("connected")),
+            [_compact_event(item) for item in calendar.get("items") or []],
+        ],
+        [
+            bool(email.get("connected")),
+            [_compact_mail(item) for item in email.get("items") or []],
+        ],
+    ]
+    _append_timezone(compact, state)
+    return compact
+
+
+def _append_timezone(compact: list[Any], state: dict[str, Any]) -> None:
+    posix = (state.get("timezone") or {}).get("posix")
+    if posix:
+        compact.append(posix)
+
+
+def build_compact_delta(delta: dict[str, Any]) -> list[Any]:
+    """Return the positional form of a state delta (see devices.delta).
+
+    ``[2, base, [calConnected, [changed...], [removedIds], [orderIds]],
+    [mailConnected, [changed...], [removedIds], [orderIds]], posixTz]`` with
+    changed items and the optional trailing TZ rule encoded exactly as in
+    ``build_compact_state``.
+    """
+
+    def section(key: str, encode: Callable[[dict[str, Any]], list[Any]]) -> list[Any]:
+        part = delta.get(key) or {}
+        return [
+            bool(part.get("connected")),
+            [encode(item) for item in part.get("changed") or []],
+            list(part.get("removed") or []),
+            list(part.get("order") or []),
+        ]
+
+    compact = [
+        DEVICE_STATE_DELTA_SCHEMA_VERSION,
+        delta.get("base"),
+        section("calendar", _compact_event),
+        section("email", _compact_mail),
+    ]
+    _append_timezone(compact, delta)
+    return compact
+
+
+# Snapshot builds reuse one client (and with it one pooled HTTP session)
+# per configuration instead of constructing them on every poll
 def _build_calendar_service() -> GoogleCalendarService:
-    config = GoogleCalendarConfig(
-        client_id=current_app.config.get("GOOGLE_CLIENT_ID"),
-        client_secret=current_app.config.get("GOOGLE_CLIENT_SECRET"),
-        scopes=tuple(current_app.config.get("GOOGLE_CALENDAR_SCOPES") or ()),
+    return _calendar_service_for(
+        current_app.config.get("GOOGLE_CLIENT_ID"),
+        current_app.config.get("GOOGLE_CLIENT_SECRET"),
+        tuple(current_app.config.get("GOOGLE_CALENDAR_SCOPES") or ()),
     )
-    return GoogleCalendarService(config=config)
 
 
 def _build_email_service() -> GmailService:
-    config = GmailConfig(
-        client_id=current_app.config.get("GOOGLE_CLIENT_ID"),
-        client_secret=current_app.config.get("GOOGLE_CLIENT_SECRET"),
-        scopes=tuple(current_app.config.get("GOOGLE_GMAIL_SCOPES") or ()),
+    return _email_service_for(
+        current_app.config.get("GOOGLE_CLIENT_ID"),
+        current_app.config.get("GOOGLE_CLIENT_SECRET"),
+        tuple(current_app.config.get("GOOGLE_GMAIL_SCOPES") or ()),
     )
+
+
+@lru_cache(maxsize=4)
+def _calendar_service_for(
+    client_id: str | None, client_secret: str | None, scopes: tuple[str, ...]
+) -> GoogleCalendarService:
+    config = GoogleCalendarConfig(client_id=client_id, client_secret=client_secret, scopes=scopes)
+    return GoogleCalendarService(config=config)
+
+
+@lru_cache(maxsize=4)
+def _email_service_for(client_id: str | None, client_secret: str | None, scopes: tuple[str, ...]) -> GmailService:
+    config = GmailConfig(client_id=client_id, client_secret=client_secret, scopes=scopes)
     return GmailService(config=config)
 
 
@@ -262,7 +618,7 @@ def _get_calendar_snapshot(uid: str) -> dict[str, Any]:
         events = service.list_events(
             uid,
             time_min=now_iso,
-            max_results=4,
+            max_results=SNAPSHOT_MAX_EVENTS,
             single_events=True,
             order_by="startTime",
         )
@@ -271,7 +627,7 @@ def _get_calendar_snapshot(uid: str) -> dict[str, Any]:
         return {"connected": False, "error": str(exc)}
 
     items = []
-    for raw in events.get("items", [])[:4]:
+    for raw in events.get("items", [])[:SNAPSHOT_MAX_EVENTS]:
         items.append(
             {
                 "id": raw.get("id"),
@@ -282,7 +638,7 @@ def _get_calendar_snapshot(uid: str) -> dict[str, Any]:
             }
         )
 
-    return {"connected": True, "items": items}
+    return {"connected": True, "items": items, "timeZone": events.get("timeZone")}
 
 
 def _get_email_snapshot(uid: str) -> dict[str, Any]:
@@ -309,7 +665,7 @@ def _get_email_snapshot(uid: str) -> dict[str, Any]:
         return {"connected": True, "items": []}
 
     details = []
-    for message_id, analysis in list(analyses_by_message_id.items())[:3]:
+    for message_id, analysis in list(analyses_by_message_id.items())[:SNAPSHOT_MAX_MAILS]:
         try:
             full = service.get_message(uid, message_id)
         except EmailError as exc:
@@ -0,0 +1,145 @@
+"""Per-owner cache of the calendar and email snapshot served to displays.
+
+Building a snapshot costs a Google Calendar request and an email analysis
+query, while displays poll about once a minute. Entries are tagged with the
+owner's change counter from ``devices.events``: the calendar routes and the
+email analyzer (fed by the poller, IMAP IDLE and Gmail push) already bump it
+through ``notify_owner_changed``, so a change made through the app is never
+served stale. The TTL only bounds how long edits made outside the app (for
+example directly in Google Calendar) and past events take to show up.
+Like the state history, the cache is process-local and never a source of
+truth.
+"""
+
+from __future__ import annotations
+
+import time
+from collections import OrderedDict
+from dataclasses import dataclass, field
+from threading import Lock
+from typing import Any, Callable, Optional
+
+from .events import DeviceEventHub, get_event_hub
+
+SNAPSHOT_TTL_SECONDS = 300
+# Failed builds (Google or Firestore errors) are retried sooner
+SNAPSHOT_ERROR_TTL_SECONDS = 30
+SNAPSHOT_MAX_OWNERS = 2048
+
+
+@dataclass(slots=True)
+class _Entry:
+    version: int
+    expires_at: float
+    state: dict[str, Any]
+    # Per-model views derived from state, see get_view
+    views: dict[str, Any] = field(default_factory=dict)
+
+
+class OwnerSnapshotCache:
+    """Bounded map of owner uid to the last snapshot built for that owner."""
+
+    def __init__(
+        self,
+        *,
+        hub: Optional[DeviceEventHub] = None,
+        ttl_seconds: float = SNAPSHOT_TTL_SECONDS,
+        error_ttl_seconds: float = SNAPSHOT_ERROR_TTL_SECONDS,
+        max_owners: int = SNAPSHOT_MAX_OWNERS,
+        clock: Callable[[], float] = time.monotonic,
+    ) -> None:
+        self._hub = hub
+        self._ttl = ttl_seconds
+        self._error_ttl = error_ttl_seconds
+        self._max_owners = max_owners
+        self._clock = clock
+        self._lock = Lock()
+        self._entries: OrderedDict[str, _Entry] = OrderedDict()
+        # One build at a time per owner, so displays sharing an owner
+        # that poll together wait for a single build instead of each
+        # calling Google
+        self._build_locks: dict[str, Lock] = {}
+
+    def get(self, owner_uid: str, build: Callable[[], dict[str, Any]]) -> dict[str, Any]:
+        """Return the cached snapshot of ``owner_uid``, building it when stale.
+
+        The returned dict is shared between callers and must not be mutated.
+        """
+
+        return self._entry(owner_uid, build).state
+
+    def get_view(
+        self,
+        owner_uid: str,
+        key: str,
+        build: Callable[[], dict[str, Any]],
+        derive: Callable[[dict[str, Any]], Any],
+    ) -> Any:
+        """Return ``derive(snapshot)`` for ``key``, computed once per snapshot.
+
+        Used for per-model views, so N displays of one model and owner cost
+        one derivation per change. Views are shared and must not be mutated.
+        """
+
+        entry = self._entry(owner_uid, build)
+        with self._lock:
+            view = entry.views.get(key)
+        if view is None:
+            # Deriving is cheap and pure; a rare duplicate under a race is harmless
+            view = derive(entry.state)
+            with self._lock:
+                view = entry.views.setdefault(key, view)
+        return view
+
+    def _entry(self, owner_uid: str, build: Callable[[], dict[str, Any]]) -> _Entry:
+        hub = self._hub or get_event_hub()
+        entry = self._lookup(owner_uid, hub.version(owner_uid))
+        if entry is not None:
+            return entry
+        with self._build_lock(owner_uid):
+            # Read the version before building: a change that lands while
+            # the build runs leaves the entry already outdated
+            version = hub.version(owner_uid)
+            entry = self._lookup(owner_uid, version)
+            if entry is not None:
+                return entry
+            state = build()
+            ttl = self._error_ttl if _has_error(state) else self._ttl
+            entry = _Entry(version, self._clock() + ttl, state)
+            with self._lock:
+                self._entries.pop(owner_uid, None)
+                self._entries[owner_uid] = entry
+                while len(self._entries) > self._max_owners:
+                    evicted, _ = self._entries.popitem(last=False)
+                    self._build_locks.pop(evicted, None)
+            return entry
+
+    def invalidate(self, owner_uid: str) -> None:
+        with self._lock:
+            self._entries.pop(owner_uid, None)
+
+    def _lookup(self, owner_uid: str, version: int) -> Optional[_Entry]:
+        with self._lock:
+            entry = self._entries.get(owner_uid)
+            if entry is None or entry.version != version or self._clock() >= entry.expires_at:
+                return None
+            self._entries.move_to_end(owner_uid)
+            return entry
+
+    def _build_lock(self, owner_uid: str) -> Lock:
+        with self._lock:
+            lock = self._build_locks.get(owner_uid)
+            if lock is None:
+                lock = self._build_locks[owner_uid] = Lock()
+            return lock
+
+
+def _has_error(state: dict[str, Any]) -> bool:
+    return any(isinstance(section, dict) and section.get("error") for section in state.values())
+
+
+_cache = OwnerSnapshotCache()
+
+
+def get_snapshot_cache() -> OwnerSnapshotCache:
+    return _cache
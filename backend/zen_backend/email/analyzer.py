@@ -337,6 +337,11 @@ def analyze_email(
         log.error(traceback.format_exc())
         raise EmailAnalysisStoreError(f"Failed to store email analysis: {exc}") from exc
 
+    # Imported lazily: the devices package imports this module
+    from ..devices.events import notify_owner_changed
+
+    notify_owner_changed(uid, "email_analysis")
+
     return EmailAnalysis(
         uid=uid,
         message_id=message_id,
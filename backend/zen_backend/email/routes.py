@@ -43,6 +43,13 @@ def _email_endpoint(fn):
     return wrapper
 
 
+def _notify_devices(uid: str) -> None:
+    # Imported lazily: the devices package imports the email service
+    from ..devices.events import notify_owner_changed
+
+    notify_owner_changed(uid, "email_connection")
+
+
 def _serialize_gmail_connection(record: GmailTokens | None) -> dict[str, Any]:
     if record is None:
         return {
@@ -237,6 +244,7 @@ def exchange_gmail_code():
     except Exception as e:
         log.error(f"Failed to register Gmail webhook: {e}")
     
+    _notify_devices(auth_ctx.uid)
     return jsonify(_serialize_gmail_connection(record)), HTTPStatus.OK
 
 
@@ -273,6 +281,7 @@ def delete_gmail_connection():
         log.warning(f"Failed to delete Gmail webhook subscription: {e}")
     
     service.revoke_connection(auth_ctx.uid)
+    _notify_devices(auth_ctx.uid)
     return ("", HTTPStatus.NO_CONTENT)
 
 
@@ -7,7 +7,7 @@ export 'src/app.dart';
 import 'src/app.dart';
 import 'src/state/user_preferences.dart';
 
-Future<void> main() async {
+Future<void> main(List<String> args) async {
   WidgetsFlutterBinding.ensureInitialized();
   await UserPreferences.init();
 
@@ -15,11 +15,17 @@ Future<void> main() async {
 
   // Configure window on desktop platforms
   if (!kIsWeb && (Platform.isWindows || Platform.isLinux || Platform.isMacOS)) {
+    // With --fast-start the Windows runner has already restored the last
+    // window geometry.
+    final restoredGeometry =
+        Platform.isWindows && args.contains('--fast-start');
     doWhenWindowReady(() {
       const initialSize = Size(1280, 720);
       appWindow.minSize = const Size(800, 600);
-      appWindow.size = initialSize;
-      appWindow.alignment = Alignment.center;
+      if (!restoredGeometry) {
+        appWindow.size = initialSize;
+        appWindow.alignment = Alignment.center;
+      }
       appWindow.title = 'Zen AI';
       appWindow.show();
     });
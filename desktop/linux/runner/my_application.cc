@@ -6,10 +6,14 @@
 #endif
 
 #include "flutter/generated_plugin_registrant.h"
+#include "startup_prefetch.h"
+#include "startup_trace.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  // Stops the startup prefetch once the first frame is up.
+  GCancellable* prefetch_cancellable;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
@@ -18,6 +22,9 @@ G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 static void first_frame_cb(MyApplication* self, FlView *view)
 {
   gtk_widget_show(gtk_widget_get_toplevel(GTK_WIDGET(view)));
+  startup_trace_end("first-frame");
+  // Whatever the prefetch has not read by now the engine opened itself.
+  g_cancellable_cancel(self->prefetch_cancellable);
 }
 
 // Implements GApplication::activate.
@@ -54,6 +61,7 @@ static void my_application_activate(GApplication* application) {
   }
 
   gtk_window_set_default_size(window, 1280, 720);
+  startup_trace_mark("window");
 
   g_autoptr(FlDartProject) project = fl_dart_project_new();
   fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
@@ -66,12 +74,15 @@ static void my_application_activate(GApplication* application) {
   gtk_widget_show(GTK_WIDGET(view));
   gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(view));
 
-  // Show the window when Flutter renders.
-  // Requires the view to be realized so we can start rendering.
+  // Show the window when Flutter renders, so it is never mapped blank.
+  // Requires the view to be realized so we can start rendering; realizing
+  // it also realizes the window, which stays unmapped until then.
   g_signal_connect_swapped(view, "first-frame", G_CALLBACK(first_frame_cb), self);
   gtk_widget_realize(GTK_WIDGET(view));
+  startup_trace_mark("engine-spawn");
 
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  startup_trace_mark("plugins");
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
@@ -82,6 +93,10 @@ static gboolean my_application_local_command_line(GApplication* application, gch
   // Strip out the first argument as it is the binary name.
   self->dart_entrypoint_arguments = g_strdupv(*arguments + 1);
 
+  // Registering runs GApplication::startup, which initializes GTK; warm the
+  // page cache for the engine meanwhile.
+  startup_prefetch_start(self->prefetch_cancellable);
+
   g_autoptr(GError) error = nullptr;
   if (!g_application_register(application, nullptr, &error)) {
      g_warning("Failed to register: %s", error->message);
@@ -102,6 +117,7 @@ static void my_application_startup(GApplication* application) {
   // Perform any actions required at application startup.
 
   G_APPLICATION_CLASS(my_application_parent_class)->startup(application);
+  startup_trace_mark("gtk-init");
 }
 
 // Implements GApplication::shutdown.
@@ -117,6 +133,10 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  if (self->prefetch_cancellable != nullptr) {
+    g_cancellable_cancel(self->prefetch_cancellable);
+  }
+  g_clear_object(&self->prefetch_cancellable);
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
@@ -128,7 +148,9 @@ static void my_application_class_init(MyApplicationClass* klass) {
   G_OBJECT_CLASS(klass)->dispose = my_application_dispose;
 }
 
-static void my_application_init(MyApplication* self) {}
+static void my_application_init(MyApplication* self) {
+  self->prefetch_cancellable = g_cancellable_new();
+}
 
 MyApplication* my_application_new() {
   // Set the program name to the application ID, which helps various systems
@@ -0,0 +1,84 @@
+#include "startup_prefetch.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Size of a single read; large enough for the disk to stream.
+static const gsize kReadChunkSize = 1 << 20;
+
+// Reads @path to its end and discards the contents. Missing files, e.g. the
+// AOT snapshot in debug builds, are skipped.
+static void prefetch_file(const gchar* path, gchar* buffer,
+                          GCancellable* cancellable) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  while (!g_cancellable_is_cancelled(cancellable) &&
+         read(fd, buffer, kReadChunkSize) > 0) {
+  }
+  close(fd);
+}
+
+static gboolean is_font_file(const gchar* name) {
+  g_autofree gchar* lower_name = g_ascii_strdown(name, -1);
+  return g_str_has_suffix(lower_name, ".ttf") ||
+         g_str_has_suffix(lower_name, ".otf");
+}
+
+// Reads the font files below @directory.
+static void prefetch_fonts(const gchar* directory, gchar* buffer,
+                           GCancellable* cancellable) {
+  g_autoptr(GDir) dir = g_dir_open(directory, 0, nullptr);
+  if (dir == nullptr) {
+    return;
+  }
+  const gchar* name;
+  while (!g_cancellable_is_cancelled(cancellable) &&
+         (name = g_dir_read_name(dir)) != nullptr) {
+    g_autofree gchar* path = g_build_filename(directory, name, nullptr);
+    if (g_file_test(path, G_FILE_TEST_IS_SYMLINK)) {
+      continue;
+    }
+    if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
+      prefetch_fonts(path, buffer, cancellable);
+    } else if (is_font_file(name)) {
+      prefetch_file(path, buffer, cancellable);
+    }
+  }
+}
+
+static void prefetch_thread(GTask* task, gpointer source_object,
+                            gpointer task_data, GCancellable* cancellable) {
+  // The bundle layout: lib/libapp.so and data/ next to the executable.
+  g_autofree gchar* executable = g_file_read_link("/proc/self/exe", nullptr);
+  if (executable == nullptr) {
+    g_task_return_boolean(task, FALSE);
+    return;
+  }
+  g_autofree gchar* bundle = g_path_get_dirname(executable);
+  g_autofree gchar* buffer = static_cast<gchar*>(g_malloc(kReadChunkSize));
+
+  // In the order the engine opens them.
+  g_autofree gchar* icu_data =
+      g_build_filename(bundle, "data", "icudtl.dat", nullptr);
+  prefetch_file(icu_data, buffer, cancellable);
+  g_autofree gchar* aot_library =
+      g_build_filename(bundle, "lib", "libapp.so", nullptr);
+  prefetch_file(aot_library, buffer, cancellable);
+
+  g_autofree gchar* assets =
+      g_build_filename(bundle, "data", "flutter_assets", nullptr);
+  g_autofree gchar* font_manifest =
+      g_build_filename(assets, "FontManifest.json", nullptr);
+  prefetch_file(font_manifest, buffer, cancellable);
+  prefetch_fonts(assets, buffer, cancellable);
+
+  g_task_return_boolean(task, TRUE);
+}
+
+void startup_prefetch_start(GCancellable* cancellable) {
+  g_autoptr(GTask) task = g_task_new(nullptr, cancellable, nullptr, nullptr);
+  g_task_run_in_thread(task, prefetch_thread);
+}
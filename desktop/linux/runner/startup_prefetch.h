@@ -0,0 +1,17 @@
+#ifndef FLUTTER_STARTUP_PREFETCH_H_
+#define FLUTTER_STARTUP_PREFETCH_H_
+
+#include <gio/gio.h>
+
+/**
+ * startup_prefetch_start:
+ * @cancellable: (allow-none): a #GCancellable to stop the prefetch early.
+ *
+ * Reads the files the engine loads first - the AOT snapshot, the ICU data
+ * and the bundled fonts - on a worker thread while GTK initializes, so that
+ * the engine finds them in the page cache instead of waiting for the disk on
+ * a cold start.
+ */
+void startup_prefetch_start(GCancellable* cancellable);
+
+#endif  // FLUTTER_STARTUP_PREFETCH_H_
@@ -0,0 +1,104 @@
+#include "startup_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static const gchar kTraceEnvironmentVariable[] = "ZEN_STARTUP_TRACE";
+
+static gboolean trace_enabled = FALSE;
+// Trace file, or nullptr when writing to the log.
+static FILE* trace_file = nullptr;
+// CLOCK_BOOTTIME of the process start and of the last mark, in microseconds.
+static gint64 process_start_us = 0;
+static gint64 last_mark_us = 0;
+
+static gint64 boottime_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_BOOTTIME, &now);
+  return now.tv_sec * G_USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
+// Reads the process start time, in clock ticks since boot, from field 22 of
+// /proc/self/stat. Returns FALSE if that is not available.
+static gboolean read_process_start(gint64* start_us) {
+  g_autofree gchar* stat = nullptr;
+  if (!g_file_get_contents("/proc/self/stat", &stat, nullptr, nullptr)) {
+    return FALSE;
+  }
+  // The command name in field 2 may contain spaces; count from its end.
+  const gchar* fields = strrchr(stat, ')');
+  if (fields == nullptr) {
+    return FALSE;
+  }
+  g_auto(GStrv) values = g_strsplit(fields + 2, " ", 21);
+  if (g_strv_length(values) < 20) {
+    return FALSE;
+  }
+  long ticks_per_second = sysconf(_SC_CLK_TCK);
+  if (ticks_per_second <= 0) {
+    return FALSE;
+  }
+  // values[0] is field 3, so the start time is values[19].
+  gint64 ticks = g_ascii_strtoll(values[19], nullptr, 10);
+  *start_us = ticks * G_USEC_PER_SEC / ticks_per_second;
+  return TRUE;
+}
+
+static void write_phase(const gchar* phase, gint64 duration_us,
+                        gint64 since_start_us) {
+  if (trace_file != nullptr) {
+    fprintf(trace_file, "startup %s %.1f %.1f\n", phase, duration_us / 1000.0,
+            since_start_us / 1000.0);
+    fflush(trace_file);
+  } else {
+    g_message("startup %s %.1f %.1f", phase, duration_us / 1000.0,
+              since_start_us / 1000.0);
+  }
+}
+
+void startup_trace_begin() {
+  const gchar* target = g_getenv(kTraceEnvironmentVariable);
+  if (target == nullptr || target[0] == '\0') {
+    return;
+  }
+  if (g_strcmp0(target, "1") != 0) {
+    trace_file = fopen(target, "a");
+    if (trace_file == nullptr) {
+      g_warning("Failed to open startup trace %s", target);
+      return;
+    }
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+    g_autofree gchar* timestamp = g_date_time_format_iso8601(now);
+    fprintf(trace_file, "run %s pid %d\n", timestamp, getpid());
+  }
+  trace_enabled = TRUE;
+
+  last_mark_us = boottime_us();
+  if (read_process_start(&process_start_us) &&
+      process_start_us <= last_mark_us) {
+    write_phase("exec", last_mark_us - process_start_us,
+                last_mark_us - process_start_us);
+  } else {
+    process_start_us = last_mark_us;
+  }
+}
+
+void startup_trace_mark(const gchar* phase) {
+  if (!trace_enabled) {
+    return;
+  }
+  gint64 now_us = boottime_us();
+  write_phase(phase, now_us - last_mark_us, now_us - process_start_us);
+  last_mark_us = now_us;
+}
+
+void startup_trace_end(const gchar* phase) {
+  startup_trace_mark(phase);
+  trace_enabled = FALSE;
+  if (trace_file != nullptr) {
+    fclose(trace_file);
+    trace_file = nullptr;
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef FLUTTER_STARTUP_TRACE_H_
+#define FLUTTER_STARTUP_TRACE_H_
+
+#include <glib.h>
+
+/**
+ * Startup phase timings, recorded only when the ZEN_STARTUP_TRACE
+ * environment variable is set: to a file path to append them to that file,
+ * or to "1" to write them to the log. Each phase is reported as
+ *
+ *   startup <phase> <duration ms> <ms since the process started>
+ */
+
+/**
+ * startup_trace_begin:
+ *
+ * Starts the trace; call first thing in main(). Reports the time between
+ * the process start and this call (loading and linking the binary) as the
+ * "exec" phase.
+ */
+void startup_trace_begin();
+
+/**
+ * startup_trace_mark:
+ * @phase: name of the phase that just ended.
+ *
+ * Reports the time since the previous mark as @phase.
+ */
+void startup_trace_mark(const gchar* phase);
+
+/**
+ * startup_trace_end:
+ * @phase: name of the last phase.
+ *
+ * Ends the trace with a final mark for @phase and closes the trace file.
+ * Later marks are ignored.
+ */
+void startup_trace_end(const gchar* phase);
+
+#endif  // FLUTTER_STARTUP_TRACE_H_
@@ -2,11 +2,29 @@
 #include <flutter/flutter_view_controller.h>
 #include <windows.h>
 
+#include <algorithm>
+
 #include "flutter_window.h"
+#include "startup_prefetch.h"
 #include "utils.h"
+#include "window_placement.h"
 
 int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
                       _In_ wchar_t *command_line, _In_ int show_command) {
+  std::vector<std::string> command_line_arguments =
+      GetCommandLineArguments();
+
+  // Fast start restores the last window geometry, warms the file cache for
+  // the engine and coalesces resizes. The switch is passed on to Dart too,
+  // which then leaves the restored geometry alone.
+  const bool fast_start =
+      std::find(command_line_arguments.begin(), command_line_arguments.end(),
+                "--fast-start") != command_line_arguments.end();
+  StartupPrefetch prefetch;
+  if (fast_start) {
+    prefetch.Start();
+  }
+
   // Attach to console when present (e.g., 'flutter run') or create a
   // new console when running with a debugger.
   if (!::AttachConsole(ATTACH_PARENT_PROCESS) && ::IsDebuggerPresent()) {
@@ -19,15 +37,24 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
 
   flutter::DartProject project(L"data");
 
-  std::vector<std::string> command_line_arguments =
-      GetCommandLineArguments();
-
   project.set_dart_entrypoint_arguments(std::move(command_line_arguments));
 
   FlutterWindow window(project);
-  Win32Window::Point origin(10, 10);
-  Win32Window::Size size(1280, 720);
-  if (!window.Create(L"desktop", origin, size)) {
+  bool created;
+  if (fast_start) {
+    WindowPlacement placement;
+    if (!LoadWindowPlacement(&placement)) {
+      placement = DefaultWindowPlacement(1280, 720);
+    }
+    window.SetShowMaximized(placement.maximized);
+    window.SetResizeCoalescing(true);
+    created = window.Create(L"desktop", placement.frame);
+  } else {
+    Win32Window::Point origin(10, 10);
+    Win32Window::Size size(1280, 720);
+    created = window.Create(L"desktop", origin, size);
+  }
+  if (!created) {
     return EXIT_FAILURE;
   }
   window.SetQuitOnClose(true);
@@ -38,6 +65,11 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
     ::DispatchMessage(&msg);
   }
 
+  if (fast_start) {
+    SaveWindowPlacement({window.GetNormalFrame(), window.GetNormalFrameDpi(),
+                         window.WasMaximized()});
+  }
+
   ::CoUninitialize();
   return EXIT_SUCCESS;
 }
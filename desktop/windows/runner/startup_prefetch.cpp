@@ -0,0 +1,86 @@
+#include "startup_prefetch.h"
+
+#include <windows.h>
+
+#include <vector>
+
+namespace {
+
+// Size of a single read; large enough for the disk to stream.
+constexpr DWORD kReadChunkSize = 1 << 20;
+
+// Returns the directory holding the running executable.
+std::filesystem::path GetExecutableDirectory() {
+  wchar_t path[MAX_PATH];
+  DWORD length = GetModuleFileName(nullptr, path, MAX_PATH);
+  if (length == 0 || length == MAX_PATH) {
+    return std::filesystem::path();
+  }
+  return std::filesystem::path(path).parent_path();
+}
+
+bool IsFontFile(const std::filesystem::path& file) {
+  std::wstring extension = file.extension().wstring();
+  return _wcsicmp(extension.c_str(), L".ttf") == 0 ||
+         _wcsicmp(extension.c_str(), L".otf") == 0;
+}
+
+}  // namespace
+
+StartupPrefetch::~StartupPrefetch() {
+  cancelled_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void StartupPrefetch::Start() {
+  if (thread_.joinable()) {
+    return;
+  }
+  std::filesystem::path executable_directory = GetExecutableDirectory();
+  if (executable_directory.empty()) {
+    return;
+  }
+  thread_ = std::thread(&StartupPrefetch::Run, this,
+                        executable_directory / L"data");
+}
+
+void StartupPrefetch::Run(const std::filesystem::path& data_directory) {
+  // Leave the CPU to the main thread; this one mostly waits for the disk.
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+  // In the order the engine opens them.
+  PrefetchFile(data_directory / L"icudtl.dat");
+  PrefetchFile(data_directory / L"app.so");
+
+  std::filesystem::path assets = data_directory / L"flutter_assets";
+  PrefetchFile(assets / L"FontManifest.json");
+  std::error_code error;
+  for (std::filesystem::recursive_directory_iterator it(assets, error), end;
+       !error && it != end && !cancelled_; it.increment(error)) {
+    if (it->is_regular_file(error) && IsFontFile(it->path())) {
+      PrefetchFile(it->path());
+    }
+  }
+}
+
+void StartupPrefetch::PrefetchFile(const std::filesystem::path& file) {
+  if (cancelled_) {
+    return;
+  }
+  // Missing files, e.g. app.so in debug builds, are simply skipped.
+  HANDLE handle = CreateFile(file.c_str(), GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  std::vector<char> buffer(kReadChunkSize);
+  DWORD read = 0;
+  while (!cancelled_ &&
+         ReadFile(handle, buffer.data(), kReadChunkSize, &read, nullptr) &&
+         read > 0) {
+  }
+  CloseHandle(handle);
+}
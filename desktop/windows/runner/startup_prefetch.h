@@ -0,0 +1,37 @@
+#ifndef RUNNER_STARTUP_PREFETCH_H_
+#define RUNNER_STARTUP_PREFETCH_H_
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+// Reads the files the engine loads first - the AOT snapshot, the ICU data
+// and the bundled fonts - on a background thread while the window is being
+// set up, so that the engine finds them in the file cache instead of waiting
+// for the disk on a cold start.
+class StartupPrefetch {
+ public:
+  StartupPrefetch() = default;
+  ~StartupPrefetch();
+
+  // Prevent copying.
+  StartupPrefetch(StartupPrefetch const&) = delete;
+  StartupPrefetch& operator=(StartupPrefetch const&) = delete;
+
+  // Starts reading the bundle's "data" directory next to the executable.
+  // Does nothing if the prefetch is already running.
+  void Start();
+
+ private:
+  // Reads the files below |data_directory| until done or cancelled.
+  void Run(const std::filesystem::path& data_directory);
+
+  // Reads |file| to its end and discards the contents.
+  void PrefetchFile(const std::filesystem::path& file);
+
+  std::thread thread_;
+
+  std::atomic<bool> cancelled_{false};
+};
+
+#endif  // RUNNER_STARTUP_PREFETCH_H_
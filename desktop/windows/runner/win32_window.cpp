@@ -30,6 +30,12 @@ constexpr const wchar_t kGetPreferredBrightnessRegValue[] = L"AppsUseLightTheme"
 // The number of Win32Window objects that currently exist.
 static int g_active_window_count = 0;
 
+// Timer that applies the last of a burst of coalesced size changes.
+constexpr UINT_PTR kResizeTimerId = 1;
+
+// Refresh interval assumed when the display does not report its rate.
+constexpr UINT kDefaultFrameIntervalMs = 16;
+
 using EnableNonClientDpiScaling = BOOL __stdcall(HWND hwnd);
 
 // Scale helper to convert logical scaler values to physical using passed in
@@ -54,6 +60,27 @@ void EnableFullDpiSupportIfAvailable(HWND hwnd) {
   FreeLibrary(user32_module);
 }
 
+// Returns the duration of one refresh of the monitor showing |hwnd|, in
+// milliseconds, no shorter than the timer resolution.
+UINT GetFrameIntervalMs(HWND hwnd) {
+  MONITORINFOEX monitor_info{};
+  monitor_info.cbSize = sizeof(monitor_info);
+  HMONITOR monitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST);
+  if (!GetMonitorInfo(monitor, &monitor_info)) {
+    return kDefaultFrameIntervalMs;
+  }
+  DEVMODE mode{};
+  mode.dmSize = sizeof(mode);
+  // 0 and 1 stand for the hardware's default rate.
+  if (!EnumDisplaySettings(monitor_info.szDevice, ENUM_CURRENT_SETTINGS,
+                           &mode) ||
+      mode.dmDisplayFrequency <= 1) {
+    return kDefaultFrameIntervalMs;
+  }
+  UINT interval = 1000 / mode.dmDisplayFrequency;
+  return interval < USER_TIMER_MINIMUM ? USER_TIMER_MINIMUM : interval;
+}
+
 }  // namespace
 
 // Manages the Win32Window's window class registration.
@@ -124,27 +151,42 @@ Win32Window::~Win32Window() {
 bool Win32Window::Create(const std::wstring& title,
                          const Point& origin,
                          const Size& size) {
-  Destroy();
-
-  const wchar_t* window_class =
-      WindowClassRegistrar::GetInstance()->GetWindowClass();
-
   const POINT target_point = {static_cast<LONG>(origin.x),
                               static_cast<LONG>(origin.y)};
   HMONITOR monitor = MonitorFromPoint(target_point, MONITOR_DEFAULTTONEAREST);
   UINT dpi = FlutterDesktopGetDpiForMonitor(monitor);
   double scale_factor = dpi / 96.0;
 
+  RECT frame;
+  frame.left = Scale(origin.x, scale_factor);
+  frame.top = Scale(origin.y, scale_factor);
+  frame.right = frame.left + Scale(size.width, scale_factor);
+  frame.bottom = frame.top + Scale(size.height, scale_factor);
+  return Create(title, frame);
+}
+
+bool Win32Window::Create(const std::wstring& title, const RECT& frame) {
+  Destroy();
+
+  const wchar_t* window_class =
+      WindowClassRegistrar::GetInstance()->GetWindowClass();
+
   HWND window = CreateWindow(
       window_class, title.c_str(), WS_POPUP | WS_THICKFRAME | WS_MINIMIZEBOX | WS_MAXIMIZEBOX | WS_CLIPCHILDREN,
-      Scale(origin.x, scale_factor), Scale(origin.y, scale_factor),
-      Scale(size.width, scale_factor), Scale(size.height, scale_factor),
+      frame.left, frame.top, frame.right - frame.left,
+      frame.bottom - frame.top,
       nullptr, nullptr, GetModuleHandle(nullptr), this);
 
   if (!window) {
     return false;
   }
 
+  normal_frame_ = frame;
+  normal_frame_dpi_ = FlutterDesktopGetDpiForHWND(window);
+  if (coalesce_resize_) {
+    frame_interval_ms_ = GetFrameIntervalMs(window);
+  }
+
   UpdateTheme(window);
 
   if (OnCreate()) {
@@ -155,7 +197,8 @@ bool Win32Window::Create(const std::wstring& title,
 }
 
 bool Win32Window::Show() {
-  return ShowWindow(window_handle_, SW_SHOWNORMAL);
+  return ShowWindow(window_handle_,
+                    show_maximized_ ? SW_SHOWMAXIMIZED : SW_SHOWNORMAL);
 }
 
 // static
@@ -193,6 +236,7 @@ Win32Window::MessageHandler(HWND hwnd,
       return 0;
 
     case WM_DPICHANGED: {
+      normal_frame_dpi_ = HIWORD(wparam);
       auto newRectSize = reinterpret_cast<RECT*>(lparam);
       LONG newWidth = newRectSize->right - newRectSize->left;
       LONG newHeight = newRectSize->bottom - newRectSize->top;
@@ -203,17 +247,55 @@ Win32Window::MessageHandler(HWND hwnd,
       return 0;
     }
     case WM_SIZE: {
-      RECT rect = GetClientArea();
-      if (child_content_ != nullptr) {
-        // Size and position the child window.
-        MoveWindow(child_content_, rect.left, rect.top, rect.right - rect.left,
-                   rect.bottom - rect.top, TRUE);
+      if (wparam == SIZE_MAXIMIZED) {
+        maximized_ = true;
+      } else if (wparam == SIZE_RESTORED) {
+        maximized_ = false;
+        UpdateNormalFrame(hwnd);
       }
       // Reapply rounded corners after resize
       ApplyRoundedCorners();
+      if (coalesce_resize_ && child_content_ != nullptr) {
+        // Every new size means a new surface for the engine; within one
+        // refresh interval of the last resize only the latest one counts.
+        ULONGLONG elapsed = GetTickCount64() - last_resize_tick_;
+        if (elapsed < frame_interval_ms_) {
+          if (!resize_pending_) {
+            resize_pending_ = true;
+            SetTimer(hwnd, kResizeTimerId,
+                     static_cast<UINT>(frame_interval_ms_ - elapsed), nullptr);
+          }
+          return 0;
+        }
+      }
+      ResizeChildContent();
       return 0;
     }
 
+    case WM_MOVE:
+      UpdateNormalFrame(hwnd);
+      break;
+
+    case WM_TIMER:
+      if (wparam == kResizeTimerId) {
+        ResizeChildContent();
+        return 0;
+      }
+      break;
+
+    case WM_ENTERSIZEMOVE:
+      // The window may have been moved to a display with another rate.
+      if (coalesce_resize_) {
+        frame_interval_ms_ = GetFrameIntervalMs(hwnd);
+      }
+      break;
+
+    case WM_EXITSIZEMOVE:
+      if (resize_pending_) {
+        ResizeChildContent();
+      }
+      break;
+
     case WM_ACTIVATE:
       if (child_content_ != nullptr) {
         SetFocus(child_content_);
@@ -317,6 +399,53 @@ RECT Win32Window::GetClientArea() {
   return frame;
 }
 
+void Win32Window::SetShowMaximized(bool show_maximized) {
+  show_maximized_ = show_maximized;
+}
+
+void Win32Window::SetResizeCoalescing(bool coalesce_resize) {
+  coalesce_resize_ = coalesce_resize;
+  if (coalesce_resize_ && window_handle_) {
+    frame_interval_ms_ = GetFrameIntervalMs(window_handle_);
+  } else if (!coalesce_resize_ && resize_pending_) {
+    ResizeChildContent();
+  }
+}
+
+RECT Win32Window::GetNormalFrame() {
+  return normal_frame_;
+}
+
+UINT Win32Window::GetNormalFrameDpi() {
+  return normal_frame_dpi_;
+}
+
+bool Win32Window::WasMaximized() {
+  return maximized_;
+}
+
+void Win32Window::ResizeChildContent() {
+  if (resize_pending_) {
+    KillTimer(window_handle_, kResizeTimerId);
+    resize_pending_ = false;
+  }
+  last_resize_tick_ = GetTickCount64();
+  if (child_content_ == nullptr) {
+    return;
+  }
+  // Size and position the child window.
+  RECT rect = GetClientArea();
+  MoveWindow(child_content_, rect.left, rect.top, rect.right - rect.left,
+             rect.bottom - rect.top, TRUE);
+}
+
+void Win32Window::UpdateNormalFrame(HWND hwnd) {
+  if (IsZoomed(hwnd) || IsIconic(hwnd)) {
+    return;
+  }
+  GetWindowRect(hwnd, &normal_frame_);
+}
+
 HWND Win32Window::GetHandle() {
   return window_handle_;
 }
@@ -36,6 +36,11 @@ class Win32Window {
   // |Show| is called. Returns true if the window was created successfully.
   bool Create(const std::wstring& title, const Point& origin, const Size& size);
 
+  // Creates the window with its outer frame at |frame|, given in physical
+  // pixels, e.g. a geometry saved by an earlier run. Otherwise behaves like
+  // the overload above.
+  bool Create(const std::wstring& title, const RECT& frame);
+
   // Show the current window. Returns true if the window was successfully shown.
   bool Show();
 
@@ -55,6 +60,23 @@ class Win32Window {
   // Return a RECT representing the bounds of the current client area.
   RECT GetClientArea();
 
+  // If true, |Show| maximizes the window instead of showing it at its frame.
+  void SetShowMaximized(bool show_maximized);
+
+  // If true, size changes reach the hosted content at most once per refresh
+  // of the display the window is on. The last size of a burst is always
+  // applied, at the latest one refresh interval later.
+  void SetResizeCoalescing(bool coalesce_resize);
+
+  // Return the outer frame of the window in its normal (neither maximized nor
+  // minimized) state, in physical pixels, and the DPI it was last shown at.
+  // Both remain available after the window has been destroyed.
+  RECT GetNormalFrame();
+  UINT GetNormalFrameDpi();
+
+  // Return whether the window was maximized when last shown or destroyed.
+  bool WasMaximized();
+
  protected:
   // Processes and route salient window messages for mouse handling,
   // size change and DPI. Delegates handling of these to member overloads that
@@ -93,8 +115,34 @@ class Win32Window {
   // Apply rounded corners to the window.
   void ApplyRoundedCorners();
 
+  // Size and position the child window to fill the client area, dropping a
+  // pending coalesced resize.
+  void ResizeChildContent();
+
+  // Record the current frame if the window is in its normal state.
+  void UpdateNormalFrame(HWND hwnd);
+
   bool quit_on_close_ = false;
 
+  bool show_maximized_ = false;
+
+  bool coalesce_resize_ = false;
+
+  // Minimum time between two resizes of the child window, in milliseconds.
+  UINT frame_interval_ms_ = 16;
+
+  // Tick count of the last resize of the child window.
+  ULONGLONG last_resize_tick_ = 0;
+
+  // Whether a resize waits for the coalescing timer.
+  bool resize_pending_ = false;
+
+  RECT normal_frame_ = {};
+
+  UINT normal_frame_dpi_ = 96;
+
+  bool maximized_ = false;
+
   // window handle for top level window.
   HWND window_handle_ = nullptr;
 
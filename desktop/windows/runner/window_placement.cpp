@@ -0,0 +1,101 @@
+#include "window_placement.h"
+
+#include <flutter_windows.h>
+
+#include <cstdint>
+
+namespace {
+
+constexpr const wchar_t kPlacementRegKey[] =
+    L"Software\\de.joancode.zen\\desktop";
+constexpr const wchar_t kPlacementRegValue[] = L"WindowPlacement";
+
+// Bumped whenever the layout of StoredPlacement changes.
+constexpr uint32_t kPlacementVersion = 1;
+
+// Smallest frame worth restoring, in physical pixels.
+constexpr LONG kMinimumFrameSize = 200;
+
+struct StoredPlacement {
+  uint32_t version;
+  int32_t left;
+  int32_t top;
+  int32_t right;
+  int32_t bottom;
+  uint32_t dpi;
+  uint32_t maximized;
+};
+
+}  // namespace
+
+bool LoadWindowPlacement(WindowPlacement* placement) {
+  StoredPlacement stored;
+  DWORD stored_size = sizeof(stored);
+  LSTATUS result =
+      RegGetValue(HKEY_CURRENT_USER, kPlacementRegKey, kPlacementRegValue,
+                  RRF_RT_REG_BINARY, nullptr, &stored, &stored_size);
+  if (result != ERROR_SUCCESS || stored_size != sizeof(stored) ||
+      stored.version != kPlacementVersion || stored.dpi == 0) {
+    return false;
+  }
+
+  RECT frame = {stored.left, stored.top, stored.right, stored.bottom};
+  if (frame.right - frame.left < kMinimumFrameSize ||
+      frame.bottom - frame.top < kMinimumFrameSize) {
+    return false;
+  }
+  // The monitor may have been unplugged or rearranged since.
+  HMONITOR monitor = MonitorFromRect(&frame, MONITOR_DEFAULTTONULL);
+  if (!monitor) {
+    return false;
+  }
+
+  // Keep the logical size when the monitor's scale changed in between.
+  UINT dpi = FlutterDesktopGetDpiForMonitor(monitor);
+  if (dpi != stored.dpi) {
+    frame.right = frame.left + MulDiv(frame.right - frame.left, dpi, stored.dpi);
+    frame.bottom = frame.top + MulDiv(frame.bottom - frame.top, dpi, stored.dpi);
+  }
+
+  placement->frame = frame;
+  placement->dpi = dpi;
+  placement->maximized = stored.maximized != 0;
+  return true;
+}
+
+void SaveWindowPlacement(const WindowPlacement& placement) {
+  StoredPlacement stored;
+  stored.version = kPlacementVersion;
+  stored.left = placement.frame.left;
+  stored.top = placement.frame.top;
+  stored.right = placement.frame.right;
+  stored.bottom = placement.frame.bottom;
+  stored.dpi = placement.dpi;
+  stored.maximized = placement.maximized ? 1 : 0;
+  RegSetKeyValue(HKEY_CURRENT_USER, kPlacementRegKey, kPlacementRegValue,
+                 REG_BINARY, &stored, sizeof(stored));
+}
+
+WindowPlacement DefaultWindowPlacement(unsigned int width,
+                                       unsigned int height) {
+  const POINT origin = {0, 0};
+  HMONITOR monitor = MonitorFromPoint(origin, MONITOR_DEFAULTTOPRIMARY);
+  MONITORINFO monitor_info{};
+  monitor_info.cbSize = sizeof(monitor_info);
+  GetMonitorInfo(monitor, &monitor_info);
+  const RECT& work_area = monitor_info.rcWork;
+
+  WindowPlacement placement;
+  placement.dpi = FlutterDesktopGetDpiForMonitor(monitor);
+  LONG frame_width = MulDiv(width, placement.dpi, 96);
+  LONG frame_height = MulDiv(height, placement.dpi, 96);
+  // Pinned to the top left corner when larger than the work area.
+  LONG left_margin = (work_area.right - work_area.left - frame_width) / 2;
+  LONG top_margin = (work_area.bottom - work_area.top - frame_height) / 2;
+  placement.frame.left = work_area.left + (left_margin > 0 ? left_margin : 0);
+  placement.frame.top = work_area.top + (top_margin > 0 ? top_margin : 0);
+  placement.frame.right = placement.frame.left + frame_width;
+  placement.frame.bottom = placement.frame.top + frame_height;
+  placement.maximized = false;
+  return placement;
+}
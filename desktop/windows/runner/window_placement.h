@@ -0,0 +1,29 @@
+#ifndef RUNNER_WINDOW_PLACEMENT_H_
+#define RUNNER_WINDOW_PLACEMENT_H_
+
+#include <windows.h>
+
+// Geometry of the main window, kept across runs by the fast-start mode so
+// the window - and the engine's first surface - starts at its final size.
+struct WindowPlacement {
+  // Outer frame in its normal state, in physical pixels.
+  RECT frame;
+  // DPI of the monitor |frame| was on.
+  UINT dpi;
+  bool maximized;
+};
+
+// Reads the placement saved by the last run into |placement|. Returns false
+// if there is none or if no connected monitor shows any part of it anymore.
+// The frame is rescaled when its monitor's DPI changed in the meantime.
+bool LoadWindowPlacement(WindowPlacement* placement);
+
+// Stores |placement| for the next run.
+void SaveWindowPlacement(const WindowPlacement& placement);
+
+// Returns a placement of |width| x |height| logical pixels, centered in the
+// work area of the primary monitor.
+WindowPlacement DefaultWindowPlacement(unsigned int width,
+                                       unsigned int height);
+
+#endif  // RUNNER_WINDOW_PLACEMENT_H_
@@ -0,0 +1,95 @@
+#include "alloc_debug.h"
+
+#if ZEN_ALLOC_DEBUG
+
+#include "zen_log.h"
+
+namespace {
+
+constexpr uint8_t ALLOC_DEBUG_MAX_TASKS = 4;
+
+// Each slot is written only by its own task once registered
+struct TrackedTask {
+  TaskHandle_t task;
+  uint32_t unexpected;
+  uint32_t reported;
+  uint16_t allowDepth;
+};
+
+TrackedTask trackedTasks[ALLOC_DEBUG_MAX_TASKS];
+volatile uint8_t trackedCount = 0;
+portMUX_TYPE trackMux = portMUX_INITIALIZER_UNLOCKED;
+
+TrackedTask* currentSlot() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  for (uint8_t i = 0; i < trackedCount; ++i) {
+    if (trackedTasks[i].task == self) return &trackedTasks[i];
+  }
+  return nullptr;
+}
+
+void countAllocation() {
+  TrackedTask* slot = currentSlot();
+  if (slot && slot->allowDepth == 0) {
+    ++slot->unexpected;
+  }
+}
+
+}  // namespace
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  countAllocation();
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  countAllocation();
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  countAllocation();
+  return __real_realloc(ptr, size);
+}
+}
+
+void allocDebugTrackCurrentTask() {
+  portENTER_CRITICAL(&trackMux);
+  if (!currentSlot() && trackedCount < ALLOC_DEBUG_MAX_TASKS) {
+    TrackedTask& slot = trackedTasks[trackedCount];
+    slot.task = xTaskGetCurrentTaskHandle();
+    slot.unexpected = 0;
+    slot.reported = 0;
+    slot.allowDepth = 0;
+    ++trackedCount;
+  }
+  portEXIT_CRITICAL(&trackMux);
+}
+
+uint32_t allocDebugReport(const char* where) {
+  TrackedTask* slot = currentSlot();
+  if (!slot) return 0;
+  uint32_t fresh = slot->unexpected - slot->reported;
+  slot->reported = slot->unexpected;
+  if (fresh > 0) {
+    ZEN_LOGW("[alloc] steady-state heap allocations in %s: %lu", where, static_cast<unsigned long>(fresh));
+  }
+  return fresh;
+}
+
+AllocAllowed::AllocAllowed() {
+  TrackedTask* slot = currentSlot();
+  if (slot) ++slot->allowDepth;
+}
+
+AllocAllowed::~AllocAllowed() {
+  TrackedTask* slot = currentSlot();
+  if (slot) --slot->allowDepth;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Debug counter for heap allocations on the firmware's own tasks.
+//
+// Steady-state passes of the network and render tasks are meant to run
+// without touching the heap. Only the HTTP client, Wi-Fi connect and
+// ArduinoJson documents (ArduinoJson 7 keeps them on the heap) are expected
+// to allocate, and those calls are wrapped in narrow AllocAllowed scopes;
+// decoding, layout, persistence and drawing are counted. Build with ZEN_ALLOC_DEBUG=1 and link with
+//   -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+// (see platformio.ini) to count every other allocation made by a tracked
+// task; allocDebugReport() logs any that happened since its last call.
+// Without the flag everything here compiles to nothing.
+#ifndef ZEN_ALLOC_DEBUG
+#define ZEN_ALLOC_DEBUG 0
+#endif
+
+#if ZEN_ALLOC_DEBUG
+
+// Starts counting allocations made by the calling task.
+void allocDebugTrackCurrentTask();
+// Logs allocations made outside AllocAllowed scopes since the previous call
+// from this task. Returns how many there were.
+uint32_t allocDebugReport(const char* where);
+
+class AllocAllowed {
+ public:
+  AllocAllowed();
+  ~AllocAllowed();
+  AllocAllowed(const AllocAllowed&) = delete;
+  AllocAllowed& operator=(const AllocAllowed&) = delete;
+};
+
+#else
+
+inline void allocDebugTrackCurrentTask() {}
+inline uint32_t allocDebugReport(const char*) { return 0; }
+
+class AllocAllowed {
+ public:
+  AllocAllowed() {}
+};
+
+#endif
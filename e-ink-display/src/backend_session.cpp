@@ -0,0 +1,92 @@
+#include "backend_session.h"
+
+#include "alloc_debug.h"
+#include "perf_metrics.h"
+#include "zen_log.h"
+
+void BackendSession::useEndpoint(uint8_t index) {
+  reset();
+  endpoint_ = index;
+  generation_ = endpoints_.generation();
+  // "https://host[:port][/...]"
+  const char* baseUrl = endpoints_.url(index);
+  const char* host = strstr(baseUrl, "://");
+  host = host ? host + 3 : baseUrl;
+  size_t len = strcspn(host, ":/");
+  if (len >= sizeof(host_)) len = sizeof(host_) - 1;
+  memcpy(host_, host, len);
+  host_[len] = '\0';
+  port_ = host[len] == ':' ? static_cast<uint16_t>(atoi(host + len + 1)) : 443;
+}
+
+HTTPClient* BackendSession::begin(const char* path) {
+  AllocAllowed allow;  // HTTPClient parses the URL into Strings
+  if (active_) {
+    end();
+  }
+  uint8_t index = endpoints_.select();
+  if (index != endpoint_ || generation_ != endpoints_.generation()) {
+    useEndpoint(index);
+  }
+  timeoutMs_ = endpoints_.timeoutMs(index);
+  // Same trust model as the previous per-request HTTPClient::begin(url)
+  client_.setInsecure();
+  http_.setReuse(true);
+  http_.setConnectTimeout(timeoutMs_);
+  http_.setTimeout(timeoutMs_ > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(timeoutMs_));
+  snprintf(url_, sizeof(url_), "%s%s", endpoints_.url(index), path);
+  if (!http_.begin(client_, url_)) {
+    return nullptr;
+  }
+  active_ = true;
+  return &http_;
+}
+
+int BackendSession::send(const char* method, const char* body, size_t length) {
+  // HTTPClient takes a mutable pointer but only reads the payload
+  uint8_t* payload = reinterpret_cast<uint8_t*>(const_cast<char*>(body));
+  AllocAllowed allow;  // TLS setup, the request line and the response headers
+  bool reused = client_.connected();
+  connect();
+  unsigned long started = millis();
+  int code = http_.sendRequest(method, payload, length);
+  if (code < 0 && reused) {
+    // The server may have closed the idle keep-alive socket; reconnect once.
+    // HTTPClient keeps the request headers, so the retry is identical. A
+    // fresh connection that failed is not retried: the endpoint is down.
+    ZEN_LOGW("Backend request failed, reconnecting: %d", code);
+    client_.stop();
+    connect();
+    started = millis();
+    code = http_.sendRequest(method, payload, length);
+  }
+  // A gateway error means the node behind the proxy is in trouble
+  if (code < 0 || code >= 500) {
+    endpoints_.reportFailure(endpoint_);
+  } else {
+    endpoints_.reportSuccess(endpoint_, millis() - started);
+  }
+  return code;
+}
+
+void BackendSession::end() {
+  if (!active_) return;
+  AllocAllowed allow;
+  http_.end();
+  active_ = false;
+}
+
+void BackendSession::connect() {
+  if (client_.connected()) return;
+  PerfTimer timer(PerfMetric::TlsHandshake);
+  if (!client_.connect(host_, port_, timeoutMs_)) {
+    // Leave it to HTTPClient, which reports the failure as a request error
+    timer.cancel();
+  }
+}
+
+void BackendSession::reset() {
+  AllocAllowed allow;
+  end();
+  client_.stop();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+#include "endpoint_pool.h"
+
+// Keeps one TLS connection to the backend open across requests so the
+// periodic state fetch and heartbeat don't pay a TCP + TLS handshake every
+// time. A request that fails on a stale socket is retried once on a fresh
+// connection. New connections are opened here rather than inside HTTPClient
+// so the TLS handshake can be timed on its own.
+//
+// Each request goes to the endpoint the pool selects, with the timeout the
+// pool gives it; its outcome and response time are reported back.
+//
+// Usage:
+//   HTTPClient* http = session.begin(STATE_ENDPOINT);
+//   if (!http) return false;
+//   http->addHeader(...);
+//   int code = session.send("GET");
+//   ... read the response from *http ...
+//   session.end();
+//
+// begin(), send() and end() are allowed to allocate (see alloc_debug.h);
+// addHeader() and header() on the client are not covered and need their
+// own AllocAllowed scope.
+class BackendSession {
+ public:
+  explicit BackendSession(EndpointPool& endpoints) : endpoints_(endpoints) {}
+
+  // Prepares the shared client for a request to the endpoint's URL + path.
+  HTTPClient* begin(const char* path);
+  // Sends the prepared request; negative codes are transport errors.
+  int send(const char* method, const char* body = nullptr, size_t length = 0);
+  // Finishes the response; the socket stays open for reuse when allowed.
+  void end();
+  // Drops the connection, e.g. after Wi-Fi reconnects.
+  void reset();
+
+ private:
+  // Switches to endpoint index and parses its host
+  void useEndpoint(uint8_t index);
+  // Opens the TLS connection ahead of HTTPClient, which then reuses it
+  void connect();
+
+  EndpointPool& endpoints_;
+  uint8_t endpoint_ = 0;
+  uint32_t generation_ = UINT32_MAX;  // of the pool's list when host_ was parsed
+  uint32_t timeoutMs_ = 0;
+  char url_[160] = {};
+  char host_[64] = {};
+  uint16_t port_ = 443;
+  WiFiClientSecure client_;
+  HTTPClient http_;
+  bool active_ = false;
+};
@@ -0,0 +1,198 @@
+#include "ble_provisioning.h"
+
+#include <cstring>
+
+#include "zen_log.h"
+
+static constexpr char BLE_SERVICE_UUID[] = "7c2c2001-3e64-4d89-a6fb-01bd1e78b541";
+static constexpr char BLE_CREDENTIALS_CHAR_UUID[] = "7c2c2002-3e64-4d89-a6fb-01bd1e78b541";
+static constexpr char BLE_PAIRING_CHAR_UUID[] = "7c2c2003-3e64-4d89-a6fb-01bd1e78b541";
+static constexpr char BLE_STATUS_CHAR_UUID[] = "7c2c2004-3e64-4d89-a6fb-01bd1e78b541";
+// 251 byte link-layer payload with data length extension, minus the L2CAP header
+static constexpr uint16_t BLE_PREFERRED_MTU = 247;
+static constexpr uint8_t BLE_FRAME_VERSION = 0x01;
+static constexpr size_t BLE_FRAME_MAX = 1 + (1 + BLE_SSID_MAX) + (1 + BLE_PASSWORD_MAX) + (1 + BLE_URL_MAX);
+// An ATT write carries MTU - 3 bytes
+static_assert(BLE_FRAME_MAX <= BLE_PREFERRED_MTU - 3, "a full credentials frame fits into one write");
+
+// Guards received_ between the NimBLE host task and the network task
+static portMUX_TYPE credentialsMux = portMUX_INITIALIZER_UNLOCKED;
+// Orders status notifications against a credentials write, so a status of
+// the old credentials that was decided before the write cannot follow its
+// Connecting
+static StaticSemaphore_t statusLockBuffer;
+static SemaphoreHandle_t statusLock = nullptr;
+
+// Statuses while a credentials write waits for takeCredentials(). Anything
+// else comes from the previous credentials, e.g. a fetch that was already
+// running, and would make the app read the old pairing token.
+static bool reportableWhilePending(ProvisioningStatus status) {
+  return status == ProvisioningStatus::Connecting || status == ProvisioningStatus::Rejected;
+}
+
+// Copies one length-prefixed field of a frame; false if it overruns the
+// frame or the field's capacity
+static bool readField(const uint8_t*& cursor, const uint8_t* end, char* target, size_t maxLen) {
+  if (cursor >= end) return false;
+  size_t len = *cursor++;
+  if (len > maxLen || len > static_cast<size_t>(end - cursor)) return false;
+  memcpy(target, cursor, len);
+  target[len] = '\0';
+  cursor += len;
+  return true;
+}
+
+static bool parseFrame(const uint8_t* data, size_t length, ProvisioningCredentials& out) {
+  const uint8_t* cursor = data + 1;  // version byte
+  const uint8_t* end = data + length;
+  if (!readField(cursor, end, out.ssid, BLE_SSID_MAX)) return false;
+  if (!readField(cursor, end, out.password, BLE_PASSWORD_MAX)) return false;
+  out.backendUrl[0] = '\0';
+  if (cursor < end && !readField(cursor, end, out.backendUrl, BLE_URL_MAX)) return false;
+  // The backend clients only speak TLS
+  if (out.backendUrl[0] != '\0' && strncmp(out.backendUrl, "https://", 8) != 0) return false;
+  return cursor == end;
+}
+
+// "ssid\npassword", as written by app versions before the framed format
+static bool parseLegacy(const uint8_t* data, size_t length, ProvisioningCredentials& out) {
+  const uint8_t* newline = static_cast<const uint8_t*>(memchr(data, '\n', length));
+  if (!newline) return false;
+  size_t ssidLen = newline - data;
+  size_t passwordLen = length - ssidLen - 1;
+  if (ssidLen > BLE_SSID_MAX || passwordLen > BLE_PASSWORD_MAX) return false;
+  memcpy(out.ssid, data, ssidLen);
+  out.ssid[ssidLen] = '\0';
+  memcpy(out.password, newline + 1, passwordLen);
+  out.password[passwordLen] = '\0';
+  out.backendUrl[0] = '\0';
+  return true;
+}
+
+void BleProvisioning::WriteCallbacks::onWrite(NimBLECharacteristic* characteristic) {
+  NimBLEAttValue value = characteristic->getValue();
+  owner_.handleWrite(value.data(), value.length());
+}
+
+void BleProvisioning::handleWrite(const uint8_t* data, size_t length) {
+  ZEN_LOGD("BLE credentials received, %u bytes", static_cast<unsigned>(length));
+  ProvisioningCredentials parsed;
+  bool ok = length > 0 && (data[0] == BLE_FRAME_VERSION ? parseFrame(data, length, parsed)
+                                                        : parseLegacy(data, length, parsed));
+  if (!ok || parsed.ssid[0] == '\0') {
+    ZEN_LOGW("Malformed credentials write");
+    setStatus(ProvisioningStatus::Rejected);
+    return;
+  }
+  xSemaphoreTake(statusLock, portMAX_DELAY);
+  portENTER_CRITICAL(&credentialsMux);
+  received_ = parsed;
+  pending_ = true;
+  portEXIT_CRITICAL(&credentialsMux);
+  // Acknowledged right away: until the network task takes them, the app
+  // hears nothing but this
+  notifyStatus(ProvisioningStatus::Connecting);
+  xSemaphoreGive(statusLock);
+  ZEN_LOGI("Credentials received for SSID %s", parsed.ssid);
+}
+
+bool BleProvisioning::takeCredentials(ProvisioningCredentials& out) {
+  if (!pending_) return false;
+  portENTER_CRITICAL(&credentialsMux);
+  out = received_;
+  pending_ = false;
+  portEXIT_CRITICAL(&credentialsMux);
+  return true;
+}
+
+void BleProvisioning::start(const char* name) {
+  if (active()) {
+    ensureAdvertising();
+    return;
+  }
+  ZEN_LOGI("Starting BLE as %s", name);
+  if (!statusLock) statusLock = xSemaphoreCreateMutexStatic(&statusLockBuffer);
+  NimBLEDevice::init(name);
+  // Pairing happens at arm's length; the default +3 dBm reaches across a room
+  NimBLEDevice::setPower(ESP_PWR_LVL_P3);
+  // Offered in the MTU exchange the phone starts after connecting
+  NimBLEDevice::setMTU(BLE_PREFERRED_MTU);
+  server_ = NimBLEDevice::createServer();
+  NimBLEService* service = server_->createService(BLE_SERVICE_UUID);
+
+  NimBLECharacteristic* credentialsChar = service->createCharacteristic(
+      BLE_CREDENTIALS_CHAR_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR, BLE_FRAME_MAX);
+  credentialsChar->setCallbacks(&writeCallbacks_);
+  pairingChar_ = service->createCharacteristic(BLE_PAIRING_CHAR_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+  statusChar_ = service->createCharacteristic(BLE_STATUS_CHAR_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+  service->start();
+
+  pairingChar_->setValue(reinterpret_cast<uint8_t*>(pairingValue_), strlen(pairingValue_));
+  statusValue_ = static_cast<uint8_t>(ProvisioningStatus::Idle);
+  statusChar_->setValue(&statusValue_, 1);
+
+  NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
+  advertising->addServiceUUID(BLE_SERVICE_UUID);
+  advertising->setScanResponse(true);
+  advertising->start();
+  ZEN_LOGD("BLE advertising service %s", BLE_SERVICE_UUID);
+}
+
+void BleProvisioning::stop() {
+  if (!active()) return;
+  // clearAll also frees the host stack, the server and its attributes
+  NimBLEDevice::deinit(true);
+  server_ = nullptr;
+  pairingChar_ = nullptr;
+  statusChar_ = nullptr;
+  ZEN_LOGI("BLE stopped");
+}
+
+bool BleProvisioning::connected() const {
+  return server_ && server_->getConnectedCount() > 0;
+}
+
+void BleProvisioning::ensureAdvertising() {
+  if (!active()) return;
+  NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
+  if (advertising && !advertising->isAdvertising()) {
+    advertising->start();
+  }
+}
+
+void BleProvisioning::rename(const char* name) {
+  if (!active()) return;
+  NimBLEDevice::setDeviceName(name);
+  ensureAdvertising();
+}
+
+void BleProvisioning::setPairingInfo(const char* deviceId, const char* token) {
+  snprintf(pairingValue_, sizeof(pairingValue_), "{\"deviceId\":\"%s\",\"token\":\"%s\"}", deviceId, token);
+  if (!pairingChar_) return;
+  // The value holds the pairing token: never log it
+  ZEN_LOGD("Pairing characteristic updated");
+  pairingChar_->setValue(reinterpret_cast<uint8_t*>(pairingValue_), strlen(pairingValue_));
+  pairingChar_->notify();
+}
+
+void BleProvisioning::setStatus(ProvisioningStatus status) {
+  if (!statusChar_) {
+    statusValue_ = static_cast<uint8_t>(status);
+    return;  // BLE not started (yet): nobody to tell
+  }
+  xSemaphoreTake(statusLock, portMAX_DELAY);
+  if (pending_ && !reportableWhilePending(status)) {
+    xSemaphoreGive(statusLock);
+    ZEN_LOGD("BLE status %u held back: new credentials pending", static_cast<unsigned>(status));
+    return;
+  }
+  notifyStatus(status);
+  xSemaphoreGive(statusLock);
+}
+
+void BleProvisioning::notifyStatus(ProvisioningStatus status) {
+  statusValue_ = static_cast<uint8_t>(status);
+  statusChar_->setValue(&statusValue_, 1);
+  statusChar_->notify();
+  ZEN_LOGD("BLE status: %u", static_cast<unsigned>(statusValue_));
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+// Progress the status characteristic reports to the phone app, as a single
+// byte. Values are part of the BLE protocol: append, never renumber.
+enum class ProvisioningStatus : uint8_t {
+  Idle = 0,
+  Connecting = 1,       // credentials received, joining Wi-Fi
+  WifiConnected = 2,
+  WifiFailed = 3,       // the network rejected the credentials or was not found
+  Registered = 4,       // the pairing characteristic holds a token
+  WaitingForClaim = 5,
+  Ready = 6,            // claimed and showing fetched content
+  Rejected = 7,         // the last credentials write could not be parsed
+};
+
+// Limits of one credentials write, NUL excluded
+static constexpr size_t BLE_SSID_MAX = 32;
+static constexpr size_t BLE_PASSWORD_MAX = 64;
+static constexpr size_t BLE_URL_MAX = 127;
+
+struct ProvisioningCredentials {
+  char ssid[BLE_SSID_MAX + 1];
+  char password[BLE_PASSWORD_MAX + 1];
+  char backendUrl[BLE_URL_MAX + 1];  // empty: keep the current backend
+};
+
+// GATT service the phone app provisions the display through. The link asks
+// for a 247 byte ATT MTU, so a whole credentials frame fits into one write
+// and one link-layer packet:
+//
+//   0x01 | len | SSID | len | password [| len | backend URL]
+//
+// with one length byte per field. The older "ssid\npassword" text write is
+// still accepted. Status changes are notified as ProvisioningStatus codes;
+// a valid write is answered with Connecting before anything else.
+//
+// BLE is only needed until the display is claimed; stop() tears the stack
+// down and hands its heap back rather than leaving it advertising.
+class BleProvisioning {
+ public:
+  // Brings the stack up and advertises as name; no-op while active.
+  void start(const char* name);
+  // Deinitializes the stack and frees its memory.
+  void stop();
+  bool active() const { return server_ != nullptr; }
+  // True while a phone is connected.
+  bool connected() const;
+  // Restarts advertising if it stopped, e.g. after a rename.
+  void ensureAdvertising();
+  void rename(const char* name);
+
+  void setPairingInfo(const char* deviceId, const char* token);
+  // Notifies status. While a credentials write is pending only Connecting
+  // and Rejected go out: the rest would describe the old credentials.
+  void setStatus(ProvisioningStatus status);
+
+  // Moves the credentials of the last valid write into out, once.
+  bool takeCredentials(ProvisioningCredentials& out);
+  // True while a write waits for takeCredentials().
+  bool credentialsPending() const { return pending_; }
+
+ private:
+  class WriteCallbacks : public NimBLECharacteristicCallbacks {
+   public:
+    explicit WriteCallbacks(BleProvisioning& owner) : owner_(owner) {}
+    void onWrite(NimBLECharacteristic* characteristic) override;
+
+   private:
+    BleProvisioning& owner_;
+  };
+
+  // Runs on the NimBLE host task
+  void handleWrite(const uint8_t* data, size_t length);
+  // Sets and notifies the status value; the caller holds the status lock
+  void notifyStatus(ProvisioningStatus status);
+
+  WriteCallbacks writeCallbacks_{*this};
+  NimBLEServer* server_ = nullptr;
+  NimBLECharacteristic* pairingChar_ = nullptr;
+  NimBLECharacteristic* statusChar_ = nullptr;
+  // Characteristic values must outlive the setValue() calls
+  char pairingValue_[256] = {};
+  uint8_t statusValue_ = static_cast<uint8_t>(ProvisioningStatus::Idle);
+  ProvisioningCredentials received_ = {};
+  volatile bool pending_ = false;
+};
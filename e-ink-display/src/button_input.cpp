@@ -0,0 +1,113 @@
+#include "button_input.h"
+
+ButtonInput::ButtonInput(uint32_t debounceMs) : debounceMs_(debounceMs), buttons_{} {}
+
+int ButtonInput::addButton(int pin, int activeLevel, uint32_t longPressMs) {
+  if (count_ >= MAX_BUTTONS || queue_) {
+    return -1;
+  }
+  Button& button = buttons_[count_];
+  button.owner = this;
+  button.index = count_;
+  button.pin = pin;
+  button.activeLevel = activeLevel;
+  button.longPressMs = longPressMs;
+  button.state = State::Released;
+  button.pressedAtUs = 0;
+  button.debounceTimer = nullptr;
+  button.longPressTimer = nullptr;
+  return count_++;
+}
+
+bool ButtonInput::begin(size_t queueDepth) {
+  if (queue_) {
+    return true;
+  }
+  queue_ = xQueueCreate(queueDepth, sizeof(ButtonEvent));
+  if (!queue_) {
+    return false;
+  }
+  for (uint8_t i = 0; i < count_; ++i) {
+    Button& button = buttons_[i];
+    esp_timer_create_args_t args = {};
+    args.arg = &button;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.callback = &ButtonInput::onDebounced;
+    args.name = "btn_debounce";
+    if (esp_timer_create(&args, &button.debounceTimer) != ESP_OK) {
+      return false;
+    }
+    args.callback = &ButtonInput::onLongPress;
+    args.name = "btn_long";
+    if (esp_timer_create(&args, &button.longPressTimer) != ESP_OK) {
+      return false;
+    }
+    if (digitalRead(button.pin) == button.activeLevel) {
+      button.state = State::Pressed;
+      button.pressedAtUs = esp_timer_get_time();
+      startLongPress(button);
+    }
+    attachInterruptArg(digitalPinToInterrupt(button.pin), &ButtonInput::onEdge, &button, CHANGE);
+  }
+  return true;
+}
+
+bool ButtonInput::waitEvent(ButtonEvent& event, TickType_t timeout) {
+  return queue_ && xQueueReceive(queue_, &event, timeout) == pdTRUE;
+}
+
+bool ButtonInput::anyPressed() const {
+  for (uint8_t i = 0; i < count_; ++i) {
+    if (buttons_[i].state != State::Released) return true;
+  }
+  return false;
+}
+
+// GPIO ISR: restart the settle window, sampling happens when it expires
+void IRAM_ATTR ButtonInput::onEdge(void* arg) {
+  Button& button = *static_cast<Button*>(arg);
+  esp_timer_stop(button.debounceTimer);
+  esp_timer_start_once(button.debounceTimer, button.owner->debounceMs_ * 1000ULL);
+}
+
+void ButtonInput::onDebounced(void* arg) {
+  Button& button = *static_cast<Button*>(arg);
+  bool active = digitalRead(button.pin) == button.activeLevel;
+  if (active && button.state == State::Released) {
+    button.state = State::Pressed;
+    button.pressedAtUs = esp_timer_get_time();
+    startLongPress(button);
+    button.owner->post(button, ButtonEventType::Pressed);
+  } else if (!active && button.state != State::Released) {
+    esp_timer_stop(button.longPressTimer);
+    button.owner->post(button, ButtonEventType::Released);
+    button.state = State::Released;
+  }
+}
+
+void ButtonInput::onLongPress(void* arg) {
+  Button& button = *static_cast<Button*>(arg);
+  if (button.state != State::Pressed) return;
+  // An edge may still be settling; only a level that is still active counts
+  if (digitalRead(button.pin) != button.activeLevel) return;
+  button.state = State::Held;
+  button.owner->post(button, ButtonEventType::LongPress);
+}
+
+void ButtonInput::startLongPress(Button& button) {
+  if (button.longPressMs > 0) {
+    esp_timer_stop(button.longPressTimer);
+    esp_timer_start_once(button.longPressTimer, button.longPressMs * 1000ULL);
+  }
+}
+
+void ButtonInput::post(const Button& button, ButtonEventType type) {
+  ButtonEvent event;
+  event.button = button.index;
+  event.type = type;
+  event.heldMs = type == ButtonEventType::Pressed
+      ? 0
+      : static_cast<uint32_t>((esp_timer_get_time() - button.pressedAtUs) / 1000);
+  // Never block the timer task; a full queue means the consumer is stuck
+  xQueueSend(queue_, &event, 0);
+}
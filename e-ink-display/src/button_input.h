@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// GPIO buttons debounced by esp_timer and reported through a FreeRTOS queue.
+// Every edge interrupt re-arms the button's debounce timer; when it expires
+// the level is sampled once and the state machine advances:
+//   Released --stable active----------> Pressed   (Pressed)
+//   Pressed  --held longPressMs-------> Held      (LongPress)
+//   Pressed/Held --stable inactive----> Released  (Released)
+// Timer callbacks all run on the esp_timer task, so the state machine needs
+// no locking. Consumers block in waitEvent() instead of polling pins.
+enum class ButtonEventType : uint8_t { Pressed, LongPress, Released };
+
+struct ButtonEvent {
+  uint8_t button;        // index returned by addButton()
+  ButtonEventType type;
+  uint32_t heldMs;       // LongPress/Released: time since the press
+};
+
+class ButtonInput {
+ public:
+  static constexpr uint8_t MAX_BUTTONS = 4;
+  static constexpr uint32_t DEFAULT_DEBOUNCE_MS = 30;
+
+  explicit ButtonInput(uint32_t debounceMs = DEFAULT_DEBOUNCE_MS);
+
+  // Registers a button before begin(); the pin must already be configured.
+  // longPressMs = 0 disables LongPress. Returns the index, or -1 when full.
+  int addButton(int pin, int activeLevel, uint32_t longPressMs);
+  // Creates the timers and queue and attaches the edge interrupts. A button
+  // already held at this point counts as pressed without a Pressed event,
+  // so a press that woke the chip can still become a LongPress.
+  bool begin(size_t queueDepth = 8);
+  bool waitEvent(ButtonEvent& event, TickType_t timeout);
+  bool anyPressed() const;
+
+ private:
+  enum class State : uint8_t { Released, Pressed, Held };
+
+  struct Button {
+    ButtonInput* owner;
+    uint8_t index;
+    int pin;
+    int activeLevel;
+    uint32_t longPressMs;
+    volatile State state;
+    int64_t pressedAtUs;
+    esp_timer_handle_t debounceTimer;
+    esp_timer_handle_t longPressTimer;
+  };
+
+  static void onEdge(void* arg);
+  static void onDebounced(void* arg);
+  static void onLongPress(void* arg);
+  static void startLongPress(Button& button);
+  void post(const Button& button, ButtonEventType type);
+
+  uint32_t debounceMs_;
+  Button buttons_[MAX_BUTTONS];
+  uint8_t count_ = 0;
+  QueueHandle_t queue_ = nullptr;
+};
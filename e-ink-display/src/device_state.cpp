@@ -0,0 +1,486 @@
+#include "device_state.h"
+
+#include <ArduinoJson.h>
+#include <cstring>
+
+#include "fingerprint.h"
+#include "zen_log.h"
+
+void DeviceStateSnapshot::clear() {
+  memset(this, 0, sizeof(*this));
+}
+
+static void copyField(char* target, size_t capacity, const char* value) {
+  strlcpy(target, value ? value : "", capacity);
+}
+
+uint32_t stateItemId(const char* id) {
+  if (!id || id[0] == '\0') return 0;
+  uint32_t hash = Fnv1a().add(id, strlen(id)).value();
+  return hash ? hash : 1;
+}
+
+static const uint8_t* fieldCapacities(const StateEventList&) { return STATE_EVENT_FIELD_CAPACITY; }
+static const uint8_t* fieldCapacities(const StateMailList&) { return STATE_MAIL_FIELD_CAPACITY; }
+static size_t itemTextMax(const StateEventList&) { return STATE_EVENT_TEXT_MAX; }
+static size_t itemTextMax(const StateMailList&) { return STATE_MAIL_TEXT_MAX; }
+static constexpr size_t fieldsOf(const StateEventList&) { return EVENT_FIELD_COUNT; }
+static constexpr size_t fieldsOf(const StateMailList&) { return MAIL_FIELD_COUNT; }
+
+// True while `list` can take one more item at its longest
+template <typename TList>
+static bool hasItemRoom(const TList& list) {
+  return list.count < TList::CAPACITY && TList::TEXT_BYTES - list.textUsed >= itemTextMax(list);
+}
+
+// Appends one item to a list, field by field. Texts are written at the
+// pool's tail as they arrive and only become part of the list on commit(),
+// so a read that fails halfway leaves the list as it was. Only start one
+// after hasItemRoom().
+template <typename TList>
+class ItemWriter {
+ public:
+  explicit ItemWriter(TList& list) : list_(list), tail_(list.textUsed) {}
+
+  // Buffer for `field` at the pool's tail; finish it with fieldDone()
+  char* field(uint8_t field, size_t& capacity) {
+    list_.textAt[field][list_.count] = tail_;
+    capacity = fieldCapacities(list_)[field];
+    return list_.text + tail_;
+  }
+  void fieldDone() { tail_ += strlen(list_.text + tail_) + 1; }
+
+  void set(uint8_t field, const char* value) {
+    size_t capacity;
+    char* target = this->field(field, capacity);
+    copyField(target, capacity, value);
+    fieldDone();
+  }
+
+  void commit(uint32_t id) {
+    list_.id[list_.count++] = id;
+    list_.textUsed = tail_;
+  }
+
+ private:
+  TList& list_;
+  uint16_t tail_;
+};
+
+template <typename TList>
+static void appendCopy(TList& target, const TList& source, uint8_t index) {
+  ItemWriter<TList> item(target);
+  for (uint8_t field = 0; field < fieldsOf(target); ++field) item.set(field, source.field(field, index));
+  item.commit(source.id[index]);
+}
+
+template <typename TList>
+static int findItem(const TList& list, uint32_t id) {
+  for (uint8_t i = 0; i < list.count; ++i) {
+    if (list.id[i] == id) return i;
+  }
+  return -1;
+}
+
+// Scratch lists for deltas, too large for the network task's stack
+template <typename TList>
+struct DeltaScratch {
+  static TList changed;
+  static TList next;
+};
+template <typename TList>
+TList DeltaScratch<TList>::changed;
+template <typename TList>
+TList DeltaScratch<TList>::next;
+
+template <typename TList>
+static TList& emptyScratch(TList& scratch) {
+  scratch.count = 0;
+  scratch.textUsed = 0;
+  return scratch;
+}
+
+// Rebuilds one list of the table from a delta. `order` is authoritative:
+// each id comes from `changed` when present and is otherwise kept from the
+// table. An id found in neither means the backend diffed against a state
+// this table doesn't hold.
+template <typename TList>
+static bool applySectionDelta(TList& items, const TList& changed, const uint32_t* order, uint8_t orderCount) {
+  TList& next = emptyScratch(DeltaScratch<TList>::next);
+  for (uint8_t i = 0; i < orderCount && hasItemRoom(next); ++i) {
+    if (order[i] == 0) return false;
+    int found = findItem(changed, order[i]);
+    if (found >= 0) {
+      appendCopy(next, changed, found);
+      continue;
+    }
+    found = findItem(items, order[i]);
+    if (found < 0) return false;
+    appendCopy(next, items, found);
+  }
+  items = next;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// JSON
+// -----------------------------------------------------------------------------
+static void buildStateFilter(JsonDocument& filter) {
+  filter["base"] = true;
+  filter["timezone"]["posix"] = true;
+  for (const char* section : {"calendar", "email"}) {
+    filter[section]["connected"] = true;
+    filter[section]["order"] = true;
+  }
+  for (const char* list : {"items", "changed"}) {
+    filter["calendar"][list][0]["id"] = true;
+    filter["calendar"][list][0]["start"] = true;
+    filter["calendar"][list][0]["summary"] = true;
+    filter["calendar"][list][0]["location"] = true;
+    filter["email"][list][0]["id"] = true;
+    filter["email"][list][0]["from"] = true;
+    filter["email"][list][0]["snippet"] = true;
+  }
+}
+
+static void itemFromJson(JsonObjectConst item, StateEventList& events) {
+  ItemWriter<StateEventList> event(events);
+  event.set(EVENT_START, item["start"] | "");
+  event.set(EVENT_SUMMARY, item["summary"] | "");
+  event.set(EVENT_LOCATION, item["location"] | "");
+  event.commit(stateItemId(item["id"] | ""));
+}
+
+static void itemFromJson(JsonObjectConst item, StateMailList& mails) {
+  ItemWriter<StateMailList> mail(mails);
+  mail.set(MAIL_FROM, item["from"] | "");
+  mail.set(MAIL_SNIPPET, item["snippet"] | "");
+  mail.commit(stateItemId(item["id"] | ""));
+}
+
+template <typename TList>
+static bool sectionFromJson(JsonObjectConst section, bool isDelta, bool& connected, TList& items) {
+  connected = section["connected"] | false;
+  TList& target = isDelta ? emptyScratch(DeltaScratch<TList>::changed) : items;
+  if (!isDelta) emptyScratch(items);
+  JsonArrayConst list = section[isDelta ? "changed" : "items"];
+  for (JsonObjectConst item : list) {
+    if (!hasItemRoom(target)) break;
+    itemFromJson(item, target);
+  }
+  if (!isDelta) return true;
+  uint32_t order[TList::CAPACITY];
+  uint8_t orderCount = 0;
+  JsonArrayConst orderList = section["order"];
+  for (JsonVariantConst id : orderList) {
+    if (orderCount >= TList::CAPACITY) break;
+    order[orderCount++] = stateItemId(id | "");
+  }
+  return applySectionDelta(items, target, order, orderCount);
+}
+
+static bool snapshotFromDocument(const JsonDocument& doc, DeviceStateSnapshot& table) {
+  const char* base = doc["base"] | "";
+  bool isDelta = base[0] != '\0';
+  if (isDelta && strcmp(base, table.version) != 0) {
+    ZEN_LOGW("State delta: base does not match held version");
+    return false;
+  }
+  if (!isDelta) table.clear();
+  const char* timezone = doc["timezone"]["posix"] | "";
+  if (timezone[0] != '\0') copyField(table.timezone, sizeof(table.timezone), timezone);
+  return sectionFromJson(doc["calendar"], isDelta, table.calendarConnected, table.events) &&
+         sectionFromJson(doc["email"], isDelta, table.emailConnected, table.mails);
+}
+
+template <typename TInput>
+static bool decodeJsonInput(TInput& input, DeviceStateSnapshot& table) {
+  StaticJsonDocument<512> filter;
+  buildStateFilter(filter);
+  DynamicJsonDocument doc(2048);
+  DeserializationError err = deserializeJson(doc, input, DeserializationOption::Filter(filter));
+  if (err) {
+    ZEN_LOGW("JSON parse error: %s", err.c_str());
+    return false;
+  }
+  return snapshotFromDocument(doc, table);
+}
+
+bool decodeStateJson(Stream& input, DeviceStateSnapshot& table) {
+  return decodeJsonInput(input, table);
+}
+
+bool decodeStateJson(const String& input, DeviceStateSnapshot& table) {
+  return decodeJsonInput(input, table);
+}
+
+// -----------------------------------------------------------------------------
+// MessagePack
+// -----------------------------------------------------------------------------
+namespace {
+
+// Minimal pull reader for the subset of MessagePack the backend emits:
+// arrays, maps (skipped), strings, nil, booleans and integers.
+class MsgPackReader {
+ public:
+  explicit MsgPackReader(Stream& input) : input_(input) {}
+
+  bool ok() const { return ok_; }
+
+  bool readArray(uint32_t& count) {
+    uint8_t tag;
+    if (!readByte(tag)) return false;
+    if ((tag & 0xF0) == 0x90) {
+      count = tag & 0x0F;
+      return true;
+    }
+    if (tag == 0xDC) return readBE(2, count);
+    if (tag == 0xDD) return readBE(4, count);
+    return fail();
+  }
+
+  // Reads a string (or nil as "") into target, truncating to capacity-1
+  bool readString(char* target, size_t capacity) {
+    uint8_t tag;
+    if (!readByte(tag)) return false;
+    uint32_t len;
+    if (tag == 0xC0) {
+      len = 0;
+    } else if ((tag & 0xE0) == 0xA0) {
+      len = tag & 0x1F;
+    } else if (tag == 0xD9) {
+      if (!readBE(1, len)) return false;
+    } else if (tag == 0xDA) {
+      if (!readBE(2, len)) return false;
+    } else if (tag == 0xDB) {
+      if (!readBE(4, len)) return false;
+    } else {
+      return fail();
+    }
+    size_t keep = len < capacity - 1 ? len : capacity - 1;
+    if (keep > 0 && input_.readBytes(target, keep) != keep) return fail();
+    target[keep] = '\0';
+    return discard(len - keep);
+  }
+
+  bool readBool(bool& value) {
+    uint8_t tag;
+    if (!readByte(tag)) return false;
+    if (tag == 0xC2 || tag == 0xC0) {
+      value = false;
+      return true;
+    }
+    if (tag == 0xC3) {
+      value = true;
+      return true;
+    }
+    return fail();
+  }
+
+  bool readUInt(uint32_t& value) {
+    uint8_t tag;
+    if (!readByte(tag)) return false;
+    if (tag <= 0x7F) {
+      value = tag;
+      return true;
+    }
+    if (tag == 0xCC) return readBE(1, value);
+    if (tag == 0xCD) return readBE(2, value);
+    if (tag == 0xCE) return readBE(4, value);
+    return fail();
+  }
+
+  // Skips one complete value of any supported type
+  bool skip() {
+    uint8_t tag;
+    if (!readByte(tag)) return false;
+    uint32_t n = 0;
+    if (tag <= 0x7F || tag >= 0xE0 || tag == 0xC0 || tag == 0xC2 || tag == 0xC3) return true;
+    if ((tag & 0xE0) == 0xA0) return discard(tag & 0x1F);
+    if ((tag & 0xF0) == 0x90) return skipValues(tag & 0x0F);
+    if ((tag & 0xF0) == 0x80) return skipValues(2u * (tag & 0x0F));
+    switch (tag) {
+      case 0xCC: case 0xD0: return discard(1);
+      case 0xCD: case 0xD1: return discard(2);
+      case 0xCE: case 0xD2: case 0xCA: return discard(4);
+      case 0xCF: case 0xD3: case 0xCB: return discard(8);
+      case 0xD9: case 0xC4: return readBE(1, n) && discard(n);
+      case 0xDA: case 0xC5: return readBE(2, n) && discard(n);
+      case 0xDB: case 0xC6: return readBE(4, n) && discard(n);
+      case 0xDC: return readBE(2, n) && skipValues(n);
+      case 0xDD: return readBE(4, n) && skipValues(n);
+      case 0xDE: return readBE(2, n) && skipValues(2 * n);
+      case 0xDF: return readBE(4, n) && skipValues(2 * n);
+      default: return fail();
+    }
+  }
+
+  bool skipValues(uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+      if (!skip()) return false;
+    }
+    return true;
+  }
+
+ private:
+  bool fail() {
+    ok_ = false;
+    return false;
+  }
+
+  bool readByte(uint8_t& value) {
+    if (!ok_) return false;
+    if (input_.readBytes(&value, 1) != 1) return fail();
+    return true;
+  }
+
+  bool readBE(uint8_t bytes, uint32_t& value) {
+    value = 0;
+    for (uint8_t i = 0; i < bytes; ++i) {
+      uint8_t b;
+      if (!readByte(b)) return false;
+      value = (value << 8) | b;
+    }
+    return true;
+  }
+
+  bool discard(uint32_t count) {
+    uint8_t scratch[32];
+    while (count > 0) {
+      size_t chunk = count < sizeof(scratch) ? count : sizeof(scratch);
+      if (input_.readBytes(scratch, chunk) != chunk) return fail();
+      count -= chunk;
+    }
+    return true;
+  }
+
+  Stream& input_;
+  bool ok_ = true;
+};
+
+}  // namespace
+
+// Item ids are only needed as hashes; longer ids are hashed by their prefix
+static constexpr size_t STATE_ID_READ_LEN = 96;
+
+static bool readItemId(MsgPackReader& reader, uint32_t& id) {
+  char buf[STATE_ID_READ_LEN];
+  if (!reader.readString(buf, sizeof(buf))) return false;
+  id = stateItemId(buf);
+  return true;
+}
+
+template <typename TList>
+static bool readText(MsgPackReader& reader, ItemWriter<TList>& item, uint8_t field) {
+  size_t capacity;
+  char* target = item.field(field, capacity);
+  if (!reader.readString(target, capacity)) return false;
+  item.fieldDone();
+  return true;
+}
+
+// [start, summary, location, id?, ...]
+static bool readItem(MsgPackReader& reader, StateEventList& events) {
+  ItemWriter<StateEventList> event(events);
+  uint32_t fieldCount, id = 0;
+  if (!reader.readArray(fieldCount) || fieldCount < 3 ||
+      !readText(reader, event, EVENT_START) ||
+      !readText(reader, event, EVENT_SUMMARY) ||
+      !readText(reader, event, EVENT_LOCATION)) {
+    return false;
+  }
+  if (fieldCount > 3 && !readItemId(reader, id)) return false;
+  if (!reader.skipValues(fieldCount > 4 ? fieldCount - 4 : 0)) return false;
+  event.commit(id);
+  return true;
+}
+
+// [from, snippet, id?, ...]
+static bool readItem(MsgPackReader& reader, StateMailList& mails) {
+  ItemWriter<StateMailList> mail(mails);
+  uint32_t fieldCount, id = 0;
+  if (!reader.readArray(fieldCount) || fieldCount < 2 ||
+      !readText(reader, mail, MAIL_FROM) ||
+      !readText(reader, mail, MAIL_SNIPPET)) {
+    return false;
+  }
+  if (fieldCount > 2 && !readItemId(reader, id)) return false;
+  if (!reader.skipValues(fieldCount > 3 ? fieldCount - 3 : 0)) return false;
+  mail.commit(id);
+  return true;
+}
+
+// Full: [connected, [items...]], delta: [connected, [changed...], [removed], [order]]
+template <typename TList>
+static bool readSection(MsgPackReader& reader, bool isDelta, bool& connected, TList& items) {
+  const uint32_t knownFields = isDelta ? 4 : 2;
+  uint32_t fieldCount, itemCount;
+  if (!reader.readArray(fieldCount) || fieldCount < knownFields ||
+      !reader.readBool(connected) || !reader.readArray(itemCount)) {
+    return false;
+  }
+  TList& target = emptyScratch(isDelta ? DeltaScratch<TList>::changed : items);
+  for (uint32_t i = 0; i < itemCount; ++i) {
+    if (!hasItemRoom(target)) {
+      if (!reader.skip()) return false;
+      continue;
+    }
+    if (!readItem(reader, target)) return false;
+  }
+  if (!isDelta) return reader.skipValues(fieldCount - knownFields);
+
+  // Removed ids: membership already follows from the order list
+  uint32_t idCount;
+  if (!reader.readArray(idCount) || !reader.skipValues(idCount)) return false;
+  uint32_t order[TList::CAPACITY];
+  uint8_t orderCount = 0;
+  if (!reader.readArray(idCount)) return false;
+  for (uint32_t i = 0; i < idCount; ++i) {
+    if (orderCount >= TList::CAPACITY) {
+      if (!reader.skip()) return false;
+      continue;
+    }
+    if (!readItemId(reader, order[orderCount++])) return false;
+  }
+  if (!reader.skipValues(fieldCount - knownFields)) return false;
+  return applySectionDelta(items, target, order, orderCount);
+}
+
+bool decodeStateMsgPack(Stream& input, DeviceStateSnapshot& table) {
+  MsgPackReader reader(input);
+  uint32_t topCount, version;
+  if (!reader.readArray(topCount) || topCount < 3 || !reader.readUInt(version)) {
+    ZEN_LOGW("MessagePack state: malformed header");
+    return false;
+  }
+  bool isDelta = version == STATE_DELTA_SCHEMA_VERSION;
+  if (version != STATE_SCHEMA_VERSION && !isDelta) {
+    ZEN_LOGW("MessagePack state: unsupported schema %u", static_cast<unsigned>(version));
+    return false;
+  }
+  uint32_t knownFields = 3;
+  if (isDelta) {
+    char base[STATE_VERSION_LEN];
+    knownFields = 4;
+    if (topCount < knownFields || !reader.readString(base, sizeof(base))) return false;
+    if (strcmp(base, table.version) != 0) {
+      ZEN_LOGW("MessagePack state: delta base does not match held version");
+      return false;
+    }
+  } else {
+    table.clear();
+  }
+
+  if (!readSection(reader, isDelta, table.calendarConnected, table.events) ||
+      !readSection(reader, isDelta, table.emailConnected, table.mails)) {
+    return false;
+  }
+  if (topCount > knownFields) {
+    char timezone[STATE_TIMEZONE_LEN];
+    if (!reader.readString(timezone, sizeof(timezone))) return false;
+    if (timezone[0] != '\0') copyField(table.timezone, sizeof(table.timezone), timezone);
+    knownFields++;
+  }
+  reader.skipValues(topCount - knownFields);
+  return reader.ok();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Fixed-size view of GET /devices/state holding only the fields the UI
+// renders. Both wire formats decode into it, so applying a fetch never
+// touches the heap beyond the decoder itself. Items are keyed by a hash of
+// their backend id so delta responses can be applied in place.
+static constexpr size_t STATE_MAX_EVENTS = 16;  // the zen-290 view's list lengths
+static constexpr size_t STATE_MAX_MAILS = 16;
+// Text pools shared by the items of each list. An item is only stored while
+// its pool still has room for all its fields at full length, so at least 6
+// events and 9 mails always fit; texts of typical length leave room for all.
+static constexpr size_t STATE_EVENT_TEXT_BYTES = 1024;
+static constexpr size_t STATE_MAIL_TEXT_BYTES = 2304;
+// Compact MessagePack schemas understood by decodeStateMsgPack()
+static constexpr uint8_t STATE_SCHEMA_VERSION = 1;        // full snapshot
+static constexpr uint8_t STATE_DELTA_SCHEMA_VERSION = 2;  // delta against ?since=
+static constexpr size_t STATE_VERSION_LEN = 40;           // unquoted backend ETag
+static constexpr size_t STATE_TIMEZONE_LEN = 48;          // POSIX TZ rule
+
+static constexpr char STATE_MIME_JSON[] = "application/json";
+static constexpr char STATE_MIME_MSGPACK[] = "application/msgpack";
+// Accept header preferring the compact encoding with JSON as the fallback
+static constexpr char STATE_ACCEPT[] = "application/msgpack, application/json;q=0.5";
+
+enum StateEventField : uint8_t { EVENT_START, EVENT_SUMMARY, EVENT_LOCATION, EVENT_FIELD_COUNT };
+enum StateMailField : uint8_t { MAIL_FROM, MAIL_SNIPPET, MAIL_FIELD_COUNT };
+// Bytes kept per field, NUL included; the backend's zen-290 view trims to one less
+static constexpr uint8_t STATE_EVENT_FIELD_CAPACITY[EVENT_FIELD_COUNT] = {32, 90, 48};
+static constexpr uint8_t STATE_MAIL_FIELD_CAPACITY[MAIL_FIELD_COUNT] = {64, 192};
+static constexpr size_t STATE_EVENT_TEXT_MAX = 32 + 90 + 48;  // one event at full length
+static constexpr size_t STATE_MAIL_TEXT_MAX = 64 + 192;
+
+// One list of the table in struct-of-arrays form: the item ids in one
+// column and, per text field, a column of offsets into the list's text
+// pool. Each text takes only its own length instead of its field's maximum.
+template <size_t MaxItems, size_t Fields, size_t TextBytes>
+struct StateItemList {
+  static constexpr size_t CAPACITY = MaxItems;
+  static constexpr size_t TEXT_BYTES = TextBytes;
+  static_assert(MaxItems <= 255 && TextBytes <= 65535, "count and offsets are narrow");
+
+  uint8_t count;
+  uint16_t textUsed;                  // pool bytes taken by the items held
+  uint32_t id[MaxItems];              // stateItemId() of the backend id, 0 when absent
+  uint16_t textAt[Fields][MaxItems];  // pool offset of each item's NUL-terminated field
+  char text[TextBytes];
+
+  const char* field(size_t field, size_t item) const { return text + textAt[field][item]; }
+};
+
+struct StateEventList : StateItemList<STATE_MAX_EVENTS, EVENT_FIELD_COUNT, STATE_EVENT_TEXT_BYTES> {
+  const char* start(size_t item) const { return field(EVENT_START, item); }
+  const char* summary(size_t item) const { return field(EVENT_SUMMARY, item); }
+  const char* location(size_t item) const { return field(EVENT_LOCATION, item); }
+};
+
+struct StateMailList : StateItemList<STATE_MAX_MAILS, MAIL_FIELD_COUNT, STATE_MAIL_TEXT_BYTES> {
+  const char* from(size_t item) const { return field(MAIL_FROM, item); }
+  const char* snippet(size_t item) const { return field(MAIL_SNIPPET, item); }
+};
+
+struct DeviceStateSnapshot {
+  char version[STATE_VERSION_LEN];  // ETag of the state held, sent as ?since=
+  bool calendarConnected;
+  StateEventList events;
+  bool emailConnected;
+  StateMailList mails;
+  // POSIX TZ rule of the owner's calendar; empty when the backend sent none
+  char timezone[STATE_TIMEZONE_LEN];
+
+  void clear();
+};
+
+// 32-bit FNV-1a of a backend item id; never 0 for a non-empty id
+uint32_t stateItemId(const char* id);
+
+// The decoders apply a response to `table` in place: a full snapshot
+// replaces it, a delta (JSON with "base", or MessagePack schema 2) rebuilds
+// each list from its "order" ids, taking "changed" items from the payload and
+// keeping the rest from the table. Items beyond a list's capacity or its
+// text pool are dropped from the end. A delta whose base differs from
+// table.version, or that references an unknown id, is rejected. On failure
+// the table may be partially written, so callers decode into a copy.
+// table.version is left for the caller to set from the response ETag.
+// Deltas are built in static scratch lists, so only one decode may run at
+// a time.
+
+// application/json body, parsed through a field filter. The Stream overload
+// reads straight from the socket and needs a known Content-Length.
+bool decodeStateJson(Stream& input, DeviceStateSnapshot& table);
+bool decodeStateJson(const String& input, DeviceStateSnapshot& table);
+
+// application/msgpack body in the compact positional schemas
+//   1: [1, [calConnected, [[start, summary, location, id], ...]],
+//          [mailConnected, [[from, snippet, id], ...]], posixTz?]
+//   2: [2, base, [calConnected, [changed...], [removedIds], [orderIds]],
+//                [mailConnected, [changed...], [removedIds], [orderIds]], posixTz?]
+// decoded token by token from the stream without building a document.
+// Unknown trailing elements are skipped so the schema can grow.
+bool decodeStateMsgPack(Stream& input, DeviceStateSnapshot& table);
@@ -0,0 +1,165 @@
+#include "endpoint_pool.h"
+
+#include <cstring>
+
+#include "zen_log.h"
+
+static constexpr char PREF_ENDPOINTS[] = "endpoints";
+// Full timeout for the only or the fastest endpoint while its speed is unknown
+static constexpr uint32_t ENDPOINT_TIMEOUT_MS = 8000;
+// The fastest endpoint gets a few times its usual response time, at least this
+static constexpr uint32_t ENDPOINT_TIMEOUT_MIN_MS = 2000;
+static constexpr uint32_t ENDPOINT_TIMEOUT_RTT_FACTOR = 4;
+// Probes, trials and failovers to the other endpoints
+static constexpr uint32_t ENDPOINT_PROBE_TIMEOUT_MS = 2500;
+static constexpr uint32_t ENDPOINT_PROBE_INTERVAL_MS = 600000;
+static constexpr uint8_t ENDPOINT_TRIP_FAILURES = 2;
+// Skip at least one state refresh cycle before the first trial
+static constexpr uint32_t ENDPOINT_COOLDOWN_MIN_MS = 60000;
+static constexpr uint32_t ENDPOINT_COOLDOWN_MAX_MS = 600000;
+
+void EndpointPool::begin() {
+  if (prefs_.getBytes(PREF_ENDPOINTS, &list_, sizeof(list_)) != sizeof(list_) || list_.count > MAX_ENDPOINTS) {
+    list_ = {};
+  }
+  for (uint8_t i = 0; i < list_.count; ++i) {
+    list_.url[i][URL_MAX] = '\0';
+  }
+  resetHealth();
+  ++generation_;
+  if (list_.count) ZEN_LOGI("%u backend endpoints, first %s", static_cast<unsigned>(list_.count), list_.url[0]);
+}
+
+void EndpointPool::setFallback(const char* url) {
+  fallback_ = url;
+  if (list_.count == 0) {
+    resetHealth();
+    ++generation_;
+  }
+}
+
+void EndpointPool::assign(JsonArrayConst urls) {
+  StoredList next = {};
+  for (JsonVariantConst value : urls) {
+    const char* url = value.as<const char*>();
+    if (!url || strncmp(url, "https://", 8) != 0 || strlen(url) > URL_MAX) continue;
+    strlcpy(next.url[next.count], url, sizeof(next.url[next.count]));
+    if (++next.count == MAX_ENDPOINTS) break;
+  }
+  if (memcmp(&next, &list_, sizeof(next)) == 0) return;  // keep what was measured
+  list_ = next;
+  if (list_.count) {
+    prefs_.putBytes(PREF_ENDPOINTS, &list_, sizeof(list_));
+  } else {
+    prefs_.remove(PREF_ENDPOINTS);
+  }
+  resetHealth();
+  ++generation_;
+  ZEN_LOGI("Backend endpoints updated: %u", static_cast<unsigned>(list_.count));
+}
+
+void EndpointPool::forget() {
+  list_ = {};
+  prefs_.remove(PREF_ENDPOINTS);
+  resetHealth();
+  ++generation_;
+}
+
+void EndpointPool::resetHealth() {
+  memset(health_, 0, sizeof(health_));
+}
+
+const char* EndpointPool::url(uint8_t index) const {
+  if (list_.count == 0) return fallback_;
+  return list_.url[index < list_.count ? index : 0];
+}
+
+bool EndpointPool::available(uint8_t index, unsigned long now) const {
+  const Health& health = health_[index];
+  return health.failures < ENDPOINT_TRIP_FAILURES || static_cast<long>(now - health.openUntil) >= 0;
+}
+
+uint8_t EndpointPool::preferred() const {
+  unsigned long now = millis();
+  int best = -1;
+  int trial = -1;  // breaker cooldown over, not proven healthy yet
+  for (uint8_t i = 0; i < count(); ++i) {
+    const Health& health = health_[i];
+    if (health.failures >= ENDPOINT_TRIP_FAILURES) {
+      if (trial < 0 && available(i, now)) trial = i;
+      continue;
+    }
+    // Measured endpoints by speed; otherwise the backend's order
+    if (best < 0 || (health.rttMs != 0 && (health_[best].rttMs == 0 || health.rttMs < health_[best].rttMs))) {
+      best = i;
+    }
+  }
+  if (best >= 0) return static_cast<uint8_t>(best);
+  if (trial >= 0) return static_cast<uint8_t>(trial);
+  // Every breaker is open: the one that closes first
+  uint8_t soonest = 0;
+  for (uint8_t i = 1; i < count(); ++i) {
+    if (static_cast<long>(health_[i].openUntil - health_[soonest].openUntil) < 0) soonest = i;
+  }
+  return soonest;
+}
+
+uint8_t EndpointPool::select() const {
+  uint8_t best = preferred();
+  if (count() == 1) return best;
+  unsigned long now = millis();
+  // A breaker whose cooldown ran out gets its trial; otherwise probe the
+  // endpoint heard from longest ago, never-tried ones first
+  int stalest = -1;
+  for (uint8_t i = 0; i < count(); ++i) {
+    if (i == best || !available(i, now)) continue;
+    const Health& health = health_[i];
+    if (health.failures >= ENDPOINT_TRIP_FAILURES) return i;
+    if (stalest < 0 || (!health.tried && health_[stalest].tried) ||
+        (health.tried == health_[stalest].tried && static_cast<long>(health.triedAt - health_[stalest].triedAt) < 0)) {
+      stalest = i;
+    }
+  }
+  if (stalest >= 0 && (!health_[stalest].tried || now - health_[stalest].triedAt >= ENDPOINT_PROBE_INTERVAL_MS)) {
+    return static_cast<uint8_t>(stalest);
+  }
+  return best;
+}
+
+uint32_t EndpointPool::timeoutMs(uint8_t index) const {
+  if (count() == 1) return ENDPOINT_TIMEOUT_MS;
+  if (index != preferred()) return ENDPOINT_PROBE_TIMEOUT_MS;
+  uint32_t rtt = health_[index].rttMs;
+  if (rtt == 0) return ENDPOINT_TIMEOUT_MS;
+  uint32_t timeout = rtt * ENDPOINT_TIMEOUT_RTT_FACTOR;
+  if (timeout < ENDPOINT_TIMEOUT_MIN_MS) return ENDPOINT_TIMEOUT_MIN_MS;
+  return timeout > ENDPOINT_TIMEOUT_MS ? ENDPOINT_TIMEOUT_MS : timeout;
+}
+
+void EndpointPool::reportSuccess(uint8_t index, uint32_t elapsedMs) {
+  if (index >= count()) return;
+  Health& health = health_[index];
+  if (elapsedMs == 0) elapsedMs = 1;  // 0 means unmeasured
+  health.rttMs = health.rttMs == 0 ? elapsedMs : (health.rttMs * 3 + elapsedMs) / 4;
+  health.triedAt = millis();
+  health.tried = 1;
+  if (health.failures >= ENDPOINT_TRIP_FAILURES) ZEN_LOGI("Endpoint %s recovered", url(index));
+  health.failures = 0;
+  health.trips = 0;
+}
+
+void EndpointPool::reportFailure(uint8_t index) {
+  if (index >= count()) return;
+  Health& health = health_[index];
+  health.triedAt = millis();
+  health.tried = 1;
+  if (health.failures < UINT8_MAX) ++health.failures;
+  // A lone endpoint has nothing to fail over to
+  if (health.failures < ENDPOINT_TRIP_FAILURES || count() == 1) return;
+  // Open, or re-open after a failed trial, with a longer cooldown each time
+  uint32_t cooldown = ENDPOINT_COOLDOWN_MIN_MS << (health.trips < 5 ? health.trips : 5);
+  if (cooldown > ENDPOINT_COOLDOWN_MAX_MS) cooldown = ENDPOINT_COOLDOWN_MAX_MS;
+  if (health.trips < UINT8_MAX) ++health.trips;
+  health.openUntil = health.triedAt + cooldown;
+  ZEN_LOGW("Endpoint %s failing, skipped for %lu s", url(index), static_cast<unsigned long>(cooldown / 1000));
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+
+// Backend base URLs the display may talk to, with a latency estimate and a
+// circuit breaker per endpoint. The list comes from the registration
+// response ("endpoints") and is kept in Preferences; without one the
+// fallback URL (built in or provisioned over BLE) is the only endpoint.
+//
+// Requests go to the healthy endpoint with the lowest smoothed response
+// time. An endpoint that fails ENDPOINT_TRIP_FAILURES times in a row is
+// skipped for a cooldown that doubles on every trip, then gets a single
+// trial request. Endpoints other than the fastest only get a short timeout,
+// so a degraded node costs seconds rather than a full HTTP timeout. Every
+// ENDPOINT_PROBE_INTERVAL_MS one request goes to the endpoint measured
+// longest ago, keeping the estimates of the others current.
+class EndpointPool {
+ public:
+  static constexpr uint8_t MAX_ENDPOINTS = 4;
+  static constexpr size_t URL_MAX = 127;  // NUL excluded
+
+  EndpointPool(Preferences& prefs, const char* fallbackUrl) : prefs_(prefs), fallback_(fallbackUrl) {}
+
+  // Loads the stored list; call after prefs.begin().
+  void begin();
+  // Endpoint used while no list is stored; the string has to outlive the pool.
+  void setFallback(const char* url);
+  // Replaces the list with the https URLs in urls and stores it; an empty
+  // or missing array goes back to the fallback.
+  void assign(JsonArrayConst urls);
+  // Drops the stored list, e.g. when the display moves to another backend.
+  void forget();
+
+  // Endpoint the next request should go to.
+  uint8_t select() const;
+  // Fastest healthy endpoint, for long-lived connections.
+  uint8_t preferred() const;
+  const char* url(uint8_t index) const;
+  // How long a request to index may take before it counts as failed.
+  uint32_t timeoutMs(uint8_t index) const;
+  // Bumped whenever the URLs change, so clients know to reconnect.
+  uint32_t generation() const { return generation_; }
+
+  void reportSuccess(uint8_t index, uint32_t elapsedMs);
+  void reportFailure(uint8_t index);
+
+ private:
+  struct StoredList {
+    uint8_t count;
+    char url[MAX_ENDPOINTS][URL_MAX + 1];
+  };
+  struct Health {
+    uint32_t rttMs;           // smoothed, 0 until the first success
+    unsigned long triedAt;    // last request, successful or not
+    unsigned long openUntil;  // breaker skips the endpoint until then
+    uint8_t tried;
+    uint8_t failures;         // in a row
+    uint8_t trips;            // cooldowns in a row, for the backoff
+  };
+
+  uint8_t count() const { return list_.count ? list_.count : 1; }
+  bool available(uint8_t index, unsigned long now) const;
+  void resetHealth();
+
+  Preferences& prefs_;
+  const char* fallback_;
+  StoredList list_ = {};
+  Health health_[MAX_ENDPOINTS] = {};
+  uint32_t generation_ = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental 32-bit FNV-1a. Cheap enough to run over every field while the
+// UI buffers are filled, and small enough to keep per region in RTC memory.
+class Fnv1a {
+ public:
+  static constexpr uint32_t OFFSET_BASIS = 2166136261u;
+  static constexpr uint32_t PRIME = 16777619u;
+
+  Fnv1a& add(const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * PRIME;
+    }
+    return *this;
+  }
+
+  // Hashes the string including its terminator, so consecutive fields can't
+  // run into each other: ("ab", "c") and ("a", "bc") hash differently.
+  Fnv1a& add(const char* text) {
+    if (!text) text = "";
+    do {
+      hash_ = (hash_ ^ static_cast<uint8_t>(*text)) * PRIME;
+    } while (*text++);
+    return *this;
+  }
+
+  uint32_t value() const { return hash_; }
+
+ private:
+  uint32_t hash_ = OFFSET_BASIS;
+};
@@ -0,0 +1,122 @@
+#include "local_clock.h"
+
+#include <esp_sntp.h>
+#include <cstring>
+#include <sys/time.h>
+#include <time.h>
+
+static constexpr char PREF_TIMEZONE[] = "tz";
+// Used until the backend reports the owner's zone
+static constexpr char DEFAULT_TIMEZONE[] = "CET-1CEST,M3.5.0/2,M10.5.0/3";
+static constexpr char NTP_PRIMARY[] = "pool.ntp.org";
+static constexpr char NTP_SECONDARY[] = "time.nist.gov";
+static constexpr time_t CLOCK_VALID_AFTER = 1700000000;
+// Resync when the measured drift would have moved the clock this far;
+// the minute display tolerates a few seconds
+static constexpr int32_t CLOCK_MAX_ERROR_MS = 2000;
+static constexpr uint32_t CLOCK_SYNC_MIN_S = 3600;
+static constexpr uint32_t CLOCK_SYNC_MAX_S = 24 * 3600;
+static constexpr uint32_t CLOCK_SYNC_DEFAULT_S = 6 * 3600;
+static constexpr uint32_t CLOCK_UNSET_POLL_MS = 1000;
+
+// RTC memory survives deep sleep, so a wake does not trigger a new sync
+RTC_DATA_ATTR static time_t lastSyncAt = 0;
+RTC_DATA_ATTR static int32_t driftPpm = 0;  // 0 until two syncs were compared
+// Local estimate of the time when the current sync was requested, to
+// measure how far the RTC drifted since the previous one
+static time_t syncRequestedAt = 0;
+static unsigned long syncRequestedMillis = 0;
+static volatile bool syncedFlag = false;
+
+static time_t nowEpoch() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return tv.tv_sec;
+}
+
+void LocalClock::begin() {
+  String stored = prefs_.getString(PREF_TIMEZONE, DEFAULT_TIMEZONE);
+  strlcpy(timezone_, stored.c_str(), sizeof(timezone_));
+  setenv("TZ", timezone_, 1);
+  tzset();
+}
+
+uint32_t LocalClock::syncIntervalS() {
+  if (driftPpm == 0) return CLOCK_SYNC_DEFAULT_S;
+  uint32_t ppm = static_cast<uint32_t>(abs(driftPpm));
+  // error_ms = interval_s * ppm / 1000
+  uint32_t interval = static_cast<uint32_t>(CLOCK_MAX_ERROR_MS) * 1000U / ppm;
+  if (interval < CLOCK_SYNC_MIN_S) return CLOCK_SYNC_MIN_S;
+  return interval > CLOCK_SYNC_MAX_S ? CLOCK_SYNC_MAX_S : interval;
+}
+
+void LocalClock::onSync(struct timeval* tv) {
+  if (!tv) return;
+  if (lastSyncAt > CLOCK_VALID_AFTER && syncRequestedAt > CLOCK_VALID_AFTER) {
+    // What the RTC would read now, had SNTP not corrected it
+    time_t expected = syncRequestedAt + static_cast<time_t>((millis() - syncRequestedMillis) / 1000);
+    int64_t elapsed = expected - lastSyncAt;
+    if (elapsed >= static_cast<int64_t>(CLOCK_SYNC_MIN_S)) {
+      int64_t errorMs = static_cast<int64_t>(tv->tv_sec - expected) * 1000;
+      driftPpm = static_cast<int32_t>(errorMs * 1000 / elapsed);
+      if (driftPpm == 0) driftPpm = 1;
+    }
+  }
+  lastSyncAt = tv->tv_sec;
+  // Later automatic resyncs are measured from this one
+  syncRequestedAt = tv->tv_sec;
+  syncRequestedMillis = millis();
+  sntp_set_sync_interval(syncIntervalS() * 1000U);
+  syncedFlag = true;
+}
+
+void LocalClock::onNetworkUp() {
+  if (sntp_enabled()) return;  // already syncing on its own interval
+  time_t now = nowEpoch();
+  if (valid() && now - lastSyncAt < static_cast<time_t>(syncIntervalS())) return;
+  syncRequestedAt = now;
+  syncRequestedMillis = millis();
+  sntp_set_time_sync_notification_cb(onSync);
+  sntp_set_sync_interval(syncIntervalS() * 1000U);
+  configTzTime(timezone_, NTP_PRIMARY, NTP_SECONDARY);
+}
+
+bool LocalClock::setTimezone(const char* posix) {
+  if (!posix || posix[0] == '\0' || strcmp(posix, timezone_) == 0) return false;
+  strlcpy(timezone_, posix, sizeof(timezone_));
+  setenv("TZ", timezone_, 1);
+  tzset();
+  prefs_.putString(PREF_TIMEZONE, timezone_);
+  return true;
+}
+
+bool LocalClock::valid() const {
+  return lastSyncAt > CLOCK_VALID_AFTER && nowEpoch() > CLOCK_VALID_AFTER;
+}
+
+bool LocalClock::takeSynced() {
+  if (!syncedFlag) return false;
+  syncedFlag = false;
+  return true;
+}
+
+void LocalClock::format(char* target, size_t capacity) const {
+  if (!valid()) {
+    strlcpy(target, "--:--", capacity);
+    return;
+  }
+  time_t now = nowEpoch();
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
+  snprintf(target, capacity, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+}
+
+uint32_t LocalClock::millisToNextMinute() const {
+  if (!valid()) return CLOCK_UNSET_POLL_MS;
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  struct tm timeinfo;
+  localtime_r(&tv.tv_sec, &timeinfo);
+  uint32_t intoMinute = static_cast<uint32_t>(timeinfo.tm_sec) * 1000U + tv.tv_usec / 1000;
+  return intoMinute >= 60000U ? 1 : 60000U - intoMinute;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Wall clock for the display. The ESP32 keeps system time running in the
+// RTC across deep sleep, so SNTP only needs to run occasionally: a sync is
+// skipped while the last one is recent enough for the measured drift, and
+// once running SNTP resyncs on that same interval by itself. The time zone
+// is a POSIX TZ rule supplied by the backend and kept in NVS for the next
+// boot.
+class LocalClock {
+ public:
+  explicit LocalClock(Preferences& prefs) : prefs_(prefs) {}
+
+  // Applies the stored time zone; call after prefs.begin().
+  void begin();
+  // Starts SNTP unless the RTC was synced recently enough.
+  void onNetworkUp();
+  // Applies and stores a new POSIX TZ rule; true when the zone changed.
+  // Empty or unchanged rules are ignored.
+  bool setTimezone(const char* posix);
+  // True once SNTP (now or before a deep sleep) has set the time.
+  bool valid() const;
+  // True once after each completed sync, so callers can redraw the clock.
+  bool takeSynced();
+  // Local time as HH:MM, or "--:--" before the first sync.
+  void format(char* target, size_t capacity) const;
+  // Milliseconds until the local minute changes; a short poll interval
+  // while the time is not set yet.
+  uint32_t millisToNextMinute() const;
+
+ private:
+  static void onSync(struct timeval* tv);
+  static uint32_t syncIntervalS();
+
+  Preferences& prefs_;
+  char timezone_[48] = "";
+};
@@ -4,11 +4,26 @@
 #include <HTTPClient.h>
 #include <Preferences.h>
 #include <ArduinoJson.h>
-#include <NimBLEDevice.h>
 #include <time.h>
 #include <cstring>
+#include <esp_sleep.h>
+#include <driver/rtc_io.h>
 
 #include <GxEPD2_BW.h>
+#include "alloc_debug.h"
+#include "backend_session.h"
+#include "ble_provisioning.h"
+#include "button_input.h"
+#include "device_state.h"
+#include "endpoint_pool.h"
+#include "local_clock.h"
+#include "offline_cache.h"
+#include "ota_update.h"
+#include "perf_metrics.h"
+#include "push_channel.h"
+#include "text_layout.h"
+#include "wifi_link.h"
+#include "zen_log.h"
 #include "ui.h"
 
 // Display wiring (ESP32 GPIO numbers)
@@ -24,19 +39,38 @@
 
 // run code and listen to serial: cd e-ink-display; pio run -t upload -t monitor
 
+// Low-power duty cycle: deep sleep between minute ticks, keeping the UI buffers
+// and refresh bookkeeping in RTC memory. Opt in with -DZEN_LOW_POWER=1.
+#ifndef ZEN_LOW_POWER
+#define ZEN_LOW_POWER 0
+#endif
+
+#if ZEN_LOW_POWER
+#define ZEN_RETAINED RTC_DATA_ATTR
+#else
+#define ZEN_RETAINED
+#endif
+
 GxEPD2_BW<GxEPD2_290_T94, GxEPD2_290_T94::HEIGHT> display(GxEPD2_290_T94(/*CS*/5, /*DC*/17, /*RST*/16, /*BUSY*/4));
+static constexpr uint8_t DISPLAY_ROTATION = 1;  // landscape 296x128, see pushFramePart()
 
 // -----------------------------------------------------------------------------
 // Network & backend configuration
 // -----------------------------------------------------------------------------
-static constexpr char BACKEND_BASE_URL[] = "https://raspberrypi.tailf0b36d.ts.net"; // TODO: add dynamic loading
+// Used until the app provisions another backend or registration lists endpoints
+static constexpr char BACKEND_BASE_URL[] = "https://raspberrypi.tailf0b36d.ts.net";
 static constexpr char REGISTER_ENDPOINT[] = "/devices/register";
 static constexpr char STATE_ENDPOINT[] = "/devices/state";
 static constexpr char HEARTBEAT_ENDPOINT[] = "/devices/heartbeat";
-static constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 20000;
+static constexpr char EVENTS_ENDPOINT[] = "/devices/events";
 static constexpr uint32_t STATE_REFRESH_INTERVAL_MS = 60000;
 static constexpr uint32_t HEARTBEAT_INTERVAL_MS = 30000;
 static constexpr uint32_t PROVISIONING_MESSAGE_REFRESH_MS = 60000;
+static constexpr uint32_t PUSH_COALESCE_MS = 1500;               // fold bursts of push events into one fetch
+static constexpr uint32_t PUSH_FALLBACK_REFRESH_MS = 300000;     // safety poll while the push stream is up
+static constexpr bool PUSH_ENABLED = !ZEN_LOW_POWER;             // a held stream defeats deep sleep
+static constexpr uint32_t LOW_POWER_HEARTBEAT_WAKES = 10;        // heartbeat every 10th wake
+static constexpr uint32_t LOW_POWER_WAKE_MARGIN_MS = 500;        // land just past the minute boundary
 static constexpr char PREF_NAMESPACE[] = "zen_disp";
 static constexpr char PREF_WIFI_SSID[] = "wifi_ssid";
 static constexpr char PREF_WIFI_PASS[] = "wifi_pass";
@@ -44,82 +78,106 @@ static constexpr char PREF_DEVICE_ID[] = "device_id";
 static constexpr char PREF_DEVICE_SECRET[] = "device_secret";
 static constexpr char PREF_PAIRING_TOKEN[] = "pairing_token";
 static constexpr char PREF_BLE_NAME[] = "ble_name";
+static constexpr char PREF_BACKEND_URL[] = "backend_url";
 static constexpr char PREF_FIRMWARE[] = "fw";
 static constexpr char FIRMWARE_VERSION[] = "0.2.0";
+// Selects the backend's per-model view of the state (list lengths, field sizes)
+static constexpr char DEVICE_MODEL[] = "zen-290";
+
+// A re-pair started with the mode button keeps BLE up this long for the app
+static constexpr uint32_t BLE_REPAIR_WINDOW_MS = 300000;
 
-static constexpr char BLE_SERVICE_UUID[] = "7c2c2001-3e64-4d89-a6fb-01bd1e78b541";
-static constexpr char BLE_CREDENTIALS_CHAR_UUID[] = "7c2c2002-3e64-4d89-a6fb-01bd1e78b541";
-static constexpr char BLE_PAIRING_CHAR_UUID[] = "7c2c2003-3e64-4d89-a6fb-01bd1e78b541";
-static constexpr char BLE_STATUS_CHAR_UUID[] = "7c2c2004-3e64-4d89-a6fb-01bd1e78b541";
+// Backend provisioned over BLE, empty for BACKEND_BASE_URL
+static char backendUrl[BLE_URL_MAX + 1] = "";
+static_assert(BLE_URL_MAX <= EndpointPool::URL_MAX, "a provisioned URL fits the endpoint pool");
 
 // -----------------------------------------------------------------------------
 // UI globals consumed by ui.h draw functions
 // -----------------------------------------------------------------------------
-static char gCalSlotPrimary[64] = "Pair Zen Display";
-static char gCalSlotSecondary[64] = "Add calendar";
-static char gCalSlotThird[64] = "";
-static char gCalLocation[48] = "";
-static char gCalSelected[96] = "Open Zen Phone app";
-static char gMailSlotPrimary[64] = "Connect Gmail";
-static char gMailSelected[64] = "No email";
-static char gMailSender[64] = "";
-static char gMailSummary[192] = "Open Settings -> Connect Display";
-
-// Left middle slot should show the second event of today
-const char* cal_Layer_2_copy_text = gCalSlotSecondary;
-// Right panel no longer uses this for Personen; keep for potential future use
-const char* cal_Layer_8_copy_text = gCalSlotSecondary;
-const char* cal_ort_details_text_text = gCalLocation;
-const char* cal_selected_termin_text_text = gCalSelected;
-// New: third calendar line in UI
-const char* cal_termin_slot_3_text_text = gCalSlotThird;
-
-const char* mail_Layer_2_copy_text = gMailSlotPrimary;
-const char* mail_person_prefix_copy_text = gMailSummary;
-const char* mail_selected_termin_text_text = gMailSelected;
-const char* mail_termin_slot_3_text_text = gMailSender;
-
-static char _mail_lines_buf[6][64];
-const char* mail_person_line1 = _mail_lines_buf[0];
-const char* mail_person_line2 = _mail_lines_buf[1];
-const char* mail_person_line3 = _mail_lines_buf[2];
-const char* mail_person_line4 = _mail_lines_buf[3];
-const char* mail_person_line5 = _mail_lines_buf[4];
-const char* mail_person_line6 = _mail_lines_buf[5];
-
-static char currentTimeBuf[16] = "--:--";
-const char* currentTimeStr = currentTimeBuf;
+ZEN_RETAINED static char gCalSlotPrimary[64] = "Pair Zen Display";
+ZEN_RETAINED static char gCalSlotSecondary[64] = "Add calendar";
+ZEN_RETAINED static char gCalSlotThird[64] = "";
+ZEN_RETAINED static char gCalLocation[48] = "";
+ZEN_RETAINED static char gCalSelected[96] = "Open Zen Phone app";
+ZEN_RETAINED static char gMailSlotPrimary[64] = "Connect Gmail";
+ZEN_RETAINED static char gMailSelected[64] = "No email";
+ZEN_RETAINED static char gMailSender[64] = "";
+ZEN_RETAINED static char gMailSummary[192] = "Open Settings -> Connect Display";
+
+ZEN_RETAINED static char _mail_lines_buf[UI_SUMMARY_LINES][64];
+
+// Metrics of the fonts the draw functions use, for laying text out ahead of drawing
+static const TextFont uiLargeFont(nullptr, UI_TEXT_SIZE_LARGE);
+static const TextFont uiSmallFont(nullptr, UI_TEXT_SIZE_SMALL);
+
+// Blank until the clock is set, see updateTime()
+static char currentTimeBuf[16] = "";
+static constexpr char STATE_NOTICE_CACHED[] = "cached";
+static char stateNoticeBuf[8] = "";
+
+// What the screens in ui.cpp print, in UiText order
+static UiTexts uiTexts = {
+    currentTimeBuf, stateNoticeBuf,
+    gCalSelected, gCalSlotSecondary, gCalSlotThird, gCalLocation,
+    gMailSelected, gMailSlotPrimary, gMailSender,
+    _mail_lines_buf[0], _mail_lines_buf[1], _mail_lines_buf[2], _mail_lines_buf[3], _mail_lines_buf[4], _mail_lines_buf[5],
+};
+static_assert(UI_TEXT_MAIL_SUMMARY == 9 && UI_SUMMARY_LINES == 6, "uiTexts follows UiText");
 
 // -----------------------------------------------------------------------------
 // Refresh gating
 // -----------------------------------------------------------------------------
-static char lastStateSignature[512] = "";   // fingerprint of last shown data
+ZEN_RETAINED static DeviceStateSnapshot stateTable;      // items last applied, base for deltas
 static bool minuteRefreshPending = false;    // set when HH:MM changes
 
 // -----------------------------------------------------------------------------
-// Mode button handling
+// Partial refresh bookkeeping
 // -----------------------------------------------------------------------------
-const int MODE_PIN = 19;
-int lastModeState = LOW;
-int stableState = LOW;
-unsigned long lastDebounceTime = 0;
-const unsigned long debounceDelay = 50;
-bool lastButtonPressed = false;  // Track if button was pressed in previous loop
+static constexpr uint8_t PARTIAL_REFRESHES_BEFORE_FULL = 30;  // clear ghosting roughly every 30 min
+ZEN_RETAINED static uint8_t dirtyRegions[2] = {0, 0};     // per content mode (calendar, email), UiRegion bits
+ZEN_RETAINED static uint8_t partialRefreshCount = 0;      // partial updates since the last full refresh
+// uiRegionFingerprint() of the texts each region draws, per content mode; 0 never matches
+ZEN_RETAINED static uint32_t regionFingerprints[2][UI_REGION_COUNT] = {};
 
 // -----------------------------------------------------------------------------
-// Hard Reset button handling
+// Mode frame cache
 // -----------------------------------------------------------------------------
+// One off-screen 1-bpp frame per content mode in the panel's native layout
+// (128x296, 4736 bytes each), drawn with the display's rotation so the bytes
+// can go to the controller as they are. A frame is re-rasterised only after
+// a region of its mode was marked dirty; a mode toggle just transfers it.
+// Not retained across deep sleep: frames are rebuilt on first use after wake.
+static constexpr int16_t PANEL_NATIVE_W = GxEPD2_290_T94::WIDTH;
+static constexpr int16_t PANEL_NATIVE_H = GxEPD2_290_T94::HEIGHT;
+static GFXcanvas1 calendarFrame(PANEL_NATIVE_W, PANEL_NATIVE_H);
+static GFXcanvas1 emailFrame(PANEL_NATIVE_W, PANEL_NATIVE_H);
+static bool modeFrameValid[2] = {false, false};  // per content mode (calendar, email)
+
+// -----------------------------------------------------------------------------
+// Buttons (both active high with pull-downs)
+// -----------------------------------------------------------------------------
+const int MODE_PIN = 19;
 const int RESET_PIN = 13;
-int lastResetState = LOW;
-int resetStableState = LOW;
-unsigned long lastResetDebounceTime = 0;
-const unsigned long resetDebounceDelay = 50;
-bool lastResetPressed = false;
+// Factory reset only fires after the reset button has been held this long
+const uint32_t RESET_HOLD_MS = 3000;
+// Holding the mode button starts BLE on a provisioned unit, e.g. to re-pair
+const uint32_t BLE_HOLD_MS = 2000;
+
+static ButtonInput buttons;
+static int modeButton = -1;
+static int resetButton = -1;
 
 // -----------------------------------------------------------------------------
 // Preferences and runtime state
 // -----------------------------------------------------------------------------
 Preferences prefs;
+static WifiLink wifiLink(prefs);
+static LocalClock localClock(prefs);
+static OfflineCache offlineCache(prefs);
+static OtaUpdater otaUpdater(prefs, DEVICE_MODEL, FIRMWARE_VERSION);
+static EndpointPool endpoints(prefs, BACKEND_BASE_URL);
+static BackendSession backendSession(endpoints);
+static PushChannel pushChannel(endpoints, EVENTS_ENDPOINT);
 String wifiSsid;
 String wifiPassword;
 String deviceId;
@@ -129,105 +187,122 @@ String bleName;
 bool wifiConnected = false;
 bool deviceRegistered = false;
 bool stateReady = false;
+// Content restored from offlineCache is on screen and no fetch succeeded yet
+bool showingCachedState = false;
 unsigned long lastStateFetch = 0;
 unsigned long lastHeartbeat = 0;
 unsigned long lastProvisioningRedraw = 0;
-String lastProvHeadline;
-String lastProvLine1;
-String lastProvLine2;
-String lastProvLine3;
+// Fixed buffers so the provisioning loop can rebuild and compare its text
+// every pass without touching the heap
+struct ProvisioningText {
+  char headline[32];
+  char line1[32];
+  char line2[56];
+  char line3[48];
+
+  bool operator!=(const ProvisioningText& other) const {
+    return strcmp(headline, other.headline) != 0 || strcmp(line1, other.line1) != 0 ||
+           strcmp(line2, other.line2) != 0 || strcmp(line3, other.line3) != 0;
+  }
+};
+ProvisioningText lastProvText = {};
 bool provisioningDirty = true;
 
-volatile bool credentialsUpdated = false;
-String pendingSsid;
-String pendingPassword;
-
-NimBLECharacteristic* pairingInfoChar = nullptr;
-NimBLECharacteristic* statusChar = nullptr;
-bool bleInitialized = false;
+static BleProvisioning bleProvisioning;
+// Provisioned units boot without BLE; anything that needs the phone app sets
+// this and the network task brings BLE up
+volatile bool bleStartRequested = false;
+// millis() until which a re-pair keeps BLE up after the device is ready
+static unsigned long bleHoldUntil = 0;
 
 enum class UiMode { Provisioning, Calendar, Email };
-UiMode currentUi = UiMode::Provisioning;
+ZEN_RETAINED UiMode currentUi = UiMode::Provisioning;
+ZEN_RETAINED static uint32_t wakesSinceHeartbeat = 0;
+bool stateFetchRequested = false;
+bool pushFetchPending = false;
+unsigned long pushFetchDueAt = 0;
+bool resumedFromSleep = false;
+
+// -----------------------------------------------------------------------------
+// Tasks
+// -----------------------------------------------------------------------------
+// network: Wi-Fi, registration, heartbeat, push and state fetches. Pinned to
+//          core 0 next to the Wi-Fi stack; the only task that blocks on I/O.
+// render:  sole owner of the panel, fed by renderQueue.
+// input:   woken by the button ISRs, debounces and posts UI requests.
+// The UI model (text buffers, dirty masks, frame validity) is written by the
+// network task and rasterised by the render task, both under uiModelMutex.
+// The mode frames are the render task's private copy of that model, so
+// panel transfers and BUSY waits run without the lock and a slow fetch or
+// refresh never delays a button.
+static constexpr uint32_t NETWORK_TASK_STACK = 12288;  // TLS handshakes
+static constexpr uint32_t RENDER_TASK_STACK = 6144;
+static constexpr uint32_t INPUT_TASK_STACK = 4096;     // factory reset runs here
+static constexpr UBaseType_t NETWORK_TASK_PRIORITY = 1;
+static constexpr UBaseType_t RENDER_TASK_PRIORITY = 2;
+static constexpr UBaseType_t INPUT_TASK_PRIORITY = 3;
+static constexpr BaseType_t NETWORK_TASK_CORE = 0;
+static constexpr BaseType_t UI_TASK_CORE = 1;
+static constexpr UBaseType_t RENDER_QUEUE_DEPTH = 8;
+static constexpr uint32_t RENDER_POST_TIMEOUT_MS = 100;
+static constexpr uint32_t RENDER_FLUSH_TIMEOUT_MS = 15000;  // a full refresh plus margin
+static constexpr uint32_t NETWORK_IDLE_MS = 20;             // yield between network passes
+
+enum class RenderOp : uint8_t { DirtyRegions, ShowMode, NextItem, Provisioning, Flush };
+
+struct RenderRequest {
+  RenderOp op;
+  UiMode mode;          // ShowMode target
+  TaskHandle_t notify;  // Flush: task to notify once everything queued before is drawn
+};
+
+static QueueHandle_t renderQueue = nullptr;
+static SemaphoreHandle_t uiModelMutex = nullptr;
+
+// Scoped hold of uiModelMutex. Not recursive: helpers documented as
+// "caller holds the model lock" must not take it again.
+class UiModelLock {
+ public:
+  UiModelLock() { xSemaphoreTake(uiModelMutex, portMAX_DELAY); }
+  ~UiModelLock() { xSemaphoreGive(uiModelMutex); }
+  UiModelLock(const UiModelLock&) = delete;
+  UiModelLock& operator=(const UiModelLock&) = delete;
+};
 
 // Forward declarations
 void updateTime();
-void drawCalendar();
-void drawEmail();
-void drawProvisioningScreen(const String& headline, const String& line1, const String& line2, const String& line3);
-void startBleProvisioning();
-void ensureBleAdvertising();
+bool setStateNotice(const char* notice);
+void drawProvisioningScreen(const ProvisioningText& text);
 void handleProvisioningUi();
 void attemptWifiConnection(const String& ssid, const String& password);
 bool ensureWifiConnection();
+bool requestRender(RenderOp op, UiMode mode = UiMode::Provisioning);
+void flushRender();
 void refreshDisplayForMode(UiMode targetMode);
 void refreshCurrentDisplay();
-void updatePairingCharacteristic();
-void updateStatusCharacteristic(const String& status);
+void refreshDirtyRegions();
+void markRegionDirty(UiMode mode, UiRegion region);
+static bool syncRegionFingerprints(UiMode mode);
 void sendHeartbeat();
+void performFactoryReset();
+void enterLowPowerSleep();
 String defaultBleName();
 
-class CredentialCallbacks : public NimBLECharacteristicCallbacks {
- public:
-  void onWrite(NimBLECharacteristic* characteristic) override {
-    std::string raw = characteristic->getValue();
-    Serial.print("BLE credentials received, length: ");
-    Serial.println(raw.length());
-    if (raw.empty()) {
-      Serial.println("Empty credentials payload");
-      return;
-    }
-    auto newlinePos = raw.find('\n');
-    if (newlinePos == std::string::npos) {
-      Serial.println("No newline separator found");
-      return;
-    }
-    pendingSsid = String(raw.substr(0, newlinePos).c_str());
-    pendingPassword = String(raw.substr(newlinePos + 1).c_str());
-    Serial.print("Parsed SSID: ");
-    Serial.println(pendingSsid);
-    Serial.println("Password received (hidden)");
-    credentialsUpdated = true;
+// Returns true when the buffer content actually changed
+bool copyToBuffer(char* target, size_t capacity, const char* value) {
+  if (!target || capacity == 0) return false;
+  if (!value) value = "";
+  size_t len = strnlen(value, capacity - 1);
+  if (strncmp(target, value, len) == 0 && target[len] == '\0') {
+    return false;
   }
-};
-
-static CredentialCallbacks gCredentialCallbacks;
-
-void copyToBuffer(char* target, size_t capacity, const String& value) {
-  if (!target || capacity == 0) return;
-  value.substring(0, capacity - 1).toCharArray(target, capacity);
+  memcpy(target, value, len);
+  target[len] = '\0';
+  return true;
 }
 
-void updateMailSummaryLines(const char* text) {
-  if (!text) {
-    for (auto& line : _mail_lines_buf) {
-      line[0] = '\0';
-    }
-    return;
-  }
-  const size_t maxLen = 18;
-  const char* cursor = text;
-  for (int i = 0; i < 6; ++i) {
-    _mail_lines_buf[i][0] = '\0';
-  }
-  for (int line = 0; line < 6 && *cursor; ++line) {
-    const char* segmentStart = cursor;
-    const char* lastSpace = nullptr;
-    size_t len = 0;
-    while (*cursor && len < maxLen) {
-      if (*cursor == ' ') {
-        lastSpace = cursor;
-      }
-      ++cursor;
-      ++len;
-    }
-    size_t copyLen = len;
-    if (*cursor && lastSpace && lastSpace > segmentStart) {
-      copyLen = static_cast<size_t>(lastSpace - segmentStart);
-      cursor = lastSpace + 1;
-    }
-    strncpy(_mail_lines_buf[line], segmentStart, copyLen);
-    _mail_lines_buf[line][copyLen] = '\0';
-  }
+bool copyToBuffer(char* target, size_t capacity, const String& value) {
+  return copyToBuffer(target, capacity, value.c_str());
 }
 
 String defaultBleName() {
@@ -238,43 +313,28 @@ String defaultBleName() {
   return String(buffer);
 }
 
+// The clock region stays blank until SNTP has set the time: after power
+// loss that takes until the network is up, and a placeholder would cost
+// the cached screen a clock that is wrong at a glance
 void updateTime() {
-  time_t now = time(nullptr);
-  if (now < 10000) {
-    strlcpy(currentTimeBuf, "--:--", sizeof(currentTimeBuf));
-    return;
-  }
-  struct tm timeinfo;
-  localtime_r(&now, &timeinfo);
-  snprintf(currentTimeBuf, sizeof(currentTimeBuf), "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
-}
-
-// Get current time as HH:MM string (returns newly allocated string or nullptr if invalid)
-String getCurrentTimeString() {
-  time_t now = time(nullptr);
-  if (now < 10000) {
-    return "--:--";
+  char next[sizeof(currentTimeBuf)] = "";
+  if (localClock.valid()) localClock.format(next, sizeof(next));
+  UiModelLock lock;
+  if (strcmp(next, currentTimeBuf) != 0) {
+    strlcpy(currentTimeBuf, next, sizeof(currentTimeBuf));
+    // The clock is drawn in both content modes
+    syncRegionFingerprints(UiMode::Calendar);
+    syncRegionFingerprints(UiMode::Email);
   }
-  struct tm timeinfo;
-  localtime_r(&now, &timeinfo);
-  char buf[6];
-  snprintf(buf, sizeof(buf), "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
-  return String(buf);
 }
 
-// Extract HH:MM from ISO 8601 timestamp (e.g., "2026-01-08T07:50:00+01:00")
-void extractTimeFromISO(const char* isoTime, char* timeBuf, size_t bufSize) {
-  if (!isoTime || bufSize < 6) {
-    strlcpy(timeBuf, "--:--", bufSize);
-    return;
-  }
-  // Format: YYYY-MM-DDTHH:MM:SS...
-  // Extract HH:MM starting at position 11
-  if (strlen(isoTime) > 16) {
-    snprintf(timeBuf, bufSize, "%.5s", isoTime + 11);  // HH:MM
-  } else {
-    strlcpy(timeBuf, "--:--", bufSize);
-  }
+// Sets the note drawn next to the clock. True when it changed.
+bool setStateNotice(const char* notice) {
+  UiModelLock lock;
+  if (!copyToBuffer(stateNoticeBuf, sizeof(stateNoticeBuf), notice)) return false;
+  syncRegionFingerprints(UiMode::Calendar);
+  syncRegionFingerprints(UiMode::Email);
+  return true;
 }
 
 // Check if ISO date is today
@@ -287,9 +347,8 @@ bool isEventToday(const char* isoTime) {
   char eventDate[11];
   snprintf(eventDate, sizeof(eventDate), "%.10s", isoTime);
   
+  if (!localClock.valid()) return false;
   time_t now = time(nullptr);
-  if (now < 10000) return false;
-  
   struct tm timeinfo;
   localtime_r(&now, &timeinfo);
   char todayDate[11];
@@ -298,45 +357,203 @@ bool isEventToday(const char* isoTime) {
   return strcmp(eventDate, todayDate) == 0;
 }
 
+static int dirtySlot(UiMode mode) {
+  return mode == UiMode::Email ? 1 : 0;
+}
+
+// Caller holds the model lock
+void markRegionDirty(UiMode mode, UiRegion region) {
+  if (mode == UiMode::Provisioning) return;
+  dirtyRegions[dirtySlot(mode)] |= uiRegionBit(region);
+  modeFrameValid[dirtySlot(mode)] = false;
+}
+
+static const UiScreen& modeScreen(UiMode mode) {
+  return mode == UiMode::Email ? UI_EMAIL_SCREEN : UI_CALENDAR_SCREEN;
+}
+
+// Records the content fingerprint of a region and marks it dirty when it
+// differs from what is shown. Caller holds the model lock.
+static bool updateRegionFingerprint(UiMode mode, UiRegion region, uint32_t fingerprint) {
+  uint32_t& current = regionFingerprints[dirtySlot(mode)][region];
+  if (current == fingerprint) return false;
+  current = fingerprint;
+  markRegionDirty(mode, region);
+  return true;
+}
+
+// Fingerprints every region of a mode from the texts its screen draws there
+// and marks the changed ones dirty. True when any changed. Caller holds the
+// model lock.
+static bool syncRegionFingerprints(UiMode mode) {
+  bool changed = false;
+  for (uint8_t i = 0; i < UI_REGION_COUNT; ++i) {
+    const UiRegion region = static_cast<UiRegion>(i);
+    if (updateRegionFingerprint(mode, region, uiRegionFingerprint(modeScreen(mode), region, uiTexts))) {
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// Fallback when a mode frame can't be allocated: draw straight into the
+// display buffer. Caller holds the model lock.
+static void drawMode(UiMode mode) {
+  if (mode == UiMode::Provisioning) return;
+  display.firstPage();
+  do {
+    drawScreen(display, modeScreen(mode), uiTexts);
+  } while (display.nextPage());
+}
+
+static GFXcanvas1& modeFrame(UiMode mode) {
+  return mode == UiMode::Email ? emailFrame : calendarFrame;
+}
+
+// Re-rasterise a content mode's frame if it is stale. Returns false when the
+// frame could not be allocated, in which case callers draw directly. Caller
+// holds the model lock.
+static bool renderModeFrameLocked(UiMode mode) {
+  if (mode == UiMode::Provisioning) return false;
+  GFXcanvas1& frame = modeFrame(mode);
+  if (!frame.getBuffer()) return false;
+  if (modeFrameValid[dirtySlot(mode)]) return true;
+  frame.setRotation(DISPLAY_ROTATION);
+  PerfTimer timer(PerfMetric::Rasterise);
+  drawScreen(frame, modeScreen(mode), uiTexts);
+  modeFrameValid[dirtySlot(mode)] = true;
+  return true;
+}
+
+// Keep both content frames current while idle so a toggle never rasterises
+static void prerenderModeFrames() {
+  if (currentUi == UiMode::Provisioning) return;
+  UiModelLock lock;
+  renderModeFrameLocked(UiMode::Calendar);
+  renderModeFrameLocked(UiMode::Email);
+}
+
+// Pushes the part of a frame covering the rotated-UI span [x0,x1)x[y0,y1)
+// with a partial refresh. With DISPLAY_ROTATION 1 native x runs against UI y
+// and native y along UI x; the controller wants x and w on byte boundaries.
+static void pushFramePart(const uint8_t* frame, int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+  int16_t nx0 = (PANEL_NATIVE_W - y1) & ~7;
+  int16_t nx1 = (PANEL_NATIVE_W - y0 + 7) & ~7;
+  int16_t ny0 = x0;
+  int16_t ny1 = x1;
+  if (nx0 < 0) nx0 = 0;
+  if (nx1 > PANEL_NATIVE_W) nx1 = PANEL_NATIVE_W;
+  if (ny0 < 0) ny0 = 0;
+  if (ny1 > PANEL_NATIVE_H) ny1 = PANEL_NATIVE_H;
+  if (nx1 <= nx0 || ny1 <= ny0) return;
+  PerfTimer timer(PerfMetric::PanelRefresh);
+  display.epd2.drawImagePart(frame, nx0, ny0, PANEL_NATIVE_W, PANEL_NATIVE_H,
+                             nx0, ny0, nx1 - nx0, ny1 - ny0);
+}
+
+static void fullRefresh(UiMode mode) {
+  display.setFullWindow();
+  const uint8_t* frame = nullptr;
+  {
+    UiModelLock lock;
+    // A full refresh repaints every region of both modes' current content
+    dirtyRegions[0] = 0;
+    dirtyRegions[1] = 0;
+    if (renderModeFrameLocked(mode)) {
+      frame = modeFrame(mode).getBuffer();
+    } else {
+      drawMode(mode);
+    }
+  }
+  if (frame) {
+    display.epd2.writeImageForFullRefresh(frame, 0, 0, PANEL_NATIVE_W, PANEL_NATIVE_H);
+    {
+      PerfTimer timer(PerfMetric::PanelRefresh);
+      display.epd2.refresh(false);
+    }
+    // Sync the controller's previous-frame RAM for the next partial update
+    display.epd2.writeImageAgain(frame, 0, 0, PANEL_NATIVE_W, PANEL_NATIVE_H);
+  }
+  partialRefreshCount = 0;
+}
+
+// The refresh functions below drive the panel and run on the render task
+// only; other tasks go through requestRender().
 void refreshDisplayForMode(UiMode targetMode) {
   if (currentUi == targetMode) {
     return;
   }
   
   // If switching to calendar mode but no calendar data available, switch to email instead
-  if (targetMode == UiMode::Calendar && gCalSlotPrimary[0] == '\0') {
+  bool calendarEmpty;
+  {
+    UiModelLock lock;
+    calendarEmpty = gCalSlotPrimary[0] == '\0';
+  }
+  if (targetMode == UiMode::Calendar && calendarEmpty) {
     targetMode = UiMode::Email;
+    // Paging past the last mail with no calendar to show wraps in place
+    if (currentUi == targetMode) {
+      refreshDirtyRegions();
+      return;
+    }
   }
   
-  display.setFullWindow();
-  display.firstPage();
-  if (targetMode == UiMode::Calendar) {
-    do {
-      drawCalendar();
-    } while (display.nextPage());
-  } else if (targetMode == UiMode::Email) {
-    do {
-      drawEmail();
-    } while (display.nextPage());
-  }
+  fullRefresh(targetMode);
   currentUi = targetMode;
 }
 
 void refreshCurrentDisplay() {
-  display.setFullWindow();
-  display.firstPage();
-  if (currentUi == UiMode::Calendar) {
-    do {
-      drawCalendar();
-    } while (display.nextPage());
-  } else if (currentUi == UiMode::Email) {
-    do {
-      drawEmail();
-    } while (display.nextPage());
+  fullRefresh(currentUi);
+}
+
+// Redraw only the regions of the current mode whose content changed. The
+// union of the dirty rects goes out as a single partial update so the panel
+// is BUSY once; every PARTIAL_REFRESHES_BEFORE_FULL updates a full refresh
+// clears accumulated ghosting.
+void refreshDirtyRegions() {
+  if (currentUi == UiMode::Provisioning) return;
+  const int slot = dirtySlot(currentUi);
+  {
+    UiModelLock lock;
+    if (dirtyRegions[slot] == 0) return;
+  }
+
+  if (partialRefreshCount >= PARTIAL_REFRESHES_BEFORE_FULL) {
+    fullRefresh(currentUi);
+    return;
   }
+
+  int16_t x0 = INT16_MAX, y0 = INT16_MAX, x1 = 0, y1 = 0;
+  const uint8_t* frame = nullptr;
+  {
+    // Claim the dirty bits and rasterise in one hold, so a change landing
+    // in between is either drawn now or stays dirty for the next pass
+    UiModelLock lock;
+    uint8_t mask = dirtyRegions[slot];
+    dirtyRegions[slot] = 0;
+    for (uint8_t i = 0; i < UI_REGION_COUNT; ++i) {
+      if (!(mask & uiRegionBit(static_cast<UiRegion>(i)))) continue;
+      const UiRect& r = UI_REGION_RECTS[i];
+      if (r.x < x0) x0 = r.x;
+      if (r.y < y0) y0 = r.y;
+      if (r.x + r.w > x1) x1 = r.x + r.w;
+      if (r.y + r.h > y1) y1 = r.y + r.h;
+    }
+    if (renderModeFrameLocked(currentUi)) {
+      frame = modeFrame(currentUi).getBuffer();
+    } else {
+      display.setPartialWindow(x0, y0, x1 - x0, y1 - y0);
+      drawMode(currentUi);
+    }
+  }
+  if (frame) {
+    pushFramePart(frame, x0, y0, x1, y1);
+  }
+  ++partialRefreshCount;
 }
 
-void drawProvisioningScreen(const String& headline, const String& line1, const String& line2, const String& line3) {
+void drawProvisioningScreen(const ProvisioningText& text) {
   display.setFullWindow();
   display.firstPage();
   do {
@@ -344,165 +561,109 @@ void drawProvisioningScreen(const String& headline, const String& line1, const S
     display.setTextColor(GxEPD_BLACK);
     display.setTextSize(2);
     display.setCursor(10, 35);
-    display.print(headline);
+    display.print(text.headline);
 
     display.setTextSize(1);
     display.setCursor(10, 80);
-    display.print(line1);
+    display.print(text.line1);
     display.setCursor(10, 100);
-    display.print(line2);
+    display.print(text.line2);
     display.setCursor(10, 120);
-    display.print(line3);
+    display.print(text.line3);
   } while (display.nextPage());
   currentUi = UiMode::Provisioning;
 }
 
 void handleProvisioningUi() {
+  // Keep the cached content up while Wi-Fi or the backend is unreachable;
+  // BLE still starts for re-pairing, and an unclaimed device drops it
+  if (showingCachedState) return;
   const unsigned long now = millis();
-  String headline = wifiConnected ? "Waiting for pairing" : "Setup this display";
-  String line1 = "Open the Zen AI Phone app";
-  String line2 = wifiConnected
-      ? "Tap 'Connect Display' and follow the instructions"
-      : "Tap 'Connect Display' and follow the instructions";
-  String line3 = "Select BLE " + bleName;
-
-  bool changed =
-      headline != lastProvHeadline ||
-      line1 != lastProvLine1 ||
-      line2 != lastProvLine2 ||
-      line3 != lastProvLine3;
-
-  if (changed) {
-    lastProvHeadline = headline;
-    lastProvLine1 = line1;
-    lastProvLine2 = line2;
-    lastProvLine3 = line3;
-    provisioningDirty = true;
+  ProvisioningText text;
+  strlcpy(text.headline, wifiConnected ? "Waiting for pairing" : "Setup this display", sizeof(text.headline));
+  strlcpy(text.line1, "Open the Zen AI Phone app", sizeof(text.line1));
+  strlcpy(text.line2, "Tap 'Connect Display' and follow the instructions", sizeof(text.line2));
+  snprintf(text.line3, sizeof(text.line3), "Select BLE %s", bleName.c_str());
+
+  {
+    // The render task copies this when it draws the screen
+    UiModelLock lock;
+    if (text != lastProvText) {
+      lastProvText = text;
+      provisioningDirty = true;
+    }
   }
 
   if (!provisioningDirty && (now - lastProvisioningRedraw) < PROVISIONING_MESSAGE_REFRESH_MS) {
     return;
   }
 
-  drawProvisioningScreen(lastProvHeadline, lastProvLine1, lastProvLine2, lastProvLine3);
-  lastProvisioningRedraw = now;
-  provisioningDirty = false;
-}
-
-void ensureBleAdvertising() {
-  NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
-  if (advertising && !advertising->isAdvertising()) {
-    advertising->start();
+  if (requestRender(RenderOp::Provisioning)) {
+    lastProvisioningRedraw = now;
+    provisioningDirty = false;
   }
 }
 
-// Static buffers for BLE characteristic values (must persist!)
-static char pairingBuffer[256];
-static char statusBuffer[64];
-
-void updatePairingCharacteristic() {
-  if (!pairingInfoChar) return;
-  snprintf(pairingBuffer, sizeof(pairingBuffer), 
-           "{\"deviceId\":\"%s\",\"token\":\"%s\"}", 
-           deviceId.c_str(), pairingToken.c_str());
-  Serial.print("Updating pairing characteristic with: ");
-  Serial.println(pairingBuffer);
-  pairingInfoChar->setValue((uint8_t*)pairingBuffer, strlen(pairingBuffer));
-  pairingInfoChar->notify();
+// Lazily starts BLE provisioning on units that booted without it
+static void ensureBleStarted(const char* reason) {
+  bleStartRequested = false;
+  if (bleProvisioning.active()) return;
+  ZEN_LOGI("Starting BLE provisioning: %s", reason);
+  bleProvisioning.setPairingInfo(deviceId.c_str(), pairingToken.c_str());
+  bleProvisioning.start(bleName.c_str());
 }
 
-void updateStatusCharacteristic(const String& status) {
-  if (!statusChar) {
-    Serial.println("ERROR: statusChar is null!");
+// Once the device is claimed and showing content nothing talks to it over
+// BLE any more: shut the stack down and hand its heap back. A connected
+// phone or a re-pair window keeps it up.
+static void releaseBleWhenProvisioned() {
+  if (!bleProvisioning.active() || !stateReady || bleProvisioning.credentialsPending() ||
+      bleProvisioning.connected()) {
     return;
   }
-  Serial.print("Updating status characteristic to: ");
-  Serial.println(status);
-  strncpy(statusBuffer, status.c_str(), sizeof(statusBuffer) - 1);
-  statusBuffer[sizeof(statusBuffer) - 1] = '\0';
-  statusChar->setValue((uint8_t*)statusBuffer, strlen(statusBuffer));
-  statusChar->notify();
-  Serial.println("Status notification sent");
+  if (bleHoldUntil != 0 && static_cast<long>(millis() - bleHoldUntil) < 0) return;
+  bleHoldUntil = 0;
+  ZEN_LOGI("Provisioning complete, releasing BLE");
+  bleProvisioning.stop();
 }
 
-void startBleProvisioning() {
-  if (bleInitialized) {
-    Serial.println("BLE already initialized, ensuring advertising...");
-    ensureBleAdvertising();
-    return;
-  }
-  Serial.print("Starting BLE with name: ");
-  Serial.println(bleName);
-  NimBLEDevice::init(bleName.c_str());
-  NimBLEDevice::setPower(ESP_PWR_LVL_P7);
-  NimBLEServer* server = NimBLEDevice::createServer();
-  NimBLEService* service = server->createService(BLE_SERVICE_UUID);
-
-  NimBLECharacteristic* credentialsChar = service->createCharacteristic(
-      BLE_CREDENTIALS_CHAR_UUID,
-      NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR);
-  credentialsChar->setCallbacks(&gCredentialCallbacks);
-
-  pairingInfoChar = service->createCharacteristic(
-      BLE_PAIRING_CHAR_UUID,
-      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-
-  statusChar = service->createCharacteristic(
-      BLE_STATUS_CHAR_UUID,
-      NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
-
-  service->start();
-  Serial.println("BLE service started");
-  
-  NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
-  advertising->addServiceUUID(BLE_SERVICE_UUID);
-  advertising->setScanResponse(true);
-  advertising->start();
-  Serial.print("BLE advertising started with UUID: ");
-  Serial.println(BLE_SERVICE_UUID);
-
-  updatePairingCharacteristic();
-  updateStatusCharacteristic("idle");
-  bleInitialized = true;
+// Makes url, or BACKEND_BASE_URL when empty, the backend used while
+// registration has not listed any endpoints
+static void applyBackendUrl(const char* url) {
+  strlcpy(backendUrl, url, sizeof(backendUrl));
+  const char* base = backendUrl[0] != '\0' ? backendUrl : BACKEND_BASE_URL;
+  endpoints.setFallback(base);
+  ZEN_LOGI("Backend: %s", base);
 }
 
 void attemptWifiConnection(const String& ssid, const String& password) {
+  AllocAllowed allow;  // the Wi-Fi stack, NVS writes and the credential copies
   if (ssid.isEmpty()) {
     wifiConnected = false;
-    Serial.println("Wi-Fi connection skipped: empty SSID");
+    ZEN_LOGW("Wi-Fi connection skipped: empty SSID");
     return;
   }
-  Serial.print("Attempting Wi-Fi connection to: ");
-  Serial.println(ssid);
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid.c_str(), password.c_str());
-  unsigned long start = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - start < WIFI_CONNECT_TIMEOUT_MS) {
-    delay(250);
-    Serial.print(".");
-  }
-  Serial.println();
-  wifiConnected = WiFi.status() == WL_CONNECTED;
+  ZEN_LOGI("Connecting to Wi-Fi %s", ssid.c_str());
+  PerfTimer connectTimer(PerfMetric::WifiConnect);
+  wifiConnected = wifiLink.connect(ssid.c_str(), password.c_str());
   if (wifiConnected) {
-    Serial.print("Wi-Fi connected! IP: ");
-    Serial.println(WiFi.localIP());
+    connectTimer.stop();
+    ZEN_LOGI("Wi-Fi connected, IP %u.%u.%u.%u", WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2],
+             WiFi.localIP()[3]);
+    backendSession.reset();
+    pushChannel.stop();
     wifiSsid = ssid;
     wifiPassword = password;
     prefs.putString(PREF_WIFI_SSID, wifiSsid);
     prefs.putString(PREF_WIFI_PASS, wifiPassword);
-    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-    // Set timezone to UTC+1 with daylight saving (CET/CEST)
-    // TZ string: CET-1CEST,M3.5.0/2,M10.5.0/3
-    // - Standard time: CET is UTC+1 (note: POSIX uses negative for east of UTC)
-    // - DST: CEST, starts last Sunday of March at 02:00, ends last Sunday of October at 03:00
-    setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0/3", 1);
-    tzset();
-    // Immediately compute currentTimeBuf using localtime with TZ
+    localClock.onNetworkUp();
+    otaUpdater.onNetworkUp();
     updateTime();
-    updateStatusCharacteristic("wifi_connected");
+    bleProvisioning.setStatus(ProvisioningStatus::WifiConnected);
   } else {
-    Serial.println("Wi-Fi connection failed!");
-    updateStatusCharacteristic("wifi_failed");
+    connectTimer.cancel();  // a timeout says nothing about connect latency
+    ZEN_LOGW("Wi-Fi connection failed");
+    bleProvisioning.setStatus(ProvisioningStatus::WifiFailed);
   }
 }
 
@@ -511,7 +672,8 @@ bool ensureWifiConnection() {
     return true;
   }
   wifiConnected = false;
-  if (!wifiSsid.isEmpty()) {
+  // Retries back off after failures instead of blocking every pass
+  if (!wifiSsid.isEmpty() && wifiLink.retryDue()) {
     attemptWifiConnection(wifiSsid, wifiPassword);
   }
   return wifiConnected;
@@ -519,56 +681,59 @@ bool ensureWifiConnection() {
 
 bool registerDeviceWithBackend() {
   if (!wifiConnected) {
-    Serial.println("Cannot register: no Wi-Fi connection");
+    ZEN_LOGW("Cannot register: no Wi-Fi connection");
     return false;
   }
   if (!deviceId.isEmpty() && !deviceSecret.isEmpty()) {
-    Serial.println("Device already registered, using cached credentials");
-    updatePairingCharacteristic();
-    updateStatusCharacteristic("registered");
+    ZEN_LOGI("Device already registered, using stored credentials");
+    bleProvisioning.setPairingInfo(deviceId.c_str(), pairingToken.c_str());
+    bleProvisioning.setStatus(ProvisioningStatus::Registered);
     return true;
   }
 
-  Serial.println("Registering device with backend...");
-  HTTPClient http;
-  String url = String(BACKEND_BASE_URL) + REGISTER_ENDPOINT;
-  if (!http.begin(url)) {
+  ZEN_LOGI("Registering device with backend");
+  HTTPClient* http = backendSession.begin(REGISTER_ENDPOINT);
+  if (!http) {
     return false;
   }
-  http.addHeader("Content-Type", "application/json");
-  StaticJsonDocument<256> doc;
-  doc["hardwareId"] = WiFi.macAddress();
-  doc["firmwareVersion"] = FIRMWARE_VERSION;
-  String body;
-  serializeJson(doc, body);
-  int code = http.POST(body);
+  char body[128];
+  size_t bodyLen;
+  {
+    AllocAllowed allow;  // request headers and the JSON document
+    http->addHeader("Content-Type", "application/json");
+    StaticJsonDocument<256> doc;
+    doc["hardwareId"] = WiFi.macAddress();
+    doc["firmwareVersion"] = FIRMWARE_VERSION;
+    doc["model"] = DEVICE_MODEL;
+    bodyLen = serializeJson(doc, body, sizeof(body));
+  }
+  int code = backendSession.send("POST", body, bodyLen);
   if (code != HTTP_CODE_CREATED) {
-    http.end();
+    backendSession.end();
     return false;
   }
-  DynamicJsonDocument response(512);
-  DeserializationError err = deserializeJson(response, http.getString());
-  http.end();
-  if (err) {
-    return false;
+  bool renamed;
+  {
+    AllocAllowed allow;  // the JSON document and the new credential Strings
+    DynamicJsonDocument response(512);
+    DeserializationError err = deserializeJson(response, http->getString());
+    backendSession.end();
+    if (err) {
+      return false;
+    }
+    deviceId = response["deviceId"].as<String>();
+    deviceSecret = response["deviceSecret"].as<String>();
+    pairingToken = response["pairingToken"].as<String>();
+    // Later requests go to the fastest of the endpoints listed here, if any
+    endpoints.assign(response["endpoints"].as<JsonArrayConst>());
+    const char* newBleName = response["bluetoothName"] | "";
+    renamed = newBleName[0] != '\0';
+    if (renamed) bleName = newBleName;
   }
-  deviceId = response["deviceId"].as<String>();
-  deviceSecret = response["deviceSecret"].as<String>();
-  pairingToken = response["pairingToken"].as<String>();
-  Serial.print("Backend registration successful. DeviceId: ");
-  Serial.println(deviceId);
-  Serial.print("Pairing token: ");
-  Serial.println(pairingToken);
-  Serial.print("Device secret (debug): ");
-  Serial.println(deviceSecret);
-  String newBleName = response["bluetoothName"].as<String>();
-  if (!newBleName.isEmpty()) {
-    bleName = newBleName;
+  ZEN_LOGI("Registered as device %s", deviceId.c_str());
+  if (renamed) {
     prefs.putString(PREF_BLE_NAME, bleName);
-    if (bleInitialized) {
-      NimBLEDevice::setDeviceName(bleName.c_str());
-      ensureBleAdvertising();
-    }
+    bleProvisioning.rename(bleName.c_str());
   }
   prefs.putString(PREF_DEVICE_ID, deviceId);
   prefs.putString(PREF_DEVICE_SECRET, deviceSecret);
@@ -576,208 +741,417 @@ bool registerDeviceWithBackend() {
   prefs.putString(PREF_FIRMWARE, FIRMWARE_VERSION);
   deviceRegistered = true;
   stateReady = false;
-  updatePairingCharacteristic();
-  updateStatusCharacteristic("registered");
+  bleProvisioning.setPairingInfo(deviceId.c_str(), pairingToken.c_str());
+  bleProvisioning.setStatus(ProvisioningStatus::Registered);
   return true;
 }
 
+// Common tail of a successful fetch, whether the body was parsed or the
+// backend answered 304 Not Modified
+static void finishStateFetch(bool contentChanged) {
+  updateTime();
+  // Fresh content replaces the cached screen: drop its notice
+  bool wasCached = showingCachedState;
+  showingCachedState = false;
+  if (setStateNotice("")) contentChanged = true;
+  stateReady = true;
+  // Network, backend and decoding all work: a new image has proved itself
+  otaUpdater.confirm();
+  bleProvisioning.setStatus(ProvisioningStatus::Ready);
+  ZEN_LOGD("State fetch successful, display ready");
+  // Refresh only if content changed or we have a minute tick pending. The
+  // cached screen was queued in setup(), so it is only ever updated in place.
+  if (currentUi == UiMode::Provisioning && !wasCached) {
+    requestRender(RenderOp::ShowMode, UiMode::Calendar);
+    minuteRefreshPending = false;
+  } else if (contentChanged || minuteRefreshPending) {
+    requestRender(RenderOp::DirtyRegions);
+    minuteRefreshPending = false;
+  } else {
+    // No redraw needed
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Item paging
+// -----------------------------------------------------------------------------
+// Each mode shows a window of three items of stateTable starting at its
+// selection: the selected item fills the selected box and the detail box,
+// the two after it the slots below. The mode button steps the selection
+// and only those boxes are redrawn; stepping past the last item moves on to
+// the other mode. The id is kept with the index so a fetch that reorders a
+// list leaves the same item selected.
+static constexpr size_t UI_MAX_SHOWN = STATE_MAX_EVENTS > STATE_MAX_MAILS ? STATE_MAX_EVENTS : STATE_MAX_MAILS;
+ZEN_RETAINED static uint8_t selectedIndex[2] = {0, 0};  // per content mode, into the shown items
+ZEN_RETAINED static uint32_t selectedId[2] = {0, 0};
+
+// Items of stateTable a mode shows, as indices into its list
+struct ShownItems {
+  uint8_t count;
+  uint8_t index[UI_MAX_SHOWN];
+};
+
+// Calendar: today's events only; email: every mail. Caller holds the model lock.
+static void collectShownItems(UiMode mode, ShownItems& shown) {
+  shown.count = 0;
+  if (mode == UiMode::Calendar) {
+    const StateEventList& events = stateTable.events;
+    for (uint8_t i = 0; i < events.count; ++i) {
+      if (events.start(i)[0] != '\0' && isEventToday(events.start(i))) shown.index[shown.count++] = i;
+    }
+  } else {
+    for (uint8_t i = 0; i < stateTable.mails.count; ++i) shown.index[shown.count++] = i;
+  }
+}
+
+// Position of a mode's selection in its shown items: the item selected
+// before if it is still there, otherwise the same position clamped to the
+// list. Caller holds the model lock.
+static uint8_t resolveSelection(UiMode mode, const ShownItems& shown, const uint32_t* ids) {
+  const int slot = dirtySlot(mode);
+  for (uint8_t i = 0; i < shown.count && selectedId[slot] != 0; ++i) {
+    if (ids[shown.index[i]] == selectedId[slot]) {
+      selectedIndex[slot] = i;
+      return i;
+    }
+  }
+  if (selectedIndex[slot] >= shown.count) selectedIndex[slot] = shown.count > 0 ? shown.count - 1 : 0;
+  selectedId[slot] = shown.count > 0 ? ids[shown.index[selectedIndex[slot]]] : 0;
+  return selectedIndex[slot];
+}
+
+// UI buffers the item windows are laid out into (text_layout.h)
+static const CalendarBoxes calendarBoxes = {
+    {gCalSlotPrimary, sizeof(gCalSlotPrimary)},
+    {{gCalSelected, sizeof(gCalSelected)}, {gCalSlotSecondary, sizeof(gCalSlotSecondary)}, {gCalSlotThird, sizeof(gCalSlotThird)}},
+    {gCalLocation, sizeof(gCalLocation)},
+};
+static const EmailBoxes emailBoxes = {
+    {{gMailSelected, sizeof(gMailSelected)}, {gMailSlotPrimary, sizeof(gMailSlotPrimary)}, {gMailSender, sizeof(gMailSender)}},
+    {gMailSummary, sizeof(gMailSummary)},
+    &_mail_lines_buf[0][0], sizeof(_mail_lines_buf[0]),
+};
+
+// Lays the calendar window out into its UI buffers, marking the regions
+// whose drawn text changed dirty. Caller holds the model lock.
+static bool layoutCalendarItems() {
+  ShownItems shown;
+  collectShownItems(UiMode::Calendar, shown);
+  const uint8_t first = resolveSelection(UiMode::Calendar, shown, stateTable.events.id);
+  if (shown.count == 0) {
+    ZEN_LOGD("No calendar items today");
+  }
+  layoutCalendarWindow(uiLargeFont, stateTable.events, shown.index, shown.count, first, calendarBoxes);
+  return syncRegionFingerprints(UiMode::Calendar);
+}
+
+// Email counterpart of layoutCalendarItems(): the senders go in the list,
+// the AI summary of the selected mail is wrapped into the detail box. With
+// no mail at all the placeholder texts stay. Caller holds the model lock.
+static bool layoutEmailItems() {
+  const StateMailList& mails = stateTable.mails;
+  ShownItems shown;
+  collectShownItems(UiMode::Email, shown);
+  const uint8_t first = resolveSelection(UiMode::Email, shown, mails.id);
+  if (shown.count == 0) {
+    ZEN_LOGD("No email items");
+    return false;
+  }
+  ZEN_LOGD("Email from %s: %s", mails.from(shown.index[first]), mails.snippet(shown.index[first]));
+  // The AI summary of the selected mail is wrapped into the detail box
+  layoutEmailWindow(uiLargeFont, uiSmallFont, mails, shown.index, shown.count, first, emailBoxes);
+  return syncRegionFingerprints(UiMode::Email);
+}
+
+// Brings the UI buffers of both modes in line with stateTable and the
+// selections. Returns true when the visible content changed. Caller holds
+// the model lock.
+static bool layoutSelectedItems() {
+  bool calendarChanged = layoutCalendarItems();
+  bool emailChanged = layoutEmailItems();
+  return calendarChanged || emailChanged;
+}
+
+// Mode button: steps the shown mode to its next item, and past the last one
+// over to the first item of the other mode. Runs on the render task, after
+// any mode change queued before it. While the screen still shows cached
+// content there is no table behind it to page through, so the press only
+// switches modes.
+static void showNextItem() {
+  const UiMode mode = currentUi;
+  if (mode == UiMode::Provisioning) return;
+  const UiMode other = mode == UiMode::Calendar ? UiMode::Email : UiMode::Calendar;
+  bool stepped = false;
+  if (!showingCachedState) {
+    UiModelLock lock;
+    const int slot = dirtySlot(mode);
+    ShownItems shown;
+    collectShownItems(mode, shown);
+    if (selectedIndex[slot] + 1 < shown.count) {
+      ++selectedIndex[slot];
+      stepped = true;
+    } else {
+      selectedIndex[slot] = 0;
+      selectedIndex[dirtySlot(other)] = 0;
+      selectedId[dirtySlot(other)] = 0;
+    }
+    // The index moved deliberately, so don't let the old id pull it back
+    selectedId[slot] = 0;
+    layoutSelectedItems();
+  }
+  if (stepped) {
+    refreshDirtyRegions();
+  } else {
+    refreshDisplayForMode(other);
+  }
+}
+
+// Strips the quotes (and weak prefix) from an ETag header value
+static void copyEtagVersion(char* target, size_t capacity, const char* etag) {
+  const char* value = etag;
+  if (strncmp(value, "W/", 2) == 0) value += 2;
+  if (*value == '"') ++value;
+  strlcpy(target, value, capacity);
+  size_t len = strlen(target);
+  if (len > 0 && target[len - 1] == '"') target[len - 1] = '\0';
+}
+
+// UI content kept by offlineCache: the laid-out buffers together with the
+// region fingerprints they were built from, so the first fetch after boot
+// finds unchanged regions already up to date and only redraws the rest
+struct CachedUiContent {
+  char calSlotPrimary[sizeof(gCalSlotPrimary)];
+  char calSlotSecondary[sizeof(gCalSlotSecondary)];
+  char calSlotThird[sizeof(gCalSlotThird)];
+  char calLocation[sizeof(gCalLocation)];
+  char calSelected[sizeof(gCalSelected)];
+  char mailSlotPrimary[sizeof(gMailSlotPrimary)];
+  char mailSelected[sizeof(gMailSelected)];
+  char mailSender[sizeof(gMailSender)];
+  char mailSummary[sizeof(gMailSummary)];
+  char mailLines[UI_SUMMARY_LINES][sizeof(_mail_lines_buf[0])];
+  uint32_t regionFingerprints[2][UI_REGION_COUNT];
+};
+
+static CachedUiContent cachedUi;  // staging copy, too large for the network task stack
+
+// Writes the applied content to flash if it differs from the stored record
+static void persistUiContent() {
+  // Zeroed first so bytes left behind a terminator by longer, older text
+  // can't change the fingerprint of otherwise identical content
+  memset(&cachedUi, 0, sizeof(cachedUi));
+  {
+    UiModelLock lock;
+    strlcpy(cachedUi.calSlotPrimary, gCalSlotPrimary, sizeof(cachedUi.calSlotPrimary));
+    strlcpy(cachedUi.calSlotSecondary, gCalSlotSecondary, sizeof(cachedUi.calSlotSecondary));
+    strlcpy(cachedUi.calSlotThird, gCalSlotThird, sizeof(cachedUi.calSlotThird));
+    strlcpy(cachedUi.calLocation, gCalLocation, sizeof(cachedUi.calLocation));
+    strlcpy(cachedUi.calSelected, gCalSelected, sizeof(cachedUi.calSelected));
+    strlcpy(cachedUi.mailSlotPrimary, gMailSlotPrimary, sizeof(cachedUi.mailSlotPrimary));
+    strlcpy(cachedUi.mailSelected, gMailSelected, sizeof(cachedUi.mailSelected));
+    strlcpy(cachedUi.mailSender, gMailSender, sizeof(cachedUi.mailSender));
+    strlcpy(cachedUi.mailSummary, gMailSummary, sizeof(cachedUi.mailSummary));
+    for (uint8_t i = 0; i < UI_SUMMARY_LINES; ++i) {
+      strlcpy(cachedUi.mailLines[i], _mail_lines_buf[i], sizeof(cachedUi.mailLines[i]));
+    }
+    memcpy(cachedUi.regionFingerprints, regionFingerprints, sizeof(regionFingerprints));
+  }
+  if (offlineCache.store(&cachedUi, sizeof(cachedUi))) {
+    ZEN_LOGI("Offline cache updated");
+  }
+}
+
+// Puts the last persisted content into the UI buffers, marked as cached.
+// False when flash holds no usable record.
+static bool restoreUiContent() {
+  if (!offlineCache.load(&cachedUi, sizeof(cachedUi))) return false;
+  {
+    UiModelLock lock;
+    // Terminate every field in case a record was written by a build that
+    // did not, before any of it reaches the draw code
+    copyToBuffer(gCalSlotPrimary, sizeof(gCalSlotPrimary), cachedUi.calSlotPrimary);
+    copyToBuffer(gCalSlotSecondary, sizeof(gCalSlotSecondary), cachedUi.calSlotSecondary);
+    copyToBuffer(gCalSlotThird, sizeof(gCalSlotThird), cachedUi.calSlotThird);
+    copyToBuffer(gCalLocation, sizeof(gCalLocation), cachedUi.calLocation);
+    copyToBuffer(gCalSelected, sizeof(gCalSelected), cachedUi.calSelected);
+    copyToBuffer(gMailSlotPrimary, sizeof(gMailSlotPrimary), cachedUi.mailSlotPrimary);
+    copyToBuffer(gMailSelected, sizeof(gMailSelected), cachedUi.mailSelected);
+    copyToBuffer(gMailSender, sizeof(gMailSender), cachedUi.mailSender);
+    copyToBuffer(gMailSummary, sizeof(gMailSummary), cachedUi.mailSummary);
+    for (uint8_t i = 0; i < UI_SUMMARY_LINES; ++i) {
+      copyToBuffer(_mail_lines_buf[i], sizeof(_mail_lines_buf[i]), cachedUi.mailLines[i]);
+    }
+    memcpy(regionFingerprints, cachedUi.regionFingerprints, sizeof(regionFingerprints));
+    modeFrameValid[0] = false;
+    modeFrameValid[1] = false;
+  }
+  setStateNotice(STATE_NOTICE_CACHED);
+  showingCachedState = true;
+  return true;
+}
+
+// The cached content belongs to a pairing that no longer holds
+static void dropCachedState() {
+  offlineCache.forget();
+  showingCachedState = false;
+  setStateNotice("");
+}
+
 bool fetchDeviceState() {
   if (!wifiConnected || deviceId.isEmpty() || deviceSecret.isEmpty()) {
     return false;
   }
-  HTTPClient http;
-  String url = String(BACKEND_BASE_URL) + STATE_ENDPOINT;
-  if (!http.begin(url)) {
+  // Ask for a delta against the items we hold once we hold any
+  char statePath[sizeof(STATE_ENDPOINT) + 7 + STATE_VERSION_LEN];
+  if (stateTable.version[0] != '\0') {
+    snprintf(statePath, sizeof(statePath), "%s?since=%s", STATE_ENDPOINT, stateTable.version);
+  } else {
+    strlcpy(statePath, STATE_ENDPOINT, sizeof(statePath));
+  }
+  HTTPClient* http = backendSession.begin(statePath);
+  if (!http) {
     return false;
   }
-  // Debug: print credentials used for state fetch
-  Serial.print("Fetching state with DeviceId: ");
-  Serial.println(deviceId);
-  Serial.print("Fetching state with DeviceSecret: ");
-  Serial.println(deviceSecret);
-  http.addHeader("X-Device-Id", deviceId);
-  http.addHeader("X-Device-Secret", deviceSecret);
-  int code = http.GET();
-  Serial.print("State fetch HTTP code: ");
-  Serial.println(code);
+  ZEN_LOGD("Fetching %s", statePath);
+  {
+    AllocAllowed allow;  // HTTPClient keeps the request headers as Strings
+    http->addHeader("X-Device-Id", deviceId);
+    http->addHeader("X-Device-Secret", deviceSecret);
+    if (stateTable.version[0] != '\0') {
+      char ifNoneMatch[STATE_VERSION_LEN + 2];
+      snprintf(ifNoneMatch, sizeof(ifNoneMatch), "\"%s\"", stateTable.version);
+      http->addHeader("If-None-Match", ifNoneMatch);
+    }
+    // Prefer the compact binary encoding; JSON stays the fallback
+    http->addHeader("Accept", STATE_ACCEPT);
+    static const char* stateResponseHeaders[] = {"ETag", "Content-Type"};
+    http->collectHeaders(stateResponseHeaders, 2);
+  }
+  PerfTimer getTimer(PerfMetric::HttpGet);
+  int code = backendSession.send("GET");
+  getTimer.stop();
+  ZEN_LOGD("State fetch HTTP code: %d", code);
+  if (code == HTTP_CODE_NOT_MODIFIED) {
+    // Nothing changed since the applied state: no body, no parse, no fingerprints
+    backendSession.end();
+    finishStateFetch(false);
+    return true;
+  }
   if (code == HTTP_CODE_CONFLICT) {
     stateReady = false;
-    String resp = http.getString();
-    Serial.print("State fetch response (conflict): ");
-    Serial.println(resp);
-    http.end();
-    updateStatusCharacteristic("waiting_for_claim");
+    ZEN_LOGW("State fetch: device not claimed");
+    backendSession.end();
+    // Unclaimed: the provisioning screen replaces whatever was cached
+    dropCachedState();
+    // Pairing goes through the phone app, which reads the token over BLE
+    ensureBleStarted("device not claimed");
+    bleProvisioning.setStatus(ProvisioningStatus::WaitingForClaim);
+    // Waiting for the owner is not the image's fault
+    otaUpdater.onBackendReached();
     return false;
   }
   if (code != HTTP_CODE_OK) {
-    String resp = http.getString();
-    Serial.print("State fetch unexpected response: ");
-    Serial.println(resp);
-    http.end();
+    ZEN_LOGW("State fetch unexpected HTTP code: %d", code);
+    backendSession.end();
     return false;
   }
-  String payload = http.getString();
-  Serial.print("State response: ");
-  Serial.println(payload);
-  http.end();
-  
-  DynamicJsonDocument doc(4096);
-  DeserializationError err = deserializeJson(doc, payload);
-  if (err) {
-    Serial.print("JSON parse error: ");
-    Serial.println(err.c_str());
-    return false;
-  }
-  
-  // Parse calendar directly
-  JsonObjectConst calObj = doc["calendar"];
-  Serial.print("Calendar obj - connected: ");
-  Serial.println(calObj["connected"] | false);
-  JsonArrayConst calItems = calObj["items"];
-  
-  // Collect up to three events to show: only today's
-  String formatted[3];
-  String locs[3];
-  int count = 0;
-  // First pass: today-only
-  for (size_t i = 0; i < calItems.size() && count < 3; i++) {
-    JsonObjectConst item = calItems[i];
-    String start = item["start"] | "";
-    if (start.isEmpty()) continue;
-    if (isEventToday(start.c_str())) {
-      String summary = item["summary"] | "";
-      char timeBuf[6];
-      extractTimeFromISO(start.c_str(), timeBuf, sizeof(timeBuf));
-      formatted[count] = String(timeBuf) + " " + summary;
-      locs[count] = item["location"] | "";
-      Serial.print("Calendar today - "); Serial.println(formatted[count]);
-      count++;
-    }
+  char etag[STATE_VERSION_LEN + 4];  // room for the quotes and a weak prefix
+  char contentType[64];
+  {
+    AllocAllowed allow;  // header() hands out String copies
+    strlcpy(etag, http->header("ETag").c_str(), sizeof(etag));
+    strlcpy(contentType, http->header("Content-Type").c_str(), sizeof(contentType));
   }
-  if (count == 0) {
-    Serial.println("No calendar items available");
-    // Clear calendar UI when no events today
-    copyToBuffer(gCalSlotPrimary, sizeof(gCalSlotPrimary), "");
-    copyToBuffer(gCalSelected, sizeof(gCalSelected), "");
-    copyToBuffer(gCalLocation, sizeof(gCalLocation), "");
-    copyToBuffer(gCalSlotSecondary, sizeof(gCalSlotSecondary), "");
-    copyToBuffer(gCalSlotThird, sizeof(gCalSlotThird), "");
+
+  // Decode into a copy so a truncated body or rejected delta leaves the
+  // table untouched
+  static DeviceStateSnapshot staging;
+  staging = stateTable;
+  bool decoded;
+  PerfTimer parseTimer(PerfMetric::StateParse);
+  if (strncmp(contentType, STATE_MIME_MSGPACK, sizeof(STATE_MIME_MSGPACK) - 1) == 0) {
+    decoded = decodeStateMsgPack(http->getStream(), staging);
   } else {
-    // Fill UI buffers
-    copyToBuffer(gCalSlotPrimary, sizeof(gCalSlotPrimary), formatted[0]);  // selected header line
-    copyToBuffer(gCalSelected, sizeof(gCalSelected), formatted[0]);
-    copyToBuffer(gCalLocation, sizeof(gCalLocation), locs[0]);
-    copyToBuffer(gCalSlotSecondary, sizeof(gCalSlotSecondary), (count > 1) ? formatted[1] : "");
-    copyToBuffer(gCalSlotThird, sizeof(gCalSlotThird), (count > 2) ? formatted[2] : "");
-  }
-  
-  // Parse email directly
-  JsonObjectConst emailObj = doc["email"];
-  Serial.print("Email obj - connected: ");
-  Serial.println(emailObj["connected"] | false);
-  JsonArrayConst emailItems = emailObj["items"];
-  String mailSubject = "";
-  String mailSender = "";
-  String mailSnippet = "";
-  String senders[3] = {"", "", ""};
-  size_t mailCount = 0;
-  if (emailItems.size() > 0) {
-    // Collect up to three senders; keep subject/snippet from first
-    String summaries[3];
-    for (size_t i = 0; i < emailItems.size() && mailCount < 3; ++i) {
-      JsonObjectConst it = emailItems[i];
-      senders[mailCount] = it["from"] | "";
-      summaries[mailCount] = it["snippet"] | "";
-      if (mailCount == 0) {
-        mailSubject = it["subject"] | "";
-        mailSnippet = it["snippet"] | "";
-      }
-      mailCount++;
+    // The JSON fallback parses into a heap-backed ArduinoJson document
+    AllocAllowed allow;
+    if (http->getSize() >= 0) {
+      // Content-Length known: parse straight from the socket without a copy
+      decoded = decodeStateJson(http->getStream(), staging);
+    } else {
+      // Chunked transfer can't be parsed from the raw stream; fall back to a copy
+      decoded = decodeStateJson(http->getString(), staging);
     }
-    // Log primary info
-    Serial.print("Email - Subject: ");
-    Serial.println(mailSubject);
-    Serial.print("Email - From: ");
-    Serial.println(senders[0]);
-    Serial.print("Email - Summary: ");
-    Serial.println(mailSnippet);
-    // Selected (top) should show sender of the first email
-    copyToBuffer(gMailSelected, sizeof(gMailSelected), senders[0]);
-    // Rows below: show other senders if available
-    copyToBuffer(gMailSlotPrimary, sizeof(gMailSlotPrimary), mailCount > 1 ? senders[1] : "");
-    copyToBuffer(gMailSender, sizeof(gMailSender), mailCount > 2 ? senders[2] : "");
-    // Preserve summary/snippet (AI-generated content summary)
-    copyToBuffer(gMailSummary, sizeof(gMailSummary), mailSnippet);
-    updateMailSummaryLines(gMailSummary);
-  } else {
-    Serial.println("No email items");
   }
-  
-  // Build a compact signature of the visible content to avoid unnecessary redraws
-  String sig = "cal:";
-  sig += String(count);
-  for (int i = 0; i < count; ++i) {
-    sig += "|";
-    sig += formatted[i];
-  }
-  if (count > 0) {
-    sig += "|loc0:";
-    sig += locs[0];
-  }
-  sig += ";mail:";
-  sig += mailSubject; sig += "|"; sig += senders[0]; sig += "|"; sig += mailSnippet;
-  char newSig[sizeof(lastStateSignature)] = {0};
-  sig.substring(0, sizeof(lastStateSignature) - 1).toCharArray(newSig, sizeof(newSig));
-  bool contentChanged = strcmp(lastStateSignature, newSig) != 0;
-  if (contentChanged) {
-    strncpy(lastStateSignature, newSig, sizeof(lastStateSignature) - 1);
-    lastStateSignature[sizeof(lastStateSignature) - 1] = '\0';
+  backendSession.end();
+  parseTimer.stop();
+  if (!decoded) {
+    ZEN_LOGW("State decode failed");
+    // Drop the base so the next fetch asks for a full snapshot
+    stateTable.version[0] = '\0';
+    return false;
   }
-  
-  updateTime();
-  stateReady = true;
-  updateStatusCharacteristic("ready");
-  Serial.println("State fetch successful, display ready");
-  // Refresh only if content changed or we have a minute tick pending
-  if (currentUi == UiMode::Provisioning) {
-    refreshDisplayForMode(UiMode::Calendar);
-    minuteRefreshPending = false;
-  } else if (contentChanged || minuteRefreshPending) {
-    refreshCurrentDisplay();
-    minuteRefreshPending = false;
-  } else {
-    // No redraw needed
+
+  // Only remember the version once its state has actually been applied
+  copyEtagVersion(staging.version, sizeof(staging.version), etag);
+  if (localClock.setTimezone(staging.timezone)) {
+    ZEN_LOGI("Time zone: %s", staging.timezone);
+    updateTime();
   }
+  bool contentChanged;
+  {
+    // The render task pages through the table
+    UiModelLock lock;
+    stateTable = staging;
+    contentChanged = layoutSelectedItems();
+  }
+  persistUiContent();
+
+  finishStateFetch(contentChanged);
   return true;
 }
 
 void sendHeartbeat() {
   if (!wifiConnected || deviceId.isEmpty()) return;
-  HTTPClient http;
-  String url = String(BACKEND_BASE_URL) + HEARTBEAT_ENDPOINT;
-  if (!http.begin(url)) {
+  HTTPClient* http = backendSession.begin(HEARTBEAT_ENDPOINT);
+  if (!http) {
     return;
   }
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("X-Device-Id", deviceId);
-  http.addHeader("X-Device-Secret", deviceSecret);
-  StaticJsonDocument<256> doc;
-  if (wifiConnected) {
-    doc["wifiSsid"] = wifiSsid;
-    doc["wifiRssi"] = WiFi.RSSI();
+  static char body[1536];
+  size_t bodyLen;
+  {
+    AllocAllowed allow;  // request headers and the JSON document
+    http->addHeader("Content-Type", "application/json");
+    http->addHeader("X-Device-Id", deviceId);
+    http->addHeader("X-Device-Secret", deviceSecret);
+    StaticJsonDocument<1536> doc;
+    if (wifiConnected) {
+      doc["wifiSsid"] = wifiSsid;
+      doc["wifiRssi"] = WiFi.RSSI();
+    }
+    doc["firmwareVersion"] = FIRMWARE_VERSION;
+    doc["model"] = DEVICE_MODEL;
+    perfWriteReport(doc.createNestedObject("perf"));
+    bodyLen = serializeJson(doc, body, sizeof(body));
+  }
+  int code = backendSession.send("POST", body, bodyLen);
+  if (code == HTTP_CODE_OK) {
+    // The response advertises a newer firmware build, if there is one
+    AllocAllowed allow;  // the JSON documents
+    StaticJsonDocument<64> filter;
+    filter["firmware"] = true;
+    StaticJsonDocument<512> response;
+    if (!deserializeJson(response, http->getStream(), DeserializationOption::Filter(filter))) {
+      otaUpdater.offer(response["firmware"]);
+    }
   }
-  doc["firmwareVersion"] = FIRMWARE_VERSION;
-  String body;
-  serializeJson(doc, body);
-  http.POST(body);
-  http.end();
+  backendSession.end();
 }
 
 // -----------------------------------------------------------------------------
 // Reset functionality
 // -----------------------------------------------------------------------------
 void performFactoryReset() {
-  Serial.println("Factory reset initiated - clearing all data...");
+  ZEN_LOGI("Factory reset: clearing all data");
   
   // Clear all preferences
   prefs.remove(PREF_WIFI_SSID);
@@ -786,7 +1160,11 @@ void performFactoryReset() {
   prefs.remove(PREF_DEVICE_SECRET);
   prefs.remove(PREF_PAIRING_TOKEN);
   prefs.remove(PREF_BLE_NAME);
+  prefs.remove(PREF_BACKEND_URL);
   prefs.remove(PREF_FIRMWARE);
+  wifiLink.forget();
+  offlineCache.forget();
+  endpoints.forget();
   
   // Clear runtime variables
   wifiSsid = "";
@@ -802,32 +1180,205 @@ void performFactoryReset() {
   stateReady = false;
   currentUi = UiMode::Provisioning;
   
-  // Clear BLE if initialized
-  if (bleInitialized) {
-    NimBLEDevice::deinit();
-    bleInitialized = false;
-  }
+  bleProvisioning.stop();
   
-  Serial.println("All data cleared. Device will restart...");
+  ZEN_LOGI("All data cleared, restarting");
+  logFlush();
   delay(1000);
   ESP.restart();
 }
 
+// -----------------------------------------------------------------------------
+// Low-power duty cycle
+// -----------------------------------------------------------------------------
+static uint64_t buttonWakeMask() {
+  // ext1 can only watch RTC-capable GPIOs; pins outside that set (GPIO19 on the
+  // current wiring) are read on the next timer wake instead
+  uint64_t mask = 0;
+  if (rtc_gpio_is_valid_gpio(static_cast<gpio_num_t>(MODE_PIN))) mask |= 1ULL << MODE_PIN;
+  if (rtc_gpio_is_valid_gpio(static_cast<gpio_num_t>(RESET_PIN))) mask |= 1ULL << RESET_PIN;
+  return mask;
+}
+
+static uint64_t millisUntilNextMinute() {
+  if (!localClock.valid()) {
+    return STATE_REFRESH_INTERVAL_MS;
+  }
+  return localClock.millisToNextMinute() + LOW_POWER_WAKE_MARGIN_MS;
+}
+
+// Only sleep once the display shows fetched content; provisioning and
+// pairing keep the radio up until they complete.
+static bool canEnterLowPowerSleep() {
+  return ZEN_LOW_POWER && stateReady && deviceRegistered && !bleProvisioning.credentialsPending() &&
+         currentUi != UiMode::Provisioning && !buttons.anyPressed();
+}
+
+void enterLowPowerSleep() {
+  // Let queued redraws reach the panel before it hibernates
+  flushRender();
+  uint64_t sleepMs = millisUntilNextMinute();
+  ZEN_LOGD("Entering deep sleep for %lu ms", static_cast<unsigned long>(sleepMs));
+  logFlush();
+
+  display.hibernate();
+  bleProvisioning.stop();
+  backendSession.reset();
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+
+  uint64_t mask = buttonWakeMask();
+  for (int pin : {MODE_PIN, RESET_PIN}) {
+    if (mask & (1ULL << pin)) {
+      rtc_gpio_pullup_dis(static_cast<gpio_num_t>(pin));
+      rtc_gpio_pulldown_en(static_cast<gpio_num_t>(pin));
+    }
+  }
+  if (mask) {
+    esp_sleep_enable_ext1_wakeup(mask, ESP_EXT1_WAKEUP_ANY_HIGH);
+  }
+  esp_sleep_enable_timer_wakeup(sleepMs * 1000ULL);
+  esp_deep_sleep_start();
+}
+
+// Handle a button that woke us from deep sleep before the network comes up.
+// A reset button that is still held is picked up by the input subsystem and
+// only resets once it has been held for RESET_HOLD_MS.
+static void handleWakeButtons() {
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT1) return;
+  uint64_t pins = esp_sleep_get_ext1_wakeup_status();
+  if (pins & (1ULL << MODE_PIN)) {
+    requestRender(RenderOp::NextItem);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Render and input tasks
+// -----------------------------------------------------------------------------
+bool requestRender(RenderOp op, UiMode mode) {
+  RenderRequest request{op, mode, nullptr};
+  if (xQueueSend(renderQueue, &request, pdMS_TO_TICKS(RENDER_POST_TIMEOUT_MS)) != pdTRUE) {
+    ZEN_LOGW("Render queue full, request dropped");
+    return false;
+  }
+  return true;
+}
+
+// Blocks until everything queued before the call has reached the panel
+void flushRender() {
+  RenderRequest request{RenderOp::Flush, UiMode::Provisioning, xTaskGetCurrentTaskHandle()};
+  if (xQueueSend(renderQueue, &request, pdMS_TO_TICKS(RENDER_FLUSH_TIMEOUT_MS)) == pdTRUE) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RENDER_FLUSH_TIMEOUT_MS));
+  }
+}
+
+static void renderTask(void*) {
+  allocDebugTrackCurrentTask();
+  RenderRequest request;
+  for (;;) {
+    if (xQueueReceive(renderQueue, &request, portMAX_DELAY) != pdTRUE) continue;
+    switch (request.op) {
+      case RenderOp::DirtyRegions:
+        refreshDirtyRegions();
+        break;
+      case RenderOp::ShowMode:
+        refreshDisplayForMode(request.mode);
+        break;
+      case RenderOp::NextItem:
+        showNextItem();
+        break;
+      case RenderOp::Provisioning: {
+        ProvisioningText text;
+        {
+          UiModelLock lock;
+          text = lastProvText;
+        }
+        drawProvisioningScreen(text);
+        break;
+      }
+      case RenderOp::Flush:
+        xTaskNotifyGive(request.notify);
+        break;
+    }
+    if (uxQueueMessagesWaiting(renderQueue) == 0) {
+      // Idle: bring the cached mode frames up to date for the next toggle
+      prerenderModeFrames();
+    }
+    allocDebugReport("render");
+  }
+}
+
+static void inputTask(void*) {
+  ButtonEvent event;
+  for (;;) {
+    if (!buttons.waitEvent(event, portMAX_DELAY)) continue;
+    if (event.button == modeButton) {
+      if (event.type == ButtonEventType::Pressed && (stateReady || showingCachedState)) {
+        updateTime();
+        requestRender(RenderOp::NextItem);
+      } else if (event.type == ButtonEventType::LongPress && !bleProvisioning.active()) {
+        ZEN_LOGI("Mode button held, starting BLE provisioning");
+        bleStartRequested = true;
+      }
+    } else if (event.button == resetButton) {
+      if (event.type == ButtonEventType::Pressed) {
+        ZEN_LOGI("Reset button pressed, hold to factory reset");
+      } else if (event.type == ButtonEventType::LongPress) {
+        ZEN_LOGI("Reset button held, performing factory reset");
+        performFactoryReset();
+      }
+    }
+  }
+}
+
+static void networkTask(void*);
+
+static void startTasks() {
+  xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, nullptr,
+                          RENDER_TASK_PRIORITY, nullptr, UI_TASK_CORE);
+  modeButton = buttons.addButton(MODE_PIN, HIGH, BLE_HOLD_MS);
+  resetButton = buttons.addButton(RESET_PIN, HIGH, RESET_HOLD_MS);
+  if (!buttons.begin()) {
+    ZEN_LOGE("Button input init failed");
+  }
+  xTaskCreatePinnedToCore(inputTask, "input", INPUT_TASK_STACK, nullptr,
+                          INPUT_TASK_PRIORITY, nullptr, UI_TASK_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                          NETWORK_TASK_PRIORITY, nullptr, NETWORK_TASK_CORE);
+}
+
 void setup() {
   Serial.begin(115200);
   delay(50);
-  Serial.println("Zen Display booting...");
+  logBegin();
+  ZEN_LOGI("Zen Display %s booting", FIRMWARE_VERSION);
+  uiModelMutex = xSemaphoreCreateMutex();
+  renderQueue = xQueueCreate(RENDER_QUEUE_DEPTH, sizeof(RenderRequest));
 
   pinMode(MODE_PIN, INPUT_PULLDOWN);
   pinMode(RESET_PIN, INPUT_PULLDOWN);
 
   prefs.begin(PREF_NAMESPACE, false);
+  otaUpdater.begin();
   wifiSsid = prefs.getString(PREF_WIFI_SSID, "");
   wifiPassword = prefs.getString(PREF_WIFI_PASS, "");
   deviceId = prefs.getString(PREF_DEVICE_ID, "");
   deviceSecret = prefs.getString(PREF_DEVICE_SECRET, "");
   pairingToken = prefs.getString(PREF_PAIRING_TOKEN, "");
   bleName = prefs.getString(PREF_BLE_NAME, defaultBleName());
+  String storedBackendUrl = prefs.getString(PREF_BACKEND_URL, "");
+  if (!storedBackendUrl.isEmpty()) applyBackendUrl(storedBackendUrl.c_str());
+  endpoints.begin();
+  wifiLink.begin();
+  localClock.begin();
+  offlineCache.begin();
+
+  // Waking from our own deep sleep with a registered device and content on
+  // screen: skip provisioning and go straight to fetch-and-diff
+  resumedFromSleep = ZEN_LOW_POWER &&
+      esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED &&
+      currentUi != UiMode::Provisioning &&
+      !deviceId.isEmpty() && !deviceSecret.isEmpty() && !wifiSsid.isEmpty();
 
   const int BUSY_PIN = 4;
   const int RST_PIN = 16;
@@ -840,90 +1391,181 @@ void setup() {
   digitalWrite(RST_PIN, HIGH);
   delay(10);
   SPI.begin(18, 19, 23, 5);
+
+  if (resumedFromSleep) {
+    // initial=false: the panel still shows the retained screen, keep it
+    display.init(0, false);
+    display.setRotation(DISPLAY_ROTATION);
+    ZEN_LOGI("Resumed from deep sleep, skipping provisioning");
+    deviceRegistered = true;
+    stateReady = true;
+    stateFetchRequested = true;
+    handleWakeButtons();
+    // The network task joins Wi-Fi on its first pass
+    startTasks();
+    return;
+  }
+
+  currentUi = UiMode::Provisioning;
+  if (!deviceId.isEmpty() && !wifiSsid.isEmpty()) {
+    // Provisioned: leave the last screen on the panel and go straight to
+    // Wi-Fi. BLE only starts if Wi-Fi fails, the device turns out to be
+    // unclaimed, or the mode button is held.
+    display.init(0, false);
+    display.setRotation(DISPLAY_ROTATION);
+    ZEN_LOGI("Provisioned boot, BLE deferred");
+    if (restoreUiContent()) {
+      // Last-known-good content in a single full refresh, marked as cached
+      // until the first fetch. The clock is only valid after a deep sleep
+      // wake, never on this path: its region stays blank and is drawn in
+      // place once SNTP sets the time
+      ZEN_LOGI("Showing cached state");
+      updateTime();
+      requestRender(RenderOp::ShowMode, UiMode::Calendar);
+    }
+    startTasks();
+    return;
+  }
+
   display.init();
-  display.setRotation(1);
+  display.setRotation(DISPLAY_ROTATION);
+
+  ZEN_LOGI("Unprovisioned boot, starting BLE provisioning");
+  ensureBleStarted("unprovisioned");
 
-  Serial.println("\n=== Starting BLE Provisioning ===");
-  startBleProvisioning();
-  Serial.println("BLE provisioning complete\n");
-  
   handleProvisioningUi();
 
-  if (!wifiSsid.isEmpty()) {
-    attemptWifiConnection(wifiSsid, wifiPassword);
-  }
+  // The network task joins the stored Wi-Fi on its first pass
+  startTasks();
 }
 
-static unsigned long lastTimeUpdate = 0;
-static String lastTimeString = "--:--";
-static constexpr uint32_t TIME_CHECK_INTERVAL_MS = 1000;  // Check time every second
+// millis() deadline of the next local minute change, computed once per
+// minute from the clock instead of formatting the time every pass
+static unsigned long nextMinuteAt = 0;
+static char lastTimeString[sizeof(currentTimeBuf)] = "--:--";
 
-void loop() {
+// One pass of the network task; returning early just starts the next pass
+static void networkStep() {
   // Check and update time only when it changes (minute changes)
   unsigned long now = millis();
-  if (now - lastTimeUpdate > TIME_CHECK_INTERVAL_MS) {
-    lastTimeUpdate = now;
-    String currentTime = getCurrentTimeString();
-    if (currentTime != lastTimeString) {
-      lastTimeString = currentTime;
-      updateTime();
+  if (localClock.takeSynced() || static_cast<long>(now - nextMinuteAt) >= 0) {
+    nextMinuteAt = now + localClock.millisToNextMinute();
+    char currentTime[sizeof(lastTimeString)];
+    localClock.format(currentTime, sizeof(currentTime));
+    if (strcmp(currentTime, lastTimeString) != 0) {
+      strlcpy(lastTimeString, currentTime, sizeof(lastTimeString));
+      updateTime();  // marks the clock region dirty in both modes
       // On minute change, schedule a UI refresh; prefer syncing after a state fetch
       minuteRefreshPending = true;
-      if (wifiConnected && deviceRegistered) {
-        // Force a fresh state fetch at the minute boundary
-        lastStateFetch = 0; // ensure interval condition passes below
-      } else if (stateReady && currentUi != UiMode::Provisioning) {
-        // If not connected/registered yet, at least refresh the current UI now
-        refreshCurrentDisplay();
+      if (wifiConnected && deviceRegistered && !(PUSH_ENABLED && pushChannel.connected())) {
+        // Force a fresh state fetch at the minute boundary; with push up,
+        // content changes arrive as events and only the clock needs redrawing
+        stateFetchRequested = true;
+      } else if ((stateReady || showingCachedState) && currentUi != UiMode::Provisioning) {
+        // Push is up or we're not connected/registered yet: refresh the clock now
+        requestRender(RenderOp::DirtyRegions);
         minuteRefreshPending = false;
       }
     }
   }
   
-  if (credentialsUpdated) {
-    credentialsUpdated = false;
-    if (!pendingSsid.isEmpty()) {
-      Serial.println("New credentials received, clearing ALL registration state");
-      deviceRegistered = false;
-      stateReady = false;
-      // Clear cached device credentials to force fresh registration
-      deviceId = "";
-      deviceSecret = "";
-      pairingToken = "";
-      prefs.remove(PREF_DEVICE_ID);
-      prefs.remove(PREF_DEVICE_SECRET);
-      prefs.remove(PREF_PAIRING_TOKEN);
-      updateStatusCharacteristic("connecting");
-      attemptWifiConnection(pendingSsid, pendingPassword);
+  ProvisioningCredentials credentials;
+  if (bleProvisioning.takeCredentials(credentials)) {
+    ZEN_LOGI("New credentials received, clearing registration state");
+    deviceRegistered = false;
+    stateReady = false;
+    // Clear cached device credentials to force fresh registration
+    deviceId = "";
+    deviceSecret = "";
+    pairingToken = "";
+    {
+      UiModelLock lock;
+      stateTable.clear();
+    }
+    pushChannel.stop();
+    prefs.remove(PREF_DEVICE_ID);
+    prefs.remove(PREF_DEVICE_SECRET);
+    prefs.remove(PREF_PAIRING_TOKEN);
+    wifiLink.forget();
+    dropCachedState();
+    if (credentials.backendUrl[0] != '\0' && strcmp(credentials.backendUrl, backendUrl) != 0) {
+      // The old backend's endpoint list says nothing about the new one
+      endpoints.forget();
+      applyBackendUrl(credentials.backendUrl);
+      prefs.putString(PREF_BACKEND_URL, backendUrl);
     }
+    bleProvisioning.setStatus(ProvisioningStatus::Connecting);
+    attemptWifiConnection(credentials.ssid, credentials.password);
+  }
+
+  if (bleStartRequested) {
+    ensureBleStarted("mode button held");
+    bleHoldUntil = millis() + BLE_REPAIR_WINDOW_MS;
   }
 
+  otaUpdater.poll();
+
   if (!ensureWifiConnection()) {
+    if (resumedFromSleep) {
+      // Keep the retained screen and retry on the next wake
+      enterLowPowerSleep();
+    }
+    // The stored credentials may be stale; let the app send new ones
+    ensureBleStarted("Wi-Fi unavailable");
     handleProvisioningUi();
-    ensureBleAdvertising();
+    bleProvisioning.ensureAdvertising();
     delay(200);
     return;
   }
 
   if (!deviceRegistered) {
-    Serial.println("Device not registered, attempting registration...");
+    ZEN_LOGI("Device not registered, attempting registration");
     deviceRegistered = registerDeviceWithBackend();
     if (!deviceRegistered) {
-      Serial.println("Registration failed, will retry");
+      ZEN_LOGW("Registration failed, will retry");
       handleProvisioningUi();
       delay(500);
       return;
     }
-    Serial.println("Registration successful!");
+    ZEN_LOGI("Registration successful");
   }
 
-  if (millis() - lastHeartbeat > HEARTBEAT_INTERVAL_MS) {
+  if (ZEN_LOW_POWER && resumedFromSleep) {
+    // millis() restarts on every wake, count wakes instead
+    if (++wakesSinceHeartbeat >= LOW_POWER_HEARTBEAT_WAKES) {
+      wakesSinceHeartbeat = 0;
+      sendHeartbeat();
+    }
+  } else if (millis() - lastHeartbeat > HEARTBEAT_INTERVAL_MS) {
     lastHeartbeat = millis();
     sendHeartbeat();
   }
 
-  if (millis() - lastStateFetch > STATE_REFRESH_INTERVAL_MS || !stateReady) {
+  if (otaUpdater.pending() &&
+      otaUpdater.install(backendSession, deviceId.c_str(), deviceSecret.c_str())) {
+    // Let queued redraws finish; the content is in the offline cache
+    flushRender();
+    logFlush();
+    ESP.restart();
+  }
+
+  if (PUSH_ENABLED) {
+    if (pushChannel.poll(deviceId, deviceSecret) && !pushFetchPending) {
+      pushFetchPending = true;
+      pushFetchDueAt = millis() + PUSH_COALESCE_MS;
+    }
+    if (pushFetchPending && static_cast<long>(millis() - pushFetchDueAt) >= 0) {
+      pushFetchPending = false;
+      stateFetchRequested = true;
+    }
+  }
+
+  const uint32_t refreshInterval = (PUSH_ENABLED && pushChannel.connected())
+      ? PUSH_FALLBACK_REFRESH_MS
+      : STATE_REFRESH_INTERVAL_MS;
+  if (millis() - lastStateFetch > refreshInterval || !stateReady || stateFetchRequested) {
     lastStateFetch = millis();
+    stateFetchRequested = false;
     fetchDeviceState();
   }
 
@@ -932,48 +1574,24 @@ void loop() {
     delay(500);
     return;
   }
-  int reading = digitalRead(MODE_PIN);
-  if (reading != lastModeState) {
-    lastDebounceTime = millis();
-  }
-  if ((millis() - lastDebounceTime) > debounceDelay) {
-    if (reading != stableState) {
-      stableState = reading;
-      updateTime();
-      // Detect button press (transition from LOW to HIGH)
-      bool buttonPressed = (stableState == HIGH && !lastButtonPressed);
-      if (buttonPressed) {
-        // Toggle between Calendar and Email modes
-        if (currentUi == UiMode::Calendar) {
-          refreshDisplayForMode(UiMode::Email);
-        } else {
-          refreshDisplayForMode(UiMode::Calendar);
-        }
-      }
-      lastButtonPressed = (stableState == HIGH);
-    }
+  releaseBleWhenProvisioned();
+  if (canEnterLowPowerSleep()) {
+    enterLowPowerSleep();
   }
-  lastModeState = reading;
 
-  // Handle reset button
-  int resetReading = digitalRead(RESET_PIN);
-  if (resetReading != lastResetState) {
-    lastResetDebounceTime = millis();
-  }
-  if ((millis() - lastResetDebounceTime) > resetDebounceDelay) {
-    if (resetReading != resetStableState) {
-      resetStableState = resetReading;
-      // Detect reset button press (transition from LOW to HIGH)
-      bool resetPressed = (resetStableState == HIGH && !lastResetPressed);
-      if (resetPressed) {
-        Serial.println("Reset button pressed - performing factory reset...");
-        performFactoryReset();
-      }
-      lastResetPressed = (resetStableState == HIGH);
-    }
+  // Buttons and rendering live in their own tasks; just yield the core
+  delay(NETWORK_IDLE_MS);
+}
+
+static void networkTask(void*) {
+  allocDebugTrackCurrentTask();
+  for (;;) {
+    networkStep();
+    allocDebugReport("network");
   }
-  lastResetState = resetReading;
+}
 
-  // Avoid fixed waits; yield without sleeping to keep loop responsive
-  delay(0);
+void loop() {
+  // All work runs in the tasks started by setup(); retire the Arduino loop task
+  vTaskDelete(nullptr);
 }
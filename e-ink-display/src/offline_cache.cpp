@@ -0,0 +1,42 @@
+#include "offline_cache.h"
+
+#include "fingerprint.h"
+
+static constexpr char PREF_CACHE_PAYLOAD[] = "ui_cache";
+static constexpr char PREF_CACHE_FINGERPRINT[] = "ui_cache_fp";
+// Bump when the payload layout changes so records of older firmware are
+// rejected instead of being read into the wrong fields
+static constexpr uint16_t CACHE_SCHEMA_VERSION = 1;
+
+uint32_t OfflineCache::fingerprint(const void* payload, size_t size) {
+  uint32_t header = (static_cast<uint32_t>(CACHE_SCHEMA_VERSION) << 16) | (size & 0xFFFF);
+  uint32_t value = Fnv1a().add(&header, sizeof(header)).add(payload, size).value();
+  return value == 0 ? 1 : value;  // 0 marks "nothing stored"
+}
+
+void OfflineCache::begin() {
+  storedFingerprint_ = prefs_.getUInt(PREF_CACHE_FINGERPRINT, 0);
+}
+
+bool OfflineCache::load(void* payload, size_t size) {
+  if (storedFingerprint_ == 0 || prefs_.getBytesLength(PREF_CACHE_PAYLOAD) != size) return false;
+  if (prefs_.getBytes(PREF_CACHE_PAYLOAD, payload, size) != size) return false;
+  return fingerprint(payload, size) == storedFingerprint_;
+}
+
+bool OfflineCache::store(const void* payload, size_t size) {
+  uint32_t next = fingerprint(payload, size);
+  if (next == storedFingerprint_) return false;
+  // Payload first: a reset in between leaves a fingerprint that no longer
+  // matches, and load() rejects the record
+  if (prefs_.putBytes(PREF_CACHE_PAYLOAD, payload, size) != size) return false;
+  prefs_.putUInt(PREF_CACHE_FINGERPRINT, next);
+  storedFingerprint_ = next;
+  return true;
+}
+
+void OfflineCache::forget() {
+  storedFingerprint_ = 0;
+  prefs_.remove(PREF_CACHE_FINGERPRINT);
+  prefs_.remove(PREF_CACHE_PAYLOAD);
+}
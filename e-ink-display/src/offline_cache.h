@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Last successfully applied UI content, kept in NVS so a reboot or power
+// loss can put it back on the panel before Wi-Fi, registration and the
+// backend answer. The payload is stored next to its fingerprint: a store
+// whose content matches the stored fingerprint is skipped, so flash is
+// written once per content change rather than once per fetch, and a load
+// whose payload doesn't match it (other firmware layout, interrupted write)
+// is ignored.
+class OfflineCache {
+ public:
+  explicit OfflineCache(Preferences& prefs) : prefs_(prefs) {}
+
+  // Reads the stored fingerprint; call after prefs.begin().
+  void begin();
+  // Fills `payload` (exactly `size` bytes) from flash; false when nothing
+  // valid is stored.
+  bool load(void* payload, size_t size);
+  // Writes `payload` unless it is what flash already holds. True when
+  // flash was written.
+  bool store(const void* payload, size_t size);
+  // Drops the record, e.g. on re-pairing or a factory reset.
+  void forget();
+
+ private:
+  static uint32_t fingerprint(const void* payload, size_t size);
+
+  Preferences& prefs_;
+  uint32_t storedFingerprint_ = 0;
+};
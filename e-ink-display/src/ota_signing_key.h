@@ -0,0 +1,15 @@
+#pragma once
+
+// Public half of the key firmware builds are signed with (ECDSA P-256, PEM).
+// Heartbeat responses come over TLS without certificate checks, so the
+// advertised SHA-256 alone proves nothing about who published a build: the
+// display only installs builds whose signature this key verifies (see
+// ota_update.h). The private key stays with whoever publishes builds and is
+// never stored in this repository or on the backend. Create it once with
+//
+//   openssl ecparam -name prime256v1 -genkey -noout -out ota_signing.pem
+//   openssl ec -in ota_signing.pem -pubout
+//
+// and paste the second command's output here. An empty key turns updates
+// off, so a build that does not carry one never accepts an image.
+static const char OTA_SIGNING_PUBLIC_KEY[] = "";
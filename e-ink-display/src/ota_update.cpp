@@ -0,0 +1,492 @@
+#include "ota_update.h"
+
+#include <esp32/rom/miniz.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include <cctype>
+#include <cstring>
+
+#include "alloc_debug.h"
+#include "ota_signing_key.h"
+#include "zen_log.h"
+
+static constexpr char PREF_OTA_TRIAL[] = "ota_trial";      // 1 + crashes of the image on trial
+static constexpr char PREF_OTA_PREVIOUS[] = "ota_prev";    // label of the partition to fall back to
+static constexpr char PREF_OTA_VERSION[] = "ota_ver";     // version on trial
+static constexpr char PREF_OTA_REJECTED[] = "ota_bad";     // version that failed its trial
+static constexpr char PREF_OTA_STALLS[] = "ota_stall";     // stalled runs of the image on trial
+static constexpr uint8_t OTA_TRIAL_CRASHES = 3;
+static constexpr uint8_t OTA_TRIAL_STALLS = 12;
+static constexpr uint32_t OTA_TRIAL_STALL_MS = 2 * 60 * 60 * 1000UL;
+// Give up on an offer after this many failed downloads until the next boot
+static constexpr uint8_t OTA_MAX_FAILURES = 3;
+static constexpr size_t OTA_READ_CHUNK = 1024;
+static constexpr uint32_t OTA_STALL_TIMEOUT_MS = 10000;
+static constexpr size_t OTA_SHA256_HEX_LEN = 64;
+
+// gzip member header flags (RFC 1952)
+static constexpr uint8_t GZIP_FHCRC = 0x02;
+static constexpr uint8_t GZIP_FEXTRA = 0x04;
+static constexpr uint8_t GZIP_FNAME = 0x08;
+static constexpr uint8_t GZIP_FCOMMENT = 0x10;
+static constexpr uint8_t GZIP_FRESERVED = 0xe0;
+static constexpr size_t GZIP_FIXED_HEADER = 10;
+
+static uint8_t readChunk[OTA_READ_CHUNK];
+
+// Reads one part of a dotted version, 0 once the text is used up. False
+// for anything but digits and dots.
+static bool versionPart(const char*& text, unsigned long& part) {
+  part = 0;
+  if (*text == '\0') return true;
+  if (!isdigit(static_cast<uint8_t>(*text))) return false;
+  char* end = nullptr;
+  part = strtoul(text, &end, 10);
+  if (*end != '.' && *end != '\0') return false;
+  text = *end == '.' ? end + 1 : end;
+  return true;
+}
+
+// "1.2.10" > "1.2.9"; "1.2" and "1.2.0" are the same version
+static bool versionNewer(const char* candidate, const char* current) {
+  while (*candidate || *current) {
+    unsigned long a, b;
+    if (!versionPart(candidate, a) || !versionPart(current, b)) return false;
+    if (a != b) return a > b;
+  }
+  return false;
+}
+
+// Checks the publisher's signature over "<sha256 hex>|<version>|<model>"
+static bool signatureValid(const uint8_t* sha256, const char* version, const char* model,
+                           const uint8_t* signature, size_t length) {
+  if (OTA_SIGNING_PUBLIC_KEY[0] == '\0') return false;
+  char message[OTA_SHA256_HEX_LEN + 64];
+  size_t used = 0;
+  for (size_t i = 0; i < 32; ++i) {
+    used += snprintf(message + used, sizeof(message) - used, "%02x", sha256[i]);
+  }
+  int tail = snprintf(message + used, sizeof(message) - used, "|%s|%s", version, model);
+  if (tail < 0 || used + tail >= sizeof(message)) return false;
+  used += tail;
+
+  uint8_t digest[32];
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  mbedtls_sha256_update(&sha, reinterpret_cast<const uint8_t*>(message), used);
+  mbedtls_sha256_finish(&sha, digest);
+  mbedtls_sha256_free(&sha);
+
+  mbedtls_pk_context key;
+  mbedtls_pk_init(&key);
+  // The PEM length includes its terminator
+  bool valid = mbedtls_pk_parse_public_key(&key, reinterpret_cast<const uint8_t*>(OTA_SIGNING_PUBLIC_KEY),
+                                           sizeof(OTA_SIGNING_PUBLIC_KEY)) == 0 &&
+               mbedtls_pk_can_do(&key, MBEDTLS_PK_ECDSA) &&
+               mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, sizeof(digest), signature, length) == 0;
+  mbedtls_pk_free(&key);
+  return valid;
+}
+
+static bool parseSha256(const char* hex, uint8_t* out) {
+  if (!hex || strlen(hex) != OTA_SHA256_HEX_LEN) return false;
+  for (size_t i = 0; i < 32; ++i) {
+    char pair[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+    char* end = nullptr;
+    unsigned long value = strtoul(pair, &end, 16);
+    if (end != pair + 2) return false;
+    out[i] = static_cast<uint8_t>(value);
+  }
+  return true;
+}
+
+// Reads up to `capacity` bytes, waiting for the socket but not forever
+static size_t readSome(Stream& input, uint8_t* target, size_t capacity, uint32_t& remaining) {
+  unsigned long idleSince = millis();
+  while (remaining > 0) {
+    int available = input.available();
+    if (available > 0) {
+      size_t want = capacity < remaining ? capacity : remaining;
+      if (static_cast<size_t>(available) < want) want = available;
+      size_t got = input.readBytes(target, want);
+      remaining -= got;
+      return got;
+    }
+    if (millis() - idleSince > OTA_STALL_TIMEOUT_MS) break;
+    delay(5);
+  }
+  return 0;
+}
+
+// Feeds written image bytes to the partition and the digest
+struct ImageSink {
+  esp_ota_handle_t handle;
+  mbedtls_sha256_context sha;
+  uint32_t written;
+
+  bool write(const uint8_t* data, size_t length) {
+    if (esp_ota_write(handle, data, length) != ESP_OK) return false;
+    mbedtls_sha256_update(&sha, data, length);
+    written += length;
+    return true;
+  }
+};
+
+// Skips a gzip member header, which may arrive split over any number of
+// reads: FNAME alone (as gzip stores it) can be longer than a socket read.
+struct GzipHeader {
+  enum class State : uint8_t { Fixed, ExtraLength, Extra, Name, Comment, Crc, Done, Failed };
+
+  State state = State::Fixed;
+  uint8_t flags = 0;
+  uint16_t extraLength = 0;
+  size_t count = 0;  // bytes of the current field seen
+
+  bool done() const { return state == State::Done; }
+  bool failed() const { return state == State::Failed; }
+
+  // Consumes header bytes from `data` and returns how many; what follows
+  // once done() is deflate data. failed() when it is not gzip/deflate.
+  size_t feed(const uint8_t* data, size_t length) {
+    size_t used = 0;
+    while (used < length && !done() && !failed()) {
+      uint8_t byte = data[used++];
+      switch (state) {
+        case State::Fixed:
+          // ID1 ID2 CM FLG MTIME(4) XFL OS
+          if ((count == 0 && byte != 0x1f) || (count == 1 && byte != 0x8b) || (count == 2 && byte != 8) ||
+              (count == 3 && (byte & GZIP_FRESERVED))) {
+            state = State::Failed;
+            break;
+          }
+          if (count == 3) flags = byte;
+          if (++count == GZIP_FIXED_HEADER) advance(State::Fixed);
+          break;
+        case State::ExtraLength:
+          extraLength |= byte << (8 * count);
+          if (++count < 2) break;
+          count = 0;
+          if (extraLength > 0) {
+            state = State::Extra;
+          } else {
+            advance(State::Extra);
+          }
+          break;
+        case State::Extra:
+          if (++count == extraLength) advance(State::Extra);
+          break;
+        case State::Name:
+        case State::Comment:
+          if (byte == 0) advance(state);  // zero-terminated
+          break;
+        case State::Crc:
+          if (++count == 2) state = State::Done;
+          break;
+        default:
+          break;
+      }
+    }
+    return used;
+  }
+
+  // Moves on to the first field after `from` that the flags announce
+  void advance(State from) {
+    count = 0;
+    switch (from) {
+      case State::Fixed:
+        if (flags & GZIP_FEXTRA) {
+          state = State::ExtraLength;
+          return;
+        }
+        [[fallthrough]];
+      case State::Extra:
+        if (flags & GZIP_FNAME) {
+          state = State::Name;
+          return;
+        }
+        [[fallthrough]];
+      case State::Name:
+        if (flags & GZIP_FCOMMENT) {
+          state = State::Comment;
+          return;
+        }
+        [[fallthrough]];
+      case State::Comment:
+        if (flags & GZIP_FHCRC) {
+          state = State::Crc;
+          return;
+        }
+        [[fallthrough]];
+      default:
+        state = State::Done;
+    }
+  }
+};
+
+static bool streamIdentity(Stream& input, uint32_t size, ImageSink& sink) {
+  uint32_t remaining = size;
+  while (remaining > 0) {
+    size_t got = readSome(input, readChunk, sizeof(readChunk), remaining);
+    if (got == 0 || !sink.write(readChunk, got)) return false;
+  }
+  return true;
+}
+
+// Raw deflate through the ROM tinfl with a wrapping 32 KiB dictionary, which
+// doubles as the output buffer handed to the sink
+static bool streamGzip(Stream& input, uint32_t size, ImageSink& sink) {
+  tinfl_decompressor* inflater = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  uint8_t* dict = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+  bool ok = inflater && dict;
+  if (ok) tinfl_init(inflater);
+  uint32_t remaining = size;
+  size_t dictOffset = 0;
+  GzipHeader header;
+  bool done = false;
+  while (ok && !done) {
+    size_t got = readSome(input, readChunk, sizeof(readChunk), remaining);
+    if (got == 0) {
+      ok = false;
+      break;
+    }
+    const uint8_t* in = readChunk;
+    size_t inLeft = got;
+    if (!header.done()) {
+      size_t used = header.feed(in, inLeft);
+      in += used;
+      inLeft -= used;
+      if (header.failed()) {
+        ok = false;
+        break;
+      }
+      if (inLeft == 0) continue;  // the header or the deflate data goes on in the next read
+    }
+    for (;;) {
+      size_t inSize = inLeft;
+      size_t outSize = TINFL_LZ_DICT_SIZE - dictOffset;
+      mz_uint32 flags = remaining > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+      tinfl_status status = tinfl_decompress(inflater, in, &inSize, dict, dict + dictOffset, &outSize, flags);
+      in += inSize;
+      inLeft -= inSize;
+      if (outSize > 0 && !sink.write(dict + dictOffset, outSize)) {
+        ok = false;
+        break;
+      }
+      dictOffset = (dictOffset + outSize) & (TINFL_LZ_DICT_SIZE - 1);
+      if (status == TINFL_STATUS_DONE) {
+        done = true;  // the gzip trailer is covered by the SHA-256 check
+        break;
+      }
+      if (status < TINFL_STATUS_DONE) {
+        ok = false;
+        break;
+      }
+      if (status == TINFL_STATUS_NEEDS_MORE_INPUT) break;  // tinfl took the whole chunk
+    }
+  }
+  free(dict);
+  free(inflater);
+  return ok && done;
+}
+
+// Panics and watchdog resets; ESP_RST_WDT covers the RTC watchdog
+static bool crashedLastBoot() {
+  switch (esp_reset_reason()) {
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void OtaUpdater::begin() {
+  uint8_t trial = prefs_.getUChar(PREF_OTA_TRIAL, 0);
+  if (trial == 0) return;
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  String previous = prefs_.getString(PREF_OTA_PREVIOUS, "");
+  if (!running || previous == running->label) {
+    // The bootloader already went back to the old image
+    prefs_.putString(PREF_OTA_REJECTED, prefs_.getString(PREF_OTA_VERSION, ""));
+    clearTrial();
+    return;
+  }
+  onTrial_ = true;
+  // Deep sleep wakes, power cycles and brownouts say nothing about the
+  // image: only crashes count here, stalled runs in poll()
+  if (!crashedLastBoot()) return;
+  // trial - 1 earlier crashes, plus this one
+  if (trial >= OTA_TRIAL_CRASHES) {
+    ZEN_LOGW("Firmware on trial keeps crashing, rolling back");
+    rollBack();
+    return;
+  }
+  ZEN_LOGW("Firmware on trial crashed, reset reason %d", static_cast<int>(esp_reset_reason()));
+  prefs_.putUChar(PREF_OTA_TRIAL, trial + 1);
+}
+
+void OtaUpdater::offer(JsonObjectConst firmware) {
+  if (firmware.isNull() || hasOffer_ || failures_ >= OTA_MAX_FAILURES) return;
+  const char* version = firmware["version"] | "";
+  const char* path = firmware["path"] | "";
+  const char* encoding = firmware["encoding"] | "identity";
+  const char* signature = firmware["signature"] | "";
+  Offer next = {};
+  if (version[0] == '\0' || strlen(version) >= sizeof(next.version) || path[0] != '/' ||
+      strlen(path) >= sizeof(next.path) || !parseSha256(firmware["sha256"] | "", next.sha256) ||
+      mbedtls_base64_decode(next.signature, sizeof(next.signature), &next.signatureLength,
+                            reinterpret_cast<const uint8_t*>(signature), strlen(signature)) != 0 ||
+      next.signatureLength == 0 || !versionNewer(version, runningVersion_)) {
+    return;
+  }
+  char rejected[sizeof(next.version)] = {};
+  prefs_.getString(PREF_OTA_REJECTED, rejected, sizeof(rejected));
+  if (strcmp(rejected, version) == 0) return;
+  strlcpy(next.version, version, sizeof(next.version));
+  strlcpy(next.path, path, sizeof(next.path));
+  next.gzip = strcmp(encoding, "gzip") == 0;
+  next.size = firmware["size"] | 0u;
+  next.imageSize = firmware["imageSize"] | 0u;
+  const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+  if (next.size == 0 || next.imageSize == 0 || !target || next.imageSize > target->size) return;
+  offer_ = next;
+  hasOffer_ = true;
+  ZEN_LOGI("Firmware update available: %s", offer_.version);
+}
+
+void OtaUpdater::onNetworkUp() {
+  if (!onTrial_ || stallClock_) return;
+  stallClock_ = true;
+  stallSince_ = millis();
+}
+
+void OtaUpdater::onBackendReached() {
+  if (!onTrial_) return;
+  stallClock_ = true;
+  stallSince_ = millis();
+}
+
+void OtaUpdater::poll() {
+  if (!onTrial_ || !stallClock_ || millis() - stallSince_ < OTA_TRIAL_STALL_MS) return;
+  uint8_t stalls = prefs_.getUChar(PREF_OTA_STALLS, 0) + 1;
+  if (stalls >= OTA_TRIAL_STALLS) {
+    ZEN_LOGW("Firmware on trial never completed a state fetch, rolling back");
+    rollBack();
+    return;
+  }
+  // A fresh boot may get further; the run counts either way
+  ZEN_LOGW("Firmware on trial has not completed a state fetch, restarting (%u of %u)",
+           static_cast<unsigned>(stalls), static_cast<unsigned>(OTA_TRIAL_STALLS));
+  prefs_.putUChar(PREF_OTA_STALLS, stalls);
+  logFlush();
+  esp_restart();
+}
+
+void OtaUpdater::rollBack() {
+  AllocAllowed allow;  // NVS strings
+  String previous = prefs_.getString(PREF_OTA_PREVIOUS, "");
+  const esp_partition_t* fallback =
+      esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, previous.c_str());
+  prefs_.putString(PREF_OTA_REJECTED, prefs_.getString(PREF_OTA_VERSION, ""));
+  clearTrial();
+  onTrial_ = false;
+  stallClock_ = false;
+  if (fallback && esp_ota_set_boot_partition(fallback) == ESP_OK) {
+    logFlush();
+    esp_restart();
+  }
+}
+
+void OtaUpdater::clearTrial() {
+  prefs_.remove(PREF_OTA_TRIAL);
+  prefs_.remove(PREF_OTA_STALLS);
+  prefs_.remove(PREF_OTA_PREVIOUS);
+  prefs_.remove(PREF_OTA_VERSION);
+}
+
+bool OtaUpdater::pending() const {
+  return hasOffer_;
+}
+
+bool OtaUpdater::install(BackendSession& session, const char* deviceId, const char* deviceSecret) {
+  if (!hasOffer_) return false;
+  hasOffer_ = false;  // offered again by the next heartbeat if this fails
+  AllocAllowed allow;  // HTTPClient, the OTA handle and the inflater
+  const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  if (!target || !running) return false;
+  // Checked before the download: the image then has to match the signed hash
+  if (!signatureValid(offer_.sha256, offer_.version, model_, offer_.signature, offer_.signatureLength)) {
+    ZEN_LOGW("Firmware %s is not signed with the update key, ignoring it", offer_.version);
+    failures_ = OTA_MAX_FAILURES;
+    return false;
+  }
+
+  HTTPClient* http = session.begin(offer_.path);
+  if (!http) return false;
+  http->addHeader("X-Device-Id", deviceId);
+  http->addHeader("X-Device-Secret", deviceSecret);
+  int code = session.send("GET");
+  if (code != HTTP_CODE_OK || static_cast<uint32_t>(http->getSize()) != offer_.size) {
+    ZEN_LOGW("Firmware download failed, HTTP code: %d", code);
+    session.end();
+    ++failures_;
+    return false;
+  }
+
+  ImageSink sink = {};
+  // Erases as it goes instead of the whole partition up front
+  if (esp_ota_begin(target, OTA_WITH_SEQUENTIAL_WRITES, &sink.handle) != ESP_OK) {
+    session.end();
+    ++failures_;
+    return false;
+  }
+  mbedtls_sha256_init(&sink.sha);
+  mbedtls_sha256_starts(&sink.sha, 0);
+  unsigned long started = millis();
+  Stream& body = *http->getStreamPtr();
+  bool streamed = offer_.gzip ? streamGzip(body, offer_.size, sink) : streamIdentity(body, offer_.size, sink);
+  session.end();
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&sink.sha, digest);
+  mbedtls_sha256_free(&sink.sha);
+
+  if (!streamed || sink.written != offer_.imageSize || memcmp(digest, offer_.sha256, sizeof(digest)) != 0) {
+    ZEN_LOGW("Firmware download incomplete or hash mismatch");
+    esp_ota_abort(sink.handle);
+    ++failures_;
+    return false;
+  }
+  // esp_ota_end also checks the image header and the image's own checksum
+  if (esp_ota_end(sink.handle) != ESP_OK || esp_ota_set_boot_partition(target) != ESP_OK) {
+    ZEN_LOGW("Firmware image rejected");
+    ++failures_;
+    return false;
+  }
+  prefs_.putString(PREF_OTA_PREVIOUS, running->label);
+  prefs_.putString(PREF_OTA_VERSION, offer_.version);
+  prefs_.putUChar(PREF_OTA_TRIAL, 1);
+  prefs_.remove(PREF_OTA_STALLS);
+  ZEN_LOGI("Firmware %s installed in %lu ms", offer_.version, static_cast<unsigned long>(millis() - started));
+  return true;
+}
+
+void OtaUpdater::confirm() {
+  if (!onTrial_) return;
+  onTrial_ = false;
+  stallClock_ = false;
+  clearTrial();
+  ZEN_LOGI("Firmware update confirmed");
+}
+
+// verifyRollbackLater() is deliberately not overridden: the core's default
+// marks the image valid at boot on rollback-enabled bootloaders, which would
+// otherwise abort a trial image on any restart before confirm(), deep
+// sleep wakes and power cycles included
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+
+#include "backend_session.h"
+
+// Firmware updates advertised in the heartbeat response. The build is
+// streamed from GET /devices/firmware/<version> straight into the inactive
+// OTA partition as it arrives; gzip builds are inflated on the way with the
+// ROM inflater and its 32 KiB window, so neither the download nor the image
+// is ever held in RAM. The SHA-256 of what was written has to match the
+// advertised one before the partition is made bootable.
+//
+// The heartbeat's TLS connection is not authenticated, so the advertised
+// hash is only trusted when it carries the publisher's signature: ECDSA
+// P-256 over "<sha256 hex>|<version>|<model>", checked against the key in
+// ota_signing_key.h before anything is downloaded. The version has to be
+// newer than the running one, so an old signed build cannot be replayed.
+//
+// The new image then runs on trial until confirm(), after its first
+// successful state fetch. It is switched back to the previous partition,
+// and that version is not installed again, when it
+// - crashes (panic or watchdog reset) OTA_TRIAL_CRASHES times, or
+// - stalls OTA_TRIAL_STALLS times: a run that joined Wi-Fi and then went
+//   OTA_TRIAL_STALL_MS without a fetch ends in a restart and counts once.
+// Deep sleep wakes, power loss and time without Wi-Fi do not count against
+// it, and a backend outage would have to last about a day to.
+//
+// The trial is this class's alone: on bootloaders built with app rollback
+// the core marks every image valid at boot, so the bootloader never aborts
+// one for merely restarting.
+class OtaUpdater {
+ public:
+  // `model` and `runningVersion` are what the heartbeat reports
+  OtaUpdater(Preferences& prefs, const char* model, const char* runningVersion)
+      : prefs_(prefs), model_(model), runningVersion_(runningVersion) {}
+
+  // Counts crashes of a trial image and rolls it back; call right after
+  // prefs.begin(), before anything that might crash.
+  void begin();
+  // Remembers the "firmware" object of a heartbeat response, if any.
+  void offer(JsonObjectConst firmware);
+  // True while an offered build waits to be installed.
+  bool pending() const;
+  // Downloads, verifies and activates the offered build. True when the
+  // next restart boots it.
+  bool install(BackendSession& session, const char* deviceId, const char* deviceSecret);
+  // Marks the running image good, ending its trial.
+  void confirm();
+  // Starts the trial's stall clock, if it is not running; call when Wi-Fi
+  // associates.
+  void onNetworkUp();
+  // Restarts the stall clock; call when the backend answered, but had
+  // nothing for the image to prove itself on (the display is unclaimed).
+  void onBackendReached();
+  // Ends a stalled trial run; call on every network task pass.
+  void poll();
+
+ private:
+  struct Offer {
+    char version[16];
+    char path[64];
+    bool gzip;
+    uint32_t size;
+    uint32_t imageSize;
+    uint8_t sha256[32];
+    uint8_t signature[72];  // DER, the longest a P-256 signature gets
+    size_t signatureLength;
+  };
+
+  void clearTrial();
+  // Boots the previous partition and rejects the version on trial
+  void rollBack();
+
+  Preferences& prefs_;
+  const char* model_;
+  const char* runningVersion_;
+  Offer offer_ = {};
+  bool hasOffer_ = false;
+  bool onTrial_ = false;
+  bool stallClock_ = false;
+  unsigned long stallSince_ = 0;
+  uint8_t failures_ = 0;
+};
@@ -0,0 +1,79 @@
+#include "perf_metrics.h"
+
+namespace {
+
+struct PerfStats {
+  uint16_t count;
+  uint32_t totalMs;
+  uint32_t maxMs;
+  uint16_t buckets[PERF_BUCKETS];
+};
+
+constexpr size_t PERF_METRIC_COUNT = static_cast<size_t>(PerfMetric::Count);
+
+// Keys of the "timings" object, indexed by PerfMetric
+constexpr const char* PERF_METRIC_NAMES[PERF_METRIC_COUNT] = {
+    "wifiConnect", "tlsHandshake", "httpGet", "stateParse", "rasterise", "panelRefresh",
+};
+
+portMUX_TYPE perfMux = portMUX_INITIALIZER_UNLOCKED;
+PerfStats perfStats[PERF_METRIC_COUNT];
+int64_t perfWindowStartUs = 0;
+
+uint8_t bucketFor(uint32_t ms) {
+  uint8_t bucket = 0;
+  while (ms > 0 && bucket < PERF_BUCKETS - 1) {
+    ms >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+}  // namespace
+
+void perfRecord(PerfMetric metric, uint32_t elapsedUs) {
+  size_t index = static_cast<size_t>(metric);
+  if (index >= PERF_METRIC_COUNT) return;
+  uint32_t ms = elapsedUs / 1000;
+  uint8_t bucket = bucketFor(ms);
+  portENTER_CRITICAL(&perfMux);
+  PerfStats& stats = perfStats[index];
+  if (stats.count < UINT16_MAX) {
+    ++stats.count;
+    stats.totalMs += ms;
+    ++stats.buckets[bucket];
+  }
+  if (ms > stats.maxMs) stats.maxMs = ms;
+  portEXIT_CRITICAL(&perfMux);
+}
+
+void perfWriteReport(JsonObject perf) {
+  static PerfStats window[PERF_METRIC_COUNT];
+  int64_t nowUs = esp_timer_get_time();
+  portENTER_CRITICAL(&perfMux);
+  memcpy(window, perfStats, sizeof(window));
+  memset(perfStats, 0, sizeof(perfStats));
+  int64_t startUs = perfWindowStartUs;
+  perfWindowStartUs = nowUs;
+  portEXIT_CRITICAL(&perfMux);
+
+  perf["windowMs"] = static_cast<uint32_t>((nowUs - startUs) / 1000);
+  JsonObject heap = perf.createNestedObject("heap");
+  heap["free"] = ESP.getFreeHeap();
+  heap["minFree"] = ESP.getMinFreeHeap();
+  heap["largestBlock"] = ESP.getMaxAllocHeap();
+
+  JsonObject timings = perf.createNestedObject("timings");
+  for (size_t i = 0; i < PERF_METRIC_COUNT; ++i) {
+    const PerfStats& stats = window[i];
+    if (stats.count == 0) continue;
+    JsonObject entry = timings.createNestedObject(PERF_METRIC_NAMES[i]);
+    entry["count"] = stats.count;
+    entry["totalMs"] = stats.totalMs;
+    entry["maxMs"] = stats.maxMs;
+    JsonArray buckets = entry.createNestedArray("buckets");
+    for (uint8_t b = 0; b < PERF_BUCKETS; ++b) {
+      buckets.add(stats.buckets[b]);
+    }
+  }
+}
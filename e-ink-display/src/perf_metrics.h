@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+
+// Lightweight timing and heap telemetry reported with each heartbeat.
+// Every metric keeps a count, total, maximum and a log2 histogram of its
+// durations for the current heartbeat window; perfWriteReport() serialises
+// the window and starts a new one. Recording is a few arithmetic ops under a
+// spinlock, so timers can wrap hot paths on any task.
+enum class PerfMetric : uint8_t {
+  WifiConnect,
+  TlsHandshake,
+  HttpGet,
+  StateParse,
+  Rasterise,
+  PanelRefresh,  // blocked on the panel's BUSY line during a refresh
+  Count,
+};
+
+// Bucket 0 counts durations under 1 ms, bucket i in [2^(i-1), 2^i) ms; the
+// last bucket also takes everything slower (>= 1024 ms).
+static constexpr uint8_t PERF_BUCKETS = 12;
+
+void perfRecord(PerfMetric metric, uint32_t elapsedUs);
+// Adds "windowMs", "heap" and "timings" to `perf` and resets the window.
+void perfWriteReport(JsonObject perf);
+
+// Records the time between construction and destruction (or stop()).
+class PerfTimer {
+ public:
+  explicit PerfTimer(PerfMetric metric) : metric_(metric), startUs_(esp_timer_get_time()) {}
+  ~PerfTimer() { stop(); }
+  PerfTimer(const PerfTimer&) = delete;
+  PerfTimer& operator=(const PerfTimer&) = delete;
+
+  void stop() {
+    if (startUs_ < 0) return;
+    perfRecord(metric_, static_cast<uint32_t>(esp_timer_get_time() - startUs_));
+    startUs_ = -1;
+  }
+  // Drops the sample, e.g. when the timed operation failed.
+  void cancel() { startUs_ = -1; }
+
+ private:
+  PerfMetric metric_;
+  int64_t startUs_;
+};
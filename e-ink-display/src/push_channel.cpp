@@ -0,0 +1,102 @@
+#include "push_channel.h"
+
+#include <cstring>
+
+#include "alloc_debug.h"
+#include "zen_log.h"
+
+static constexpr uint32_t PUSH_BACKOFF_MIN_MS = 5000;
+static constexpr uint32_t PUSH_BACKOFF_MAX_MS = 300000;
+// Server keep-alive is 25 s; three missed ones means the stream is dead
+static constexpr uint32_t PUSH_IDLE_TIMEOUT_MS = 75000;
+static constexpr uint16_t PUSH_CONNECT_TIMEOUT_MS = 8000;
+
+PushChannel::PushChannel(EndpointPool& endpoints, const char* path)
+    : endpoints_(endpoints), path_(path), backoffMs_(PUSH_BACKOFF_MIN_MS) {
+  line_[0] = '\0';
+}
+
+bool PushChannel::open(const String& deviceId, const String& deviceSecret) {
+  AllocAllowed allow;  // HTTPClient builds the request with String
+  client_.setInsecure();
+  // HTTP/1.0 keeps the body free of chunk framing so lines can be read raw
+  http_.useHTTP10(true);
+  http_.setTimeout(PUSH_CONNECT_TIMEOUT_MS);
+  char url[160];
+  snprintf(url, sizeof(url), "%s%s", endpoints_.url(endpoints_.preferred()), path_);
+  if (!http_.begin(client_, url)) {
+    return false;
+  }
+  http_.addHeader("Accept", "text/event-stream");
+  http_.addHeader("X-Device-Id", deviceId);
+  http_.addHeader("X-Device-Secret", deviceSecret);
+  int code = http_.GET();
+  if (code != HTTP_CODE_OK) {
+    ZEN_LOGW("Push channel open failed: %d", code);
+    http_.end();
+    return false;
+  }
+  ZEN_LOGI("Push channel connected");
+  open_ = true;
+  lastActivity_ = millis();
+  lineLen_ = 0;
+  backoffMs_ = PUSH_BACKOFF_MIN_MS;
+  return true;
+}
+
+void PushChannel::scheduleRetry() {
+  nextAttempt_ = millis() + backoffMs_;
+  backoffMs_ = backoffMs_ * 2 > PUSH_BACKOFF_MAX_MS ? PUSH_BACKOFF_MAX_MS : backoffMs_ * 2;
+}
+
+void PushChannel::stop() {
+  if (open_) {
+    http_.end();
+    client_.stop();
+    open_ = false;
+  }
+}
+
+bool PushChannel::connected() {
+  return open_ && client_.connected() && millis() - lastActivity_ < PUSH_IDLE_TIMEOUT_MS;
+}
+
+// Only "event: state" matters; data, ids and comments need no handling
+bool PushChannel::handleLine() {
+  return strcmp(line_, "event: state") == 0;
+}
+
+bool PushChannel::poll(const String& deviceId, const String& deviceSecret) {
+  if (open_ && !connected()) {
+    ZEN_LOGW("Push channel lost");
+    stop();
+    scheduleRetry();
+  }
+  if (!open_) {
+    if (static_cast<long>(millis() - nextAttempt_) < 0) {
+      return false;
+    }
+    if (!open(deviceId, deviceSecret)) {
+      scheduleRetry();
+      return false;
+    }
+  }
+
+  bool changed = false;
+  while (client_.available() > 0) {
+    int c = client_.read();
+    if (c < 0) break;
+    lastActivity_ = millis();
+    if (c == '\r') continue;
+    if (c == '\n') {
+      line_[lineLen_] = '\0';
+      changed |= handleLine();
+      lineLen_ = 0;
+      continue;
+    }
+    if (lineLen_ < sizeof(line_) - 1) {
+      line_[lineLen_++] = static_cast<char>(c);
+    }
+  }
+  return changed;
+}
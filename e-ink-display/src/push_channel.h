@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+#include "endpoint_pool.h"
+
+// Server-Sent Events client for GET /devices/events. Runs on its own TLS
+// connection next to BackendSession and is drained from loop() without
+// blocking; a dropped stream is reopened with exponential backoff, on the
+// pool's fastest healthy endpoint at that time.
+class PushChannel {
+ public:
+  PushChannel(EndpointPool& endpoints, const char* path);
+
+  // Opens the stream when due and drains buffered lines. Returns true when
+  // at least one state-change event arrived since the last call.
+  bool poll(const String& deviceId, const String& deviceSecret);
+  // True while the stream is open and the server is still sending keep-alives.
+  bool connected();
+  void stop();
+
+ private:
+  bool open(const String& deviceId, const String& deviceSecret);
+  bool handleLine();
+  void scheduleRetry();
+
+  EndpointPool& endpoints_;
+  const char* path_;
+  WiFiClientSecure client_;
+  HTTPClient http_;
+  bool open_ = false;
+  unsigned long lastActivity_ = 0;
+  unsigned long nextAttempt_ = 0;
+  uint32_t backoffMs_;
+  char line_[96];
+  size_t lineLen_ = 0;
+};
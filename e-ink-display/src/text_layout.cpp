@@ -0,0 +1,262 @@
+#include "text_layout.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct GlyphMapping {
+  uint16_t codepoint;
+  uint8_t cp437;      // glyph in the built-in font, 0 = none
+  const char* ascii;  // spelling for fonts without the glyph
+};
+
+// German first, then what typically shows up in mail subjects and snippets
+const GlyphMapping GLYPH_MAPPINGS[] = {
+    {0x00E4, 0x84, "ae"}, {0x00F6, 0x94, "oe"}, {0x00FC, 0x81, "ue"},
+    {0x00C4, 0x8E, "Ae"}, {0x00D6, 0x99, "Oe"}, {0x00DC, 0x9A, "Ue"},
+    {0x00DF, 0xE1, "ss"}, {0x00E9, 0x82, "e"},  {0x00E8, 0x8A, "e"},
+    {0x00C9, 0x90, "E"},  {0x00E0, 0x85, "a"},  {0x00E1, 0xA0, "a"},
+    {0x00E7, 0x87, "c"},  {0x00F1, 0xA4, "n"},  {0x00B0, 0xF8, "o"},
+    {0x00A0, ' ', " "},   {0x2013, '-', "-"},   {0x2014, '-', "-"},
+    {0x2018, '\'', "'"},  {0x2019, '\'', "'"},  {0x201A, ',', ","},
+    {0x201C, '"', "\""},  {0x201D, '"', "\""},  {0x201E, '"', "\""},
+    {0x2026, 0, "..."},   {0x20AC, 0, "EUR"},
+};
+
+constexpr char ELLIPSIS[] = "...";
+constexpr size_t ELLIPSIS_LEN = sizeof(ELLIPSIS) - 1;
+// Backend strings are at most a few hundred bytes and encoding never makes
+// them longer than their UTF-8 form
+constexpr size_t LAYOUT_SCRATCH_LEN = 256;
+
+const GlyphMapping* findMapping(uint32_t codepoint) {
+  for (const GlyphMapping& mapping : GLYPH_MAPPINGS) {
+    if (mapping.codepoint == codepoint) return &mapping;
+  }
+  return nullptr;
+}
+
+// Decodes one UTF-8 sequence; malformed input yields U+FFFD and skips a byte
+uint32_t nextCodepoint(const char*& cursor) {
+  uint8_t lead = static_cast<uint8_t>(*cursor++);
+  if (lead < 0x80) return lead;
+  size_t extra;
+  uint32_t codepoint;
+  if ((lead & 0xE0) == 0xC0) {
+    extra = 1;
+    codepoint = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    extra = 2;
+    codepoint = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    extra = 3;
+    codepoint = lead & 0x07;
+  } else {
+    return 0xFFFD;
+  }
+  for (size_t i = 0; i < extra; ++i) {
+    uint8_t next = static_cast<uint8_t>(*cursor);
+    if ((next & 0xC0) != 0x80) return 0xFFFD;
+    codepoint = (codepoint << 6) | (next & 0x3F);
+    ++cursor;
+  }
+  return codepoint;
+}
+
+// Number of glyphs from `text` that fit into `maxWidth`
+size_t fitPrefix(const TextFont& font, const char* text, size_t length, int16_t maxWidth) {
+  int32_t width = 0;
+  size_t count = 0;
+  while (count < length) {
+    width += font.advance(static_cast<uint8_t>(text[count]));
+    if (width > maxWidth) break;
+    ++count;
+  }
+  return count;
+}
+
+size_t trimTrailingSpaces(const char* text, size_t length) {
+  while (length > 0 && text[length - 1] == ' ') --length;
+  return length;
+}
+
+void copyRun(const char* text, size_t length, char* target, size_t capacity) {
+  if (length >= capacity) length = capacity - 1;
+  memcpy(target, text, length);
+  target[length] = '\0';
+}
+
+// Writes as much of `text` as fits together with a trailing ellipsis
+void copyEllipsised(const TextFont& font, const char* text, size_t length, int16_t maxWidth,
+                    char* target, size_t capacity) {
+  if (capacity <= ELLIPSIS_LEN) {
+    target[0] = '\0';
+    return;
+  }
+  int16_t room = maxWidth - static_cast<int16_t>(font.measure(ELLIPSIS, ELLIPSIS_LEN));
+  size_t keep = room > 0 ? fitPrefix(font, text, length, room) : 0;
+  if (keep > capacity - 1 - ELLIPSIS_LEN) keep = capacity - 1 - ELLIPSIS_LEN;
+  keep = trimTrailingSpaces(text, keep);
+  memcpy(target, text, keep);
+  memcpy(target + keep, ELLIPSIS, ELLIPSIS_LEN + 1);
+}
+
+}  // namespace
+
+TextFont::TextFont(const GFXfont* font, uint8_t size) : font_(font) {
+  if (size == 0) size = 1;
+  memset(advances_, 0, sizeof(advances_));
+  if (!font) {
+    // Built-in font: 5x7 glyphs on a 6x8 cell for all 256 codes
+    lineHeight_ = static_cast<uint8_t>(8 * size);
+    memset(advances_, 6 * size, sizeof(advances_));
+    return;
+  }
+  lineHeight_ = static_cast<uint8_t>(font->yAdvance * size);
+  for (uint16_t c = font->first; c <= font->last && c < 256; ++c) {
+    advances_[c] = static_cast<uint8_t>(font->glyph[c - font->first].xAdvance * size);
+  }
+}
+
+uint16_t TextFont::measure(const char* encoded, size_t length) const {
+  uint16_t width = 0;
+  for (size_t i = 0; i < length; ++i) {
+    width += advances_[static_cast<uint8_t>(encoded[i])];
+  }
+  return width;
+}
+
+size_t TextFont::encode(const char* utf8, char* target, size_t capacity) const {
+  if (capacity == 0) return 0;
+  size_t length = 0;
+  const char* cursor = utf8 ? utf8 : "";
+  while (*cursor && length + 1 < capacity) {
+    uint32_t codepoint = nextCodepoint(cursor);
+    if (codepoint < 0x20) codepoint = ' ';  // newlines and tabs in snippets
+    const char* spelling = nullptr;
+    char glyph = '?';
+    if (codepoint < 0x80) {
+      glyph = static_cast<char>(codepoint);
+    } else if (const GlyphMapping* mapping = findMapping(codepoint)) {
+      if (!font_ && mapping->cp437) {
+        glyph = static_cast<char>(mapping->cp437);
+      } else if (font_ && codepoint < 256 && advances_[codepoint]) {
+        glyph = static_cast<char>(codepoint);  // 8-bit font with Latin-1 glyphs
+      } else {
+        spelling = mapping->ascii;
+      }
+    }
+    if (spelling) {
+      for (const char* p = spelling; *p && length + 1 < capacity; ++p) {
+        target[length++] = *p;
+      }
+    } else {
+      target[length++] = glyph;
+    }
+  }
+  target[length] = '\0';
+  return length;
+}
+
+void layoutLine(const TextFont& font, const char* utf8, int16_t maxWidth, char* target, size_t capacity) {
+  if (capacity == 0) return;
+  char encoded[LAYOUT_SCRATCH_LEN];
+  size_t length = font.encode(utf8, encoded, sizeof(encoded));
+  if (font.measure(encoded, length) <= maxWidth && length < capacity) {
+    copyRun(encoded, length, target, capacity);
+  } else {
+    copyEllipsised(font, encoded, length, maxWidth, target, capacity);
+  }
+}
+
+size_t layoutWrapped(const TextFont& font, const char* utf8, int16_t maxWidth,
+                     char* lines, size_t lineCapacity, size_t maxLines) {
+  if (lineCapacity == 0) return 0;
+  for (size_t i = 0; i < maxLines; ++i) {
+    lines[i * lineCapacity] = '\0';
+  }
+  char encoded[LAYOUT_SCRATCH_LEN];
+  size_t length = font.encode(utf8, encoded, sizeof(encoded));
+  const char* cursor = encoded;
+  const char* end = encoded + length;
+  size_t used = 0;
+  while (used < maxLines) {
+    while (cursor < end && *cursor == ' ') ++cursor;
+    if (cursor == end) break;
+    char* line = lines + used * lineCapacity;
+    size_t remaining = static_cast<size_t>(end - cursor);
+    size_t fit = fitPrefix(font, cursor, remaining, maxWidth);
+    if (fit > lineCapacity - 1) fit = lineCapacity - 1;
+    if (fit >= remaining) {
+      copyRun(cursor, remaining, line, lineCapacity);
+      ++used;
+      break;
+    }
+    if (used + 1 == maxLines) {
+      copyEllipsised(font, cursor, remaining, maxWidth, line, lineCapacity);
+      ++used;
+      break;
+    }
+    if (fit == 0) fit = 1;  // always make progress, even on a too-narrow box
+    size_t split = fit;
+    if (cursor[fit] != ' ') {
+      // Break after the last complete word; a single long word is split
+      for (size_t i = fit; i > 0; --i) {
+        if (cursor[i - 1] == ' ') {
+          split = i;
+          break;
+        }
+      }
+    }
+    copyRun(cursor, trimTrailingSpaces(cursor, split), line, lineCapacity);
+    cursor += split;
+    ++used;
+  }
+  return used;
+}
+
+void extractTimeFromISO(const char* isoTime, char* timeBuf, size_t bufSize) {
+  if (!isoTime || bufSize < 6) {
+    strlcpy(timeBuf, "--:--", bufSize);
+    return;
+  }
+  // Format: YYYY-MM-DDTHH:MM:SS...
+  // Extract HH:MM starting at position 11
+  if (strlen(isoTime) > 16) {
+    snprintf(timeBuf, bufSize, "%.5s", isoTime + 11);  // HH:MM
+  } else {
+    strlcpy(timeBuf, "--:--", bufSize);
+  }
+}
+
+void layoutCalendarWindow(const TextFont& font, const StateEventList& events, const uint8_t* shown,
+                          uint8_t shownCount, uint8_t first, const CalendarBoxes& boxes) {
+  static const int16_t rowWidths[UI_LIST_ROWS] = {UI_SELECTED_TEXT_W, UI_SLOT_TEXT_W, UI_SLOT_TEXT_W};
+  char formatted[96];
+  for (uint8_t row = 0; row < UI_LIST_ROWS; ++row) {
+    formatted[0] = '\0';
+    if (first + row < shownCount) {
+      const uint8_t item = shown[first + row];
+      char timeBuf[6];
+      extractTimeFromISO(events.start(item), timeBuf, sizeof(timeBuf));
+      snprintf(formatted, sizeof(formatted), "%s %s", timeBuf, events.summary(item));
+    }
+    if (row == 0) strlcpy(boxes.header.text, formatted, boxes.header.capacity);
+    layoutLine(font, formatted, rowWidths[row], boxes.rows[row].text, boxes.rows[row].capacity);
+  }
+  const char* location = first < shownCount ? events.location(shown[first]) : "";
+  layoutLine(font, location, UI_DETAIL_TEXT_W, boxes.location.text, boxes.location.capacity);
+}
+
+void layoutEmailWindow(const TextFont& listFont, const TextFont& summaryFont, const StateMailList& mails,
+                       const uint8_t* shown, uint8_t shownCount, uint8_t first, const EmailBoxes& boxes) {
+  static const int16_t rowWidths[UI_LIST_ROWS] = {UI_SELECTED_TEXT_W, UI_SLOT_TEXT_W, UI_SLOT_TEXT_W};
+  for (uint8_t row = 0; row < UI_LIST_ROWS; ++row) {
+    const char* sender = first + row < shownCount ? mails.from(shown[first + row]) : "";
+    layoutLine(listFont, sender, rowWidths[row], boxes.rows[row].text, boxes.rows[row].capacity);
+  }
+  strlcpy(boxes.summary.text, mails.snippet(shown[first]), boxes.summary.capacity);
+  layoutWrapped(summaryFont, boxes.summary.text, UI_SUMMARY_TEXT_W, boxes.summaryLines,
+                boxes.summaryLineCapacity, UI_SUMMARY_LINES);
+}
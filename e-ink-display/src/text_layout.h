@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Adafruit_GFX.h>
+
+#include "device_state.h"
+#include "ui.h"
+
+// Text layout for the UI boxes. Strings arrive from the backend as UTF-8;
+// layout converts them once per content change into the 8-bit glyph
+// encoding of the font (CP437 for the built-in font, so umlauts and ß have
+// real glyphs) and fits them to a pixel width by word wrapping or with a
+// trailing "...". The draw functions then only print the prepared buffers.
+class TextFont {
+ public:
+  // font = nullptr selects the built-in 6x8 font. The font must stay valid.
+  TextFont(const GFXfont* font, uint8_t size);
+
+  uint8_t advance(uint8_t glyph) const { return advances_[glyph]; }
+  uint8_t lineHeight() const { return lineHeight_; }
+  // Width in pixels of already encoded text
+  uint16_t measure(const char* encoded, size_t length) const;
+  // Converts UTF-8 to this font's glyph encoding; returns the encoded length.
+  // Characters without a glyph fall back to a close ASCII spelling or '?'.
+  size_t encode(const char* utf8, char* target, size_t capacity) const;
+
+ private:
+  const GFXfont* font_;
+  uint8_t lineHeight_;
+  uint8_t advances_[256];  // per-glyph advance incl. text size, 0 = no glyph
+};
+
+// Fits `utf8` into one line of `maxWidth` pixels, ending in "..." when cut.
+void layoutLine(const TextFont& font, const char* utf8, int16_t maxWidth, char* target, size_t capacity);
+
+// Word-wraps `utf8` into up to `maxLines` lines of `maxWidth` pixels. Lines
+// are stored `lineCapacity` bytes apart starting at `lines`; unused lines are
+// emptied and the last line ends in "..." when text is left over. Words wider
+// than a line are broken. Returns the number of lines used.
+size_t layoutWrapped(const TextFont& font, const char* utf8, int16_t maxWidth,
+                     char* lines, size_t lineCapacity, size_t maxLines);
+
+// -----------------------------------------------------------------------------
+// Item windows
+// -----------------------------------------------------------------------------
+// Each content screen lists the selected item and the two after it.
+static constexpr uint8_t UI_LIST_ROWS = 3;
+
+// A UI buffer to lay text out into; the caller owns the storage.
+struct TextBox {
+  char* text;
+  size_t capacity;
+};
+
+struct CalendarBoxes {
+  TextBox header;               // "HH:MM summary" of the selected event, not fitted
+  TextBox rows[UI_LIST_ROWS];   // the same for the window's events, fitted
+  TextBox location;             // of the selected event
+};
+
+struct EmailBoxes {
+  TextBox rows[UI_LIST_ROWS];   // senders of the window's mails
+  TextBox summary;              // snippet of the selected mail, as received
+  char* summaryLines;           // UI_SUMMARY_LINES wrapped lines of it,
+  size_t summaryLineCapacity;   // this many bytes apart
+};
+
+// Writes HH:MM of an ISO 8601 timestamp ("2026-01-08T07:50:00+01:00"), or
+// "--:--" when there is none.
+void extractTimeFromISO(const char* isoTime, char* timeBuf, size_t bufSize);
+
+// Lays out the window of the shown events that starts at position `first`.
+// `shown` holds indices into `events` in display order; rows past its end
+// are emptied.
+void layoutCalendarWindow(const TextFont& font, const StateEventList& events, const uint8_t* shown,
+                          uint8_t shownCount, uint8_t first, const CalendarBoxes& boxes);
+
+// Email counterpart of layoutCalendarWindow(); the summary is wrapped in
+// `summaryFont`. Needs first < shownCount.
+void layoutEmailWindow(const TextFont& listFont, const TextFont& summaryFont, const StateMailList& mails,
+                       const uint8_t* shown, uint8_t shownCount, uint8_t first, const EmailBoxes& boxes);
@@ -0,0 +1,196 @@
+#include "ui.h"
+
+#include <Arduino.h>
+#include <GxEPD2_BW.h>
+
+#include "fingerprint.h"
+
+// -----------------------------------------------------------------------------
+// Bitmaps
+// -----------------------------------------------------------------------------
+static const unsigned char PROGMEM image_calendar_bits[] = {0x09,0x20,0x76,0xdc,0xff,0xfe,0xff,0xfe,0x80,0x02,0x86,0xda,0x86,0xda,0x80,0x02,0xb6,0xda,0xb6,0xda,0x80,0x02,0xb6,0xc2,0xb6,0xc2,0x80,0x02,0x7f,0xfc,0x00,0x00};
+
+static const unsigned char PROGMEM image_message_mail_bits[] = {0x00,0x00,0x00,0x7f,0xff,0x00,0xc0,0x01,0x80,0xe0,0x03,0x80,0xb0,0x06,0x80,0x98,0x0c,0x80,0x8c,0x18,0x80,0x86,0x30,0x80,0x83,0x60,0x80,0x85,0xd0,0x80,0x88,0x08,0x80,0x90,0x04,0x80,0xa0,0x02,0x80,0xc0,0x01,0x80,0x7f,0xff,0x00,0x00,0x00,0x00};
+
+static const unsigned char PROGMEM image_rounding_bits[] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+
+// -----------------------------------------------------------------------------
+// Widget constructors
+// -----------------------------------------------------------------------------
+static constexpr UiWidget uiFillBox(UiRegion region, int16_t x, int16_t y, int16_t w, int16_t h, uint8_t radius) {
+    return UiWidget{UiWidgetKind::FillBox, region, UiRect{x, y, w, h}, GxEPD_BLACK, radius, UI_TEXT_FIXED, nullptr, nullptr};
+}
+
+static constexpr UiWidget uiOutlineBox(UiRegion region, int16_t x, int16_t y, int16_t w, int16_t h, uint8_t radius) {
+    return UiWidget{UiWidgetKind::OutlineBox, region, UiRect{x, y, w, h}, GxEPD_BLACK, radius, UI_TEXT_FIXED, nullptr, nullptr};
+}
+
+// Bound text laid out by main.cpp to `w`, one line of the given size
+static constexpr UiWidget uiText(UiRegion region, int16_t x, int16_t y, int16_t w, uint8_t size, uint16_t color, UiText text) {
+    return UiWidget{UiWidgetKind::Text, region, UiRect{x, y, w, static_cast<int16_t>(8 * size)}, color, size, text, nullptr, nullptr};
+}
+
+// Fixed label, sized from its length in the built-in 6x8 font
+static constexpr UiWidget uiLabel(UiRegion region, int16_t x, int16_t y, uint8_t size, uint16_t color, const char* label, size_t length) {
+    return UiWidget{UiWidgetKind::Text, region, UiRect{x, y, static_cast<int16_t>(6 * size * length), static_cast<int16_t>(8 * size)},
+                    color, size, UI_TEXT_FIXED, label, nullptr};
+}
+#define UI_LABEL(region, x, y, size, color, label) uiLabel(region, x, y, size, color, label, sizeof(label) - 1)
+
+static constexpr UiWidget uiBitmap(UiRegion region, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, const uint8_t* bitmap) {
+    return UiWidget{UiWidgetKind::Bitmap, region, UiRect{x, y, w, h}, color, 0, UI_TEXT_FIXED, nullptr, bitmap};
+}
+
+// -----------------------------------------------------------------------------
+// Screens
+// -----------------------------------------------------------------------------
+// Widgets are drawn in table order and later ones paint over earlier ones,
+// so the order is part of the layout.
+static constexpr UiWidget CALENDAR_WIDGETS[] = {
+    uiFillBox(UI_REGION_SELECTED, 5, 25, 190, 28, 3),                                         // selected_termin_box
+    uiOutlineBox(UI_REGION_SLOT_2, 5, 58, 183, 28, 3),                                        // termin_slot_2_box
+    uiText(UI_REGION_SLOT_2, 11, 64, UI_SLOT_TEXT_W, 2, GxEPD_BLACK, UI_TEXT_CAL_SLOT_2),
+    uiFillBox(UI_REGION_DETAIL, 191, 25, 102, 100, 3),                                        // selected_termin_detail_box
+    UI_LABEL(UI_REGION_DETAIL, 197, 59, 1, GxEPD_WHITE, "Ort:"),
+    uiText(UI_REGION_DETAIL, 196, 69, UI_DETAIL_TEXT_W, 2, GxEPD_WHITE, UI_TEXT_CAL_LOCATION),  // ort_details_text
+    // Attendees are not part of the snapshot, the label stays on its own
+    UI_LABEL(UI_REGION_DETAIL, 196, 88, 1, GxEPD_WHITE, "Personen:"),
+    uiOutlineBox(UI_REGION_SLOT_3, 5, 91, 183, 28, 3),                                        // termin_slot_3_box
+    uiText(UI_REGION_SLOT_3, 11, 97, UI_SLOT_TEXT_W, 2, GxEPD_BLACK, UI_TEXT_CAL_SLOT_3),
+    uiText(UI_REGION_SELECTED, 10, 32, UI_SELECTED_TEXT_W, 2, GxEPD_WHITE, UI_TEXT_CAL_SELECTED),
+    uiOutlineBox(UI_REGION_NAV, 0, -10, 296, 30, 3),                                          // nav_bar
+    uiFillBox(UI_REGION_NAV, 3, -12, 20, 30, 2),                                              // calendar selected
+    uiBitmap(UI_REGION_NAV, 6, 1, 15, 16, GxEPD_WHITE, image_calendar_bits),
+    uiBitmap(UI_REGION_NONE, 131, 53, 60, 25, GxEPD_BLACK, image_rounding_bits),
+    uiBitmap(UI_REGION_NAV, 26, 1, 17, 16, GxEPD_BLACK, image_message_mail_bits),
+    uiText(UI_REGION_CLOCK, 260, 6, UI_SCREEN_W - 260, 1, GxEPD_BLACK, UI_TEXT_CLOCK),
+    uiText(UI_REGION_NAV, UI_NOTICE_X, 6, 260 - UI_NOTICE_X, 1, GxEPD_BLACK, UI_TEXT_NOTICE),
+};
+
+static constexpr UiWidget EMAIL_WIDGETS[] = {
+    uiFillBox(UI_REGION_SELECTED, 5, 25, 190, 28, 3),
+    uiOutlineBox(UI_REGION_SLOT_2, 5, 58, 183, 28, 3),
+    uiText(UI_REGION_SLOT_2, 11, 64, UI_SLOT_TEXT_W, 2, GxEPD_BLACK, UI_TEXT_MAIL_SLOT_2),
+    uiFillBox(UI_REGION_DETAIL, 191, 25, 102, 100, 3),
+    UI_LABEL(UI_REGION_DETAIL, 195, 53, 1, GxEPD_WHITE, "AI summary:"),
+    uiOutlineBox(UI_REGION_SLOT_3, 5, 91, 183, 28, 3),
+    uiText(UI_REGION_SLOT_3, 11, 97, UI_SLOT_TEXT_W, 2, GxEPD_BLACK, UI_TEXT_MAIL_SLOT_3),
+    uiText(UI_REGION_SELECTED, 10, 32, UI_SELECTED_TEXT_W, 2, GxEPD_WHITE, UI_TEXT_MAIL_SELECTED),
+    uiOutlineBox(UI_REGION_NAV, 0, -10, 296, 30, 3),
+    uiFillBox(UI_REGION_NAV, 24, -12, 21, 30, 2),                                             // email selected
+    uiBitmap(UI_REGION_NAV, 6, 1, 15, 16, GxEPD_BLACK, image_calendar_bits),
+    uiText(UI_REGION_DETAIL, 195, 63, UI_SUMMARY_TEXT_W, 1, GxEPD_WHITE, UI_TEXT_MAIL_SUMMARY),
+    uiBitmap(UI_REGION_NONE, 131, 53, 60, 25, GxEPD_BLACK, image_rounding_bits),
+    uiText(UI_REGION_DETAIL, 195, 71, UI_SUMMARY_TEXT_W, 1, GxEPD_WHITE, static_cast<UiText>(UI_TEXT_MAIL_SUMMARY + 1)),
+    uiBitmap(UI_REGION_NAV, 26, 1, 17, 16, GxEPD_WHITE, image_message_mail_bits),
+    uiText(UI_REGION_DETAIL, 195, 79, UI_SUMMARY_TEXT_W, 1, GxEPD_WHITE, static_cast<UiText>(UI_TEXT_MAIL_SUMMARY + 2)),
+    uiText(UI_REGION_CLOCK, 260, 6, UI_SCREEN_W - 260, 1, GxEPD_BLACK, UI_TEXT_CLOCK),
+    uiText(UI_REGION_NAV, UI_NOTICE_X, 6, 260 - UI_NOTICE_X, 1, GxEPD_BLACK, UI_TEXT_NOTICE),
+    uiText(UI_REGION_DETAIL, 195, 87, UI_SUMMARY_TEXT_W, 1, GxEPD_WHITE, static_cast<UiText>(UI_TEXT_MAIL_SUMMARY + 3)),
+    uiText(UI_REGION_DETAIL, 195, 95, UI_SUMMARY_TEXT_W, 1, GxEPD_WHITE, static_cast<UiText>(UI_TEXT_MAIL_SUMMARY + 4)),
+    uiText(UI_REGION_DETAIL, 195, 103, UI_SUMMARY_TEXT_W, 1, GxEPD_WHITE, static_cast<UiText>(UI_TEXT_MAIL_SUMMARY + 5)),
+};
+static_assert(UI_SUMMARY_LINES == 6, "EMAIL_WIDGETS draws six summary lines");
+
+template <size_t N>
+static constexpr uint8_t widgetCount(const UiWidget (&)[N]) {
+    return N;
+}
+
+const UiScreen UI_CALENDAR_SCREEN = {CALENDAR_WIDGETS, widgetCount(CALENDAR_WIDGETS)};
+const UiScreen UI_EMAIL_SCREEN = {EMAIL_WIDGETS, widgetCount(EMAIL_WIDGETS)};
+
+// -----------------------------------------------------------------------------
+// Region map
+// -----------------------------------------------------------------------------
+static constexpr UiRect UI_RECT_EMPTY = {0, 0, 0, 0};
+
+static constexpr int16_t uiMin(int16_t a, int16_t b) { return a < b ? a : b; }
+static constexpr int16_t uiMax(int16_t a, int16_t b) { return a > b ? a : b; }
+static constexpr bool uiEmpty(UiRect r) { return r.w <= 0 || r.h <= 0; }
+
+static constexpr UiRect uiClip(UiRect r) {
+    return UiRect{uiMax(r.x, 0), uiMax(r.y, 0),
+                  static_cast<int16_t>(uiMin(r.x + r.w, UI_SCREEN_W) - uiMax(r.x, 0)),
+                  static_cast<int16_t>(uiMin(r.y + r.h, UI_SCREEN_H) - uiMax(r.y, 0))};
+}
+
+static constexpr UiRect uiUnion(UiRect a, UiRect b) {
+    return uiEmpty(a) ? b
+           : uiEmpty(b) ? a
+           : UiRect{uiMin(a.x, b.x), uiMin(a.y, b.y),
+                    static_cast<int16_t>(uiMax(a.x + a.w, b.x + b.w) - uiMin(a.x, b.x)),
+                    static_cast<int16_t>(uiMax(a.y + a.h, b.y + b.h) - uiMin(a.y, b.y))};
+}
+
+static constexpr UiRect uiRegionBounds(const UiWidget* widgets, size_t count, UiRegion region) {
+    return count == 0 ? UI_RECT_EMPTY
+                      : uiUnion(widgets[0].region == region ? uiClip(widgets[0].rect) : UI_RECT_EMPTY,
+                                uiRegionBounds(widgets + 1, count - 1, region));
+}
+
+static constexpr UiRect uiRegionBounds(UiRegion region) {
+    return uiUnion(uiRegionBounds(CALENDAR_WIDGETS, widgetCount(CALENDAR_WIDGETS), region),
+                   uiRegionBounds(EMAIL_WIDGETS, widgetCount(EMAIL_WIDGETS), region));
+}
+
+constexpr UiRect UI_REGION_RECTS[UI_REGION_COUNT] = {
+    uiRegionBounds(UI_REGION_NAV),       // {0, 0, 296, 20}: nav bar, mode icons, notice
+    uiRegionBounds(UI_REGION_CLOCK),     // {260, 6, 36, 8}
+    uiRegionBounds(UI_REGION_SELECTED),  // {5, 25, 190, 28}
+    uiRegionBounds(UI_REGION_SLOT_2),    // {5, 58, 183, 28}
+    uiRegionBounds(UI_REGION_SLOT_3),    // {5, 91, 183, 28}
+    uiRegionBounds(UI_REGION_DETAIL),    // {191, 25, 102, 100}
+};
+
+static constexpr bool uiRegionsCovered(size_t region) {
+    return region == UI_REGION_COUNT || (!uiEmpty(UI_REGION_RECTS[region]) && uiRegionsCovered(region + 1));
+}
+static_assert(uiRegionsCovered(0), "every region needs at least one widget on screen");
+
+// -----------------------------------------------------------------------------
+// Rendering
+// -----------------------------------------------------------------------------
+static const char* widgetText(const UiWidget& widget, const UiTexts& texts) {
+    return widget.text == UI_TEXT_FIXED ? widget.label : texts[widget.text];
+}
+
+void drawScreen(Adafruit_GFX& gfx, const UiScreen& screen, const UiTexts& texts) {
+    gfx.fillScreen(GxEPD_WHITE);
+    // Texts are laid out in CP437 (see text_layout.h)
+    gfx.setFont(nullptr);
+    gfx.cp437(true);
+    gfx.setTextWrap(false);
+    for (uint8_t i = 0; i < screen.count; ++i) {
+        const UiWidget& widget = screen.widgets[i];
+        const UiRect& r = widget.rect;
+        switch (widget.kind) {
+            case UiWidgetKind::FillBox:
+                gfx.fillRoundRect(r.x, r.y, r.w, r.h, widget.style, widget.color);
+                break;
+            case UiWidgetKind::OutlineBox:
+                gfx.drawRoundRect(r.x, r.y, r.w, r.h, widget.style, widget.color);
+                break;
+            case UiWidgetKind::Bitmap:
+                gfx.drawBitmap(r.x, r.y, widget.bitmap, r.w, r.h, widget.color);
+                break;
+            case UiWidgetKind::Text:
+                gfx.setTextColor(widget.color);
+                gfx.setTextSize(widget.style);
+                gfx.setCursor(r.x, r.y);
+                gfx.print(widgetText(widget, texts));
+                break;
+        }
+    }
+}
+
+uint32_t uiRegionFingerprint(const UiScreen& screen, UiRegion region, const UiTexts& texts) {
+    Fnv1a hash;
+    for (uint8_t i = 0; i < screen.count; ++i) {
+        const UiWidget& widget = screen.widgets[i];
+        if (widget.region == region && widget.kind == UiWidgetKind::Text && widget.text != UI_TEXT_FIXED) {
+            hash.add(texts[widget.text]);
+        }
+    }
+    return hash.value();
+}
@@ -1,187 +1,103 @@
-
-static const unsigned char PROGMEM image_calendar_bits[] = {0x09,0x20,0x76,0xdc,0xff,0xfe,0xff,0xfe,0x80,0x02,0x86,0xda,0x86,0xda,0x80,0x02,0xb6,0xda,0xb6,0xda,0x80,0x02,0xb6,0xc2,0xb6,0xc2,0x80,0x02,0x7f,0xfc,0x00,0x00};
-
-static const unsigned char PROGMEM image_message_mail_bits[] = {0x00,0x00,0x00,0x7f,0xff,0x00,0xc0,0x01,0x80,0xe0,0x03,0x80,0xb0,0x06,0x80,0x98,0x0c,0x80,0x8c,0x18,0x80,0x86,0x30,0x80,0x83,0x60,0x80,0x85,0xd0,0x80,0x88,0x08,0x80,0x90,0x04,0x80,0xa0,0x02,0x80,0xc0,0x01,0x80,0x7f,0xff,0x00,0x00,0x00,0x00};
-
-static const unsigned char PROGMEM image_rounding_bits[] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
-
-// ui shared bitmaps only; specific draw functions are in ui/calendar.h and ui/email.h
-// declare display provided by main.cpp
-extern GxEPD2_BW<GxEPD2_290_T94, GxEPD2_290_T94::HEIGHT> display;
-// declare current time supplied by main.cpp
-extern const char* currentTimeStr; // provided by main.cpp
-
-// Calendar drawing implementation
-extern const char* cal_Layer_2_copy_text;
-extern const char* cal_Layer_8_copy_text;
-extern const char* cal_ort_details_text_text;
-extern const char* cal_selected_termin_text_text;
-extern const char* cal_termin_slot_3_text_text;
-
-void drawCalendar(void) {
-    display.fillScreen(GxEPD_WHITE);
-
-    // selected_termin_box
-    display.fillRoundRect(5, 25, 190, 28, 3, GxEPD_BLACK);
-
-    // termin_slot_2_box
-    display.drawRoundRect(5, 58, 183, 28, 3, GxEPD_BLACK);
-
-    // Layer 2 copy
-    display.setTextColor(GxEPD_BLACK);
-    display.setTextSize(2);
-    display.setTextWrap(false);
-    display.setCursor(11, 64);
-    display.print(cal_Layer_2_copy_text);
-
-    // selected_termin_detail_box
-    display.fillRoundRect(191, 25, 102, 100, 3, GxEPD_BLACK);
-
-    // Layer 8
-    display.setTextColor(GxEPD_WHITE);
-    display.setTextSize(1);
-    display.setCursor(197, 59);
-    display.print("Ort:");
-
-    // ort_details_text
-    display.setTextSize(2);
-    display.setCursor(196, 69);
-    display.print(cal_ort_details_text_text);
-
-    // person_prefix
-    display.setTextSize(1);
-    display.setCursor(196, 88);
-    display.print("Personen:");
-
-    // termin_slot_3_box
-    display.drawRoundRect(5, 91, 183, 28, 3, GxEPD_BLACK);
-
-    // Personen details (not available in snapshot) -> leave empty
-    display.setTextSize(2);
-    display.setCursor(196, 98);
-    display.print("");
-
-    // termin_slot_3_text
-    display.setTextColor(GxEPD_BLACK);
-    display.setCursor(11, 97);
-    display.print(cal_termin_slot_3_text_text);
-
-    // selected_termin_text
-    display.setTextColor(GxEPD_WHITE);
-    display.setCursor(10, 32);
-    display.print(cal_selected_termin_text_text);
-
-    // nav_bar
-    display.drawRoundRect(0, -10, 296, 30, 3, GxEPD_BLACK);
-
-    // currently_selected_mode (calendar selected -> white icon)
-    display.fillRoundRect(3, -12, 20, 30, 2, GxEPD_BLACK);
-
-    // calendar (selected icon should be white)
-    display.drawBitmap(6, 1, image_calendar_bits, 15, 16, GxEPD_WHITE);
-
-    // rounding
-    display.drawBitmap(131, 53, image_rounding_bits, 60, 25, GxEPD_BLACK);
-
-    // message_mail
-    display.drawBitmap(26, 1, image_message_mail_bits, 17, 16, GxEPD_BLACK);
-
-    // current_time (from main.cpp)
-    display.setTextColor(GxEPD_BLACK);
-    display.setTextSize(1);
-    display.setCursor(260, 6);
-    display.print(currentTimeStr);
+#pragma once
+
+#include <Adafruit_GFX.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The content screens are constexpr widget tables (see ui.cpp) drawn by one
+// generic renderer onto any GFX surface in rotated (296x128) coordinates:
+// the panel itself or an off-screen mode frame in main.cpp. The same tables
+// give the partial-refresh region map and the per-region fingerprints, so a
+// new screen is a new table rather than new draw code.
+static const int16_t UI_SCREEN_W = 296;
+static const int16_t UI_SCREEN_H = 128;
+
+// Screen regions used by the partial refresh engine in main.cpp. Rects are in
+// rotated (296x128) coordinates and cover the widgets tagged with them;
+// overlapping neighbours are fine because the screens are re-run clipped to
+// the window.
+struct UiRect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+};
+
+enum UiRegion : uint8_t {
+    UI_REGION_NAV = 0,
+    UI_REGION_CLOCK,
+    UI_REGION_SELECTED,
+    UI_REGION_SLOT_2,
+    UI_REGION_SLOT_3,
+    UI_REGION_DETAIL,
+    UI_REGION_COUNT,
+    UI_REGION_NONE = UI_REGION_COUNT  // fixed decoration, only drawn with its neighbours
+};
+
+// Union of the widget rects of each region over all screens, clipped to the
+// screen; computed at compile time from the tables
+extern const UiRect UI_REGION_RECTS[UI_REGION_COUNT];
+
+// Text widths inside the boxes drawn below (built-in font, left inset
+// included); main.cpp lays strings out to these before drawing
+static const uint8_t UI_TEXT_SIZE_LARGE = 2;
+static const uint8_t UI_TEXT_SIZE_SMALL = 1;
+static const int16_t UI_SELECTED_TEXT_W = 180;  // selected_termin_text at x=10
+static const int16_t UI_SLOT_TEXT_W = 172;      // slot texts at x=11
+static const int16_t UI_DETAIL_TEXT_W = 94;     // ort_details_text at x=196
+static const int16_t UI_SUMMARY_TEXT_W = 96;    // AI summary lines at x=195
+static const uint8_t UI_SUMMARY_LINES = 6;
+static const int16_t UI_NOTICE_X = 214;         // up to 7 characters before the clock
+
+static inline uint8_t uiRegionBit(UiRegion region) {
+    return static_cast<uint8_t>(1u << region);
 }
 
-// Email drawing implementation
-extern const char* mail_Layer_2_copy_text;
-extern const char* mail_person_prefix_copy_text;
-extern const char* mail_selected_termin_text_text;
-extern const char* mail_termin_slot_3_text_text;
-extern const char* mail_person_line1;
-extern const char* mail_person_line2;
-extern const char* mail_person_line3;
-extern const char* mail_person_line4;
-extern const char* mail_person_line5;
-extern const char* mail_person_line6;
-
-void drawEmail(void) {
-    display.fillScreen(GxEPD_WHITE);
-
-    // selected_termin_box
-    display.fillRoundRect(5, 25, 190, 28, 3, GxEPD_BLACK);
-
-    // termin_slot_2_box
-    display.drawRoundRect(5, 58, 183, 28, 3, GxEPD_BLACK);
-
-    // Layer 2 copy
-    display.setTextColor(GxEPD_BLACK);
-    display.setTextSize(2);
-    display.setTextWrap(false);
-    display.setCursor(11, 64);
-    display.print(mail_Layer_2_copy_text);
-
-    // selected_termin_detail_box
-    display.fillRoundRect(191, 25, 102, 100, 3, GxEPD_BLACK);
-
-    // person_prefix
-    display.setTextColor(GxEPD_WHITE);
-    display.setTextSize(1);
-    display.setCursor(195, 53);
-    display.print("AI summary:");
-
-    // termin_slot_3_box
-    display.drawRoundRect(5, 91, 183, 28, 3, GxEPD_BLACK);
-
-    // termin_slot_3_text
-    display.setTextColor(GxEPD_BLACK);
-    display.setTextSize(2);
-    display.setCursor(11, 97);
-    display.print(mail_termin_slot_3_text_text);
-
-    // selected_termin_text
-    display.setTextColor(GxEPD_WHITE);
-    display.setCursor(10, 32);
-    display.print(mail_selected_termin_text_text);
-
-    // nav_bar
-    display.drawRoundRect(0, -10, 296, 30, 3, GxEPD_BLACK);
-
-    // currently_selected_mode (email selected -> white icon)
-    display.fillRoundRect(24, -12, 21, 30, 2, GxEPD_BLACK);
-
-    // calendar (unselected)
-    display.drawBitmap(6, 1, image_calendar_bits, 15, 16, GxEPD_BLACK);
-
-    // person_prefix copy
-    display.setTextSize(1);
-    display.setCursor(195, 63);
-    display.print(mail_person_line1);
-
-    // rounding
-    display.drawBitmap(131, 53, image_rounding_bits, 60, 25, GxEPD_BLACK);
-
-    // person_prefix copy
-    display.setCursor(195, 71);
-    display.print(mail_person_line2);
-
-    // message_mail (selected -> white icon)
-    display.drawBitmap(26, 1, image_message_mail_bits, 17, 16, GxEPD_WHITE);
-
-    // person_prefix copy
-    display.setCursor(195, 79);
-    display.print(mail_person_line3);
-
-    // current_time (from main.cpp)
-    display.setTextColor(GxEPD_BLACK);
-    display.setCursor(260, 6);
-    display.print(currentTimeStr);
-
-    // extra lines
-    display.setTextColor(GxEPD_WHITE);
-    display.setCursor(195, 87);
-    display.print(mail_person_line4);
-    display.setCursor(195, 95); display.print(mail_person_line5);
-    display.setCursor(195, 103); display.print(mail_person_line6);
-    display.setCursor(195, 112); display.print("");
-}
+// Texts the screens print from the caller's text array. Each slot points at
+// one UI buffer of main.cpp.
+enum UiText : uint8_t {
+    UI_TEXT_CLOCK = 0,
+    UI_TEXT_NOTICE,  // short note left of the clock, e.g. content from the offline cache
+    UI_TEXT_CAL_SELECTED,
+    UI_TEXT_CAL_SLOT_2,
+    UI_TEXT_CAL_SLOT_3,
+    UI_TEXT_CAL_LOCATION,
+    UI_TEXT_MAIL_SELECTED,
+    UI_TEXT_MAIL_SLOT_2,
+    UI_TEXT_MAIL_SLOT_3,
+    UI_TEXT_MAIL_SUMMARY,  // first of UI_SUMMARY_LINES consecutive lines
+    UI_TEXT_COUNT = UI_TEXT_MAIL_SUMMARY + UI_SUMMARY_LINES,
+    UI_TEXT_FIXED = 0xFF  // the widget prints its own label
+};
+
+typedef const char* const UiTexts[UI_TEXT_COUNT];
+
+enum class UiWidgetKind : uint8_t { FillBox, OutlineBox, Text, Bitmap };
+
+// One draw call. Boxes and bitmaps cover `rect`; a text starts with the
+// cursor at rect.x/rect.y and is expected to stay inside the rect.
+struct UiWidget {
+    UiWidgetKind kind;
+    UiRegion region;
+    UiRect rect;
+    uint16_t color;
+    uint8_t style;          // box corner radius, text size
+    UiText text;            // Text: slot of the text array, or UI_TEXT_FIXED
+    const char* label;      // Text with UI_TEXT_FIXED
+    const uint8_t* bitmap;  // Bitmap
+};
+
+struct UiScreen {
+    const UiWidget* widgets;
+    uint8_t count;
+};
+
+extern const UiScreen UI_CALENDAR_SCREEN;
+extern const UiScreen UI_EMAIL_SCREEN;
+
+// Draws every widget of `screen` in table order over a white background
+void drawScreen(Adafruit_GFX& gfx, const UiScreen& screen, const UiTexts& texts);
+
+// Fnv1a over the bound texts `screen` draws in `region`; equal values mean
+// the region would be drawn the same
+uint32_t uiRegionFingerprint(const UiScreen& screen, UiRegion region, const UiTexts& texts);
@@ -1,14 +0,0 @@
-
-
-
-// calendar UI header - declares variables and draw function
-
-#pragma once
-
-extern const char* cal_Layer_2_copy_text;
-extern const char* cal_Layer_8_copy_text;
-extern const char* cal_ort_details_text_text;
-extern const char* cal_selected_termin_text_text;
-
-void drawCalendar(void);
-
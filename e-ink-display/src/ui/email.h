@@ -1,29 +0,0 @@
-
-#pragma once
-
-// email UI header
-extern const char* mail_Layer_2_copy_text;
-extern const char* mail_person_prefix_copy_text;
-extern const char* mail_selected_termin_text_text;
-extern const char* mail_termin_slot_3_text_text;
-// split lines provided by main.cpp
-extern const char* mail_person_line1;
-extern const char* mail_person_line2;
-extern const char* mail_person_line3;
-extern const char* mail_person_line4;
-extern const char* mail_person_line5;
-extern const char* mail_person_line6;
-
-void drawEmail(void);
-0x09,0x20,0x76,0xdc,0xff,0xfe,0xff,0xfe,0x80,0x02,0x86,0xda,0x86,0xda,0x80,0x02,0xb6,0xda,0xb6,0xda,0x80,0x02,0xb6,0xc2,0xb6,0xc2,0x80,0x02,0x7f,0xfc,0x00,0x00};
-
-0x00,0x00,0x00,0x7f,0xff,0x00,0xc0,0x01,0x80,0xe0,0x03,0x80,0xb0,0x06,0x80,0x98,0x0c,0x80,0x8c,0x18,0x80,0x86,0x30,0x80,0x83,0x60,0x80,0x85,0xd0,0x80,0x88,0x08,0x80,0x90,0x04,0x80,0xa0,0x02,0x80,0xc0,0x01,0x80,0x7f,0xff,0x00,0x00,0x00,0x00};
-
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x00,0x00,0x00,0x00,0x00,0x00,0x00};#pragma once
-
-extern const char* mail_Layer_2_copy_text;
-extern const char* mail_person_prefix_copy_text;
-extern const char* mail_selected_termin_text_text;
-extern const char* mail_termin_slot_3_text_text;
-
-void drawEmail(void);
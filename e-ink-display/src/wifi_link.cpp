@@ -0,0 +1,122 @@
+#include "wifi_link.h"
+
+#include <cstddef>
+#include <cstring>
+#include <time.h>
+
+#include "fingerprint.h"
+#include "zen_log.h"
+
+static constexpr char PREF_WIFI_LEASE[] = "wifi_lease";
+// A directed join on a known AP normally completes in well under a second
+static constexpr uint32_t WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;
+static constexpr uint32_t WIFI_SCAN_CONNECT_TIMEOUT_MS = 20000;
+static constexpr uint32_t WIFI_BACKOFF_MIN_MS = 5000;
+static constexpr uint32_t WIFI_BACKOFF_MAX_MS = 300000;
+// Only reuse an address well inside typical home router lease times (24 h);
+// without a valid clock the age is unknown and DHCP runs as usual
+static constexpr uint32_t WIFI_ADDRESS_REUSE_S = 12 * 3600;
+static constexpr time_t CLOCK_VALID_AFTER = 1700000000;
+
+static uint32_t ssidHash(const char* ssid) {
+  return Fnv1a().add(ssid).value();
+}
+
+void WifiLink::begin() {
+  if (prefs_.getBytes(PREF_WIFI_LEASE, &lease_, sizeof(lease_)) != sizeof(lease_)) {
+    lease_ = {};
+  }
+}
+
+bool WifiLink::retryDue() const {
+  return backoffMs_ == 0 || static_cast<long>(millis() - nextAttemptAt_) >= 0;
+}
+
+void WifiLink::forget() {
+  lease_ = {};
+  prefs_.remove(PREF_WIFI_LEASE);
+}
+
+bool WifiLink::waitConnected(uint32_t timeoutMs) {
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - start < timeoutMs) {
+    delay(50);
+  }
+  return WiFi.status() == WL_CONNECTED;
+}
+
+bool WifiLink::addressReusable() const {
+  time_t now = time(nullptr);
+  return lease_.ip != 0 && lease_.obtainedAt != 0 && now > CLOCK_VALID_AFTER &&
+         static_cast<uint32_t>(now) - lease_.obtainedAt < WIFI_ADDRESS_REUSE_S;
+}
+
+bool WifiLink::connect(const char* ssid, const char* password) {
+  WiFi.mode(WIFI_STA);
+  // Credentials and the lease are ours to persist; skip the SDK's flash copy
+  WiFi.persistent(false);
+  bool connected = false;
+  bool reusedAddress = false;
+  if (lease_.valid && lease_.ssidHash == ssidHash(ssid)) {
+    reusedAddress = addressReusable();
+    if (reusedAddress) {
+      WiFi.config(IPAddress(lease_.ip), IPAddress(lease_.gateway), IPAddress(lease_.subnet),
+                  IPAddress(lease_.dns));
+    } else {
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+    WiFi.begin(ssid, password, lease_.channel, lease_.bssid, true);
+    connected = waitConnected(WIFI_FAST_CONNECT_TIMEOUT_MS);
+    if (!connected) {
+      ZEN_LOGI("Wi-Fi fast connect failed, scanning");
+      WiFi.disconnect(false);
+    }
+  }
+  if (!connected) {
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    reusedAddress = false;
+    WiFi.begin(ssid, password);
+    connected = waitConnected(WIFI_SCAN_CONNECT_TIMEOUT_MS);
+  }
+  if (!connected) {
+    scheduleRetry();
+    return false;
+  }
+  backoffMs_ = 0;
+  if (!reusedAddress) {
+    storeLease(ssid);
+  }
+  return true;
+}
+
+void WifiLink::storeLease(const char* ssid) {
+  Lease next = {};
+  next.ssidHash = ssidHash(ssid);
+  const uint8_t* bssid = WiFi.BSSID();
+  if (bssid) memcpy(next.bssid, bssid, sizeof(next.bssid));
+  next.channel = static_cast<uint8_t>(WiFi.channel());
+  next.valid = bssid != nullptr;
+  next.ip = WiFi.localIP();
+  next.gateway = WiFi.gatewayIP();
+  next.subnet = WiFi.subnetMask();
+  next.dns = WiFi.dnsIP(0);
+  time_t now = time(nullptr);
+  next.obtainedAt = now > CLOCK_VALID_AFTER ? static_cast<uint32_t>(now) : 0;
+  // Rewrite flash only when the association changed (address or AP)
+  bool changed = memcmp(&next, &lease_, offsetof(Lease, obtainedAt)) != 0 ||
+                 (next.obtainedAt != 0 && lease_.obtainedAt == 0);
+  // A fresh DHCP lease restarts the reuse window even on the same address
+  if (!changed && next.obtainedAt != 0) {
+    changed = next.obtainedAt - lease_.obtainedAt > WIFI_ADDRESS_REUSE_S / 2;
+  }
+  if (!changed) return;
+  lease_ = next;
+  prefs_.putBytes(PREF_WIFI_LEASE, &lease_, sizeof(lease_));
+}
+
+void WifiLink::scheduleRetry() {
+  backoffMs_ = backoffMs_ == 0 ? WIFI_BACKOFF_MIN_MS
+                               : (backoffMs_ * 2 > WIFI_BACKOFF_MAX_MS ? WIFI_BACKOFF_MAX_MS : backoffMs_ * 2);
+  nextAttemptAt_ = millis() + backoffMs_;
+  ZEN_LOGW("Wi-Fi retry in %lu ms", static_cast<unsigned long>(backoffMs_));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <WiFi.h>
+
+// Station connect with a fast path for known networks. After every
+// successful association the BSSID, channel and IP configuration are
+// stored; the next connect to the same SSID first tries a directed join on
+// that AP and channel (no scan), reusing the address instead of waiting for
+// DHCP while the lease is recent. If that fails within a short timeout it
+// falls back to a regular scan + DHCP. Failed attempts back off
+// exponentially between retries.
+class WifiLink {
+ public:
+  explicit WifiLink(Preferences& prefs) : prefs_(prefs) {}
+
+  // Loads the stored lease; call after prefs.begin().
+  void begin();
+  // Blocks until connected or all attempts timed out.
+  bool connect(const char* ssid, const char* password);
+  // False while backing off after a failed connect.
+  bool retryDue() const;
+  // Drops the stored lease, e.g. for new credentials or a factory reset.
+  void forget();
+
+ private:
+  struct Lease {
+    uint32_t ssidHash;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t valid;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t obtainedAt;  // epoch seconds, 0 if the clock was not set
+  };
+
+  bool waitConnected(uint32_t timeoutMs);
+  bool addressReusable() const;
+  void storeLease(const char* ssid);
+  void scheduleRetry();
+
+  Preferences& prefs_;
+  Lease lease_ = {};
+  uint32_t backoffMs_ = 0;
+  unsigned long nextAttemptAt_ = 0;
+};
@@ -0,0 +1,132 @@
+#include "zen_log.h"
+
+#if ZEN_LOG_LEVEL > ZEN_LOG_LEVEL_NONE
+
+#include <cstdarg>
+#include <cstdio>
+
+// "<level> <millis> <message>\n", cut to ZEN_LOG_LINE_MAX with the newline kept
+static size_t formatLine(char* line, char level, const char* format, va_list args) {
+  int prefix = snprintf(line, ZEN_LOG_LINE_MAX, "%c %lu ", level, static_cast<unsigned long>(millis()));
+  if (prefix < 0) return 0;
+  size_t len = static_cast<size_t>(prefix);
+  int body = vsnprintf(line + len, ZEN_LOG_LINE_MAX - len, format, args);
+  if (body > 0) len += static_cast<size_t>(body);
+  if (len > ZEN_LOG_LINE_MAX - 2) len = ZEN_LOG_LINE_MAX - 2;
+  line[len++] = '\n';
+  line[len] = '\0';
+  return len;
+}
+
+#if ZEN_LOG_ASYNC
+
+static constexpr size_t LOG_RING_BYTES = 4096;  // about 40 typical lines
+static constexpr uint32_t LOG_TASK_STACK = 2048;
+static constexpr UBaseType_t LOG_TASK_PRIORITY = 0;  // idle time only
+static constexpr size_t LOG_WRITE_CHUNK = 128;
+
+static char ring[LOG_RING_BYTES];
+static size_t ringHead = 0;  // next byte to write
+static size_t ringTail = 0;  // next byte to drain
+static uint32_t droppedLines = 0;
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t drainTask = nullptr;
+
+static size_t ringUsed() {
+  return (ringHead + LOG_RING_BYTES - ringTail) % LOG_RING_BYTES;
+}
+
+// Whole lines only, so a drop never leaves half a message in the output
+static void enqueue(const char* line, size_t len) {
+  portENTER_CRITICAL(&ringMux);
+  if (len < LOG_RING_BYTES - ringUsed()) {
+    for (size_t i = 0; i < len; ++i) {
+      ring[ringHead] = line[i];
+      ringHead = (ringHead + 1) % LOG_RING_BYTES;
+    }
+  } else {
+    ++droppedLines;
+  }
+  portEXIT_CRITICAL(&ringMux);
+  if (drainTask) xTaskNotifyGive(drainTask);
+}
+
+static void drain(void*) {
+  char chunk[LOG_WRITE_CHUNK];
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for (;;) {
+      size_t len = 0;
+      uint32_t dropped = 0;
+      portENTER_CRITICAL(&ringMux);
+      while (len < sizeof(chunk) && ringTail != ringHead) {
+        chunk[len++] = ring[ringTail];
+        ringTail = (ringTail + 1) % LOG_RING_BYTES;
+      }
+      if (len == 0) {
+        dropped = droppedLines;
+        droppedLines = 0;
+      }
+      portEXIT_CRITICAL(&ringMux);
+      if (len > 0) {
+        // The UART wait happens here, outside the lock and off the caller
+        Serial.write(reinterpret_cast<const uint8_t*>(chunk), len);
+        continue;
+      }
+      if (dropped > 0) {
+        char note[48];
+        int noteLen = snprintf(note, sizeof(note), "W %lu log: %lu lines dropped\n",
+                               static_cast<unsigned long>(millis()), static_cast<unsigned long>(dropped));
+        Serial.write(reinterpret_cast<const uint8_t*>(note), noteLen);
+      }
+      break;
+    }
+  }
+}
+
+void logBegin() {
+  if (drainTask) return;
+  xTaskCreate(drain, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, &drainTask);
+}
+
+void logFlush(uint32_t timeoutMs) {
+  unsigned long start = millis();
+  for (;;) {
+    portENTER_CRITICAL(&ringMux);
+    bool empty = ringTail == ringHead;
+    portEXIT_CRITICAL(&ringMux);
+    if (empty || millis() - start > timeoutMs) break;
+    delay(5);
+  }
+  Serial.flush();
+}
+
+void logWrite(char level, const char* format, ...) {
+  char line[ZEN_LOG_LINE_MAX];
+  va_list args;
+  va_start(args, format);
+  size_t len = formatLine(line, level, format, args);
+  va_end(args);
+  enqueue(line, len);
+}
+
+#else
+
+void logBegin() {}
+
+void logFlush(uint32_t) {
+  Serial.flush();
+}
+
+void logWrite(char level, const char* format, ...) {
+  char line[ZEN_LOG_LINE_MAX];
+  va_list args;
+  va_start(args, format);
+  size_t len = formatLine(line, level, format, args);
+  va_end(args);
+  Serial.write(reinterpret_cast<const uint8_t*>(line), len);
+}
+
+#endif  // ZEN_LOG_ASYNC
+
+#endif  // ZEN_LOG_LEVEL > ZEN_LOG_LEVEL_NONE
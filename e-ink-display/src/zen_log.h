@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Leveled serial logging.
+//
+//   ZEN_LOGE(...)  errors: something failed and was not retried
+//   ZEN_LOGW(...)  warnings: a failure that is retried or worked around
+//   ZEN_LOGI(...)  lifecycle: boot, connects, pairing, updates
+//   ZEN_LOGD(...)  per-fetch detail: HTTP codes, decoded fields
+//
+// Arguments are printf-style. Calls above ZEN_LOG_LEVEL compile to nothing,
+// arguments included, so a release build with -DZEN_LOG_LEVEL=0 carries no
+// logging code or format strings at all. Lines are formatted into a fixed
+// buffer on the caller's stack and cut at ZEN_LOG_LINE_MAX; logging never
+// touches the heap. Credentials, tokens and secrets are never logged at any
+// level.
+//
+// By default a line is written to Serial before the call returns, which at
+// 115200 baud costs about 87 us per character. With -DZEN_LOG_ASYNC=1 lines
+// go into a ring buffer instead and a low-priority task drains it to
+// Serial; callers then only pay for formatting. When the ring is full, new
+// lines are dropped and the number lost is reported once there is room.
+#define ZEN_LOG_LEVEL_NONE 0
+#define ZEN_LOG_LEVEL_ERROR 1
+#define ZEN_LOG_LEVEL_WARN 2
+#define ZEN_LOG_LEVEL_INFO 3
+#define ZEN_LOG_LEVEL_DEBUG 4
+
+#ifndef ZEN_LOG_LEVEL
+#define ZEN_LOG_LEVEL ZEN_LOG_LEVEL_INFO
+#endif
+
+#ifndef ZEN_LOG_ASYNC
+#define ZEN_LOG_ASYNC 0
+#endif
+
+static constexpr size_t ZEN_LOG_LINE_MAX = 160;
+
+#if ZEN_LOG_LEVEL > ZEN_LOG_LEVEL_NONE
+
+// Starts the drain task in async builds; call once after Serial.begin().
+void logBegin();
+// Blocks until queued lines have been written, e.g. before deep sleep or a
+// restart. Gives up after timeoutMs.
+void logFlush(uint32_t timeoutMs = 500);
+// Formats one line as "<level> <millis> <message>". Use the macros below.
+void logWrite(char level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+#else
+
+inline void logBegin() {}
+inline void logFlush(uint32_t = 500) {}
+
+#endif
+
+#if ZEN_LOG_LEVEL >= ZEN_LOG_LEVEL_ERROR
+#define ZEN_LOGE(...) logWrite('E', __VA_ARGS__)
+#else
+#define ZEN_LOGE(...) do {} while (0)
+#endif
+
+#if ZEN_LOG_LEVEL >= ZEN_LOG_LEVEL_WARN
+#define ZEN_LOGW(...) logWrite('W', __VA_ARGS__)
+#else
+#define ZEN_LOGW(...) do {} while (0)
+#endif
+
+#if ZEN_LOG_LEVEL >= ZEN_LOG_LEVEL_INFO
+#define ZEN_LOGI(...) logWrite('I', __VA_ARGS__)
+#else
+#define ZEN_LOGI(...) do {} while (0)
+#endif
+
+#if ZEN_LOG_LEVEL >= ZEN_LOG_LEVEL_DEBUG
+#define ZEN_LOGD(...) logWrite('D', __VA_ARGS__)
+#else
+#define ZEN_LOGD(...) do {} while (0)
+#endif
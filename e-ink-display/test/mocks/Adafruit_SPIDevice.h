@@ -0,0 +1,5 @@
+#pragma once
+
+// Adafruit_GFX.h includes the Adafruit BusIO headers for its OLED and
+// SPI TFT drivers. Those drivers are left out of the native build (see
+// test/native_env.py), so the headers only need to exist.
@@ -0,0 +1,182 @@
+#pragma once
+
+// Host stand-in for the Arduino core, covering what the state decoders,
+// text layout, ArduinoJson and Adafruit_GFX use in the native environment.
+// Only for `pio test -e native`; the firmware builds against the real core.
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t*>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t*>(addr))
+#define pgm_read_pointer(addr) (*reinterpret_cast<void* const*>(addr))
+
+class __FlashStringHelper;
+#define F(literal) (reinterpret_cast<const __FlashStringHelper*>(literal))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// glibc only gained these in 2.38
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t length = strlen(src);
+  if (size > 0) {
+    size_t n = length < size - 1 ? length : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return length;
+}
+
+inline size_t strlcat(char* dst, const char* src, size_t size) {
+  size_t used = strnlen(dst, size);
+  if (used == size) return size + strlen(src);
+  return used + strlcpy(dst + used, src, size - used);
+}
+#endif
+
+inline unsigned long millis() {
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return static_cast<unsigned long>(duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+inline unsigned long micros() {
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return static_cast<unsigned long>(duration_cast<microseconds>(steady_clock::now() - start).count());
+}
+
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+class String {
+ public:
+  String(const char* value = "") : value_(value ? value : "") {}
+  String(const std::string& value) : value_(value) {}
+
+  String& operator=(const char* value) {
+    value_ = value ? value : "";
+    return *this;
+  }
+  String& operator+=(const char* value) { return concat(value); }
+  String& operator+=(char value) { return concat(value); }
+  String& concat(const char* value) {
+    if (value) value_ += value;
+    return *this;
+  }
+  String& concat(char value) {
+    value_ += value;
+    return *this;
+  }
+  bool operator==(const char* other) const { return value_ == (other ? other : ""); }
+  bool operator!=(const char* other) const { return !(*this == other); }
+
+  const char* c_str() const { return value_.c_str(); }
+  unsigned int length() const { return static_cast<unsigned int>(value_.size()); }
+  bool isEmpty() const { return value_.empty(); }
+  bool startsWith(const char* prefix) const { return value_.compare(0, strlen(prefix), prefix) == 0; }
+  void reserve(unsigned int size) { value_.reserve(size); }
+
+ private:
+  std::string value_;
+};
+
+// ArduinoJson adapts this alongside String
+class StringSumHelper : public String {
+ public:
+  using String::String;
+};
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size--) written += write(*buffer++);
+    return written;
+  }
+  size_t write(const char* text) { return text ? write(reinterpret_cast<const uint8_t*>(text), strlen(text)) : 0; }
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(long value) { return printFormatted("%ld", value); }
+  size_t print(unsigned long value) { return printFormatted("%lu", value); }
+  size_t print(int value) { return print(static_cast<long>(value)); }
+  size_t print(unsigned int value) { return print(static_cast<unsigned long>(value)); }
+  size_t println() { return write("\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    return print(value) + println();
+  }
+
+ private:
+  template <typename T>
+  size_t printFormatted(const char* format, T value) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), format, value);
+    return write(buffer);
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeoutMs) { timeoutMs_ = timeoutMs; }
+
+  // Like the Arduino core: byte by byte through read(), waiting up to the
+  // timeout for each one
+  size_t readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = timedRead();
+      if (c < 0) break;
+      buffer[count++] = static_cast<char>(c);
+    }
+    return count;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes(reinterpret_cast<char*>(buffer), length); }
+
+ protected:
+  int timedRead() {
+    unsigned long start = millis();
+    do {
+      int c = read();
+      if (c >= 0) return c;
+    } while (millis() - start < timeoutMs_);
+    return -1;
+  }
+
+ private:
+  unsigned long timeoutMs_ = 0;  // mocks have all data up front
+};
+
+// Serial output goes to stdout so decoder diagnostics show up in test logs
+class HostSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() { fflush(stdout); }
+};
+
+inline HostSerial Serial;
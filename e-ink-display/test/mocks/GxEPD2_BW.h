@@ -0,0 +1,61 @@
+#pragma once
+
+// Host stand-in for the GxEPD2 panel: the colour constants the UI code uses
+// and a 296x128 1-bit frame in the rotated coordinates the draw functions
+// target, which is exactly what the firmware pushes to the panel.
+
+#include <Adafruit_GFX.h>
+
+#include <cstdio>
+
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+class MockEpdFrame : public GFXcanvas1 {
+ public:
+  static constexpr int16_t WIDTH = 296;
+  static constexpr int16_t HEIGHT = 128;
+  static constexpr size_t BYTES = ((WIDTH + 7) / 8) * HEIGHT;
+
+  MockEpdFrame() : GFXcanvas1(WIDTH, HEIGHT) {}
+
+  // Pixels that differ from `other`
+  size_t diff(const MockEpdFrame& other) const { return diffBuffer(other.getBuffer()); }
+
+  size_t diffBuffer(const uint8_t* other) const {
+    const uint8_t* mine = getBuffer();
+    size_t changed = 0;
+    for (size_t i = 0; i < BYTES; ++i) changed += __builtin_popcount(mine[i] ^ other[i]);
+    return changed;
+  }
+
+  size_t blackPixels() const {
+    const uint8_t* mine = getBuffer();
+    size_t black = 0;
+    for (size_t i = 0; i < BYTES; ++i) black += 8 - __builtin_popcount(mine[i]);
+    return black;
+  }
+
+  // Binary PBM (P4); the canvas stores white as 1, PBM stores black as 1
+  bool writePbm(const char* path) const {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    fprintf(file, "P4\n%d %d\n", WIDTH, HEIGHT);
+    const uint8_t* mine = getBuffer();
+    for (size_t i = 0; i < BYTES; ++i) fputc(static_cast<uint8_t>(~mine[i]), file);
+    return fclose(file) == 0;
+  }
+
+  // Loads a PBM written by writePbm() into `target` (BYTES long)
+  static bool readPbm(const char* path, uint8_t* target) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    int width = 0, height = 0;
+    bool ok = fscanf(file, "P4 %d %d", &width, &height) == 2 && width == WIDTH && height == HEIGHT &&
+              fgetc(file) != EOF && fread(target, 1, BYTES, file) == BYTES;
+    fclose(file);
+    if (!ok) return false;
+    for (size_t i = 0; i < BYTES; ++i) target[i] = static_cast<uint8_t>(~target[i]);
+    return true;
+  }
+};
@@ -0,0 +1,4 @@
+#pragma once
+
+// Print and Stream live in the host Arduino.h
+#include <Arduino.h>
@@ -0,0 +1,33 @@
+#pragma once
+
+// Response body as HTTPClient::getStream() hands it to the decoders: data
+// becomes available in segments, like TCP packets arriving on the socket,
+// and is consumed byte by byte through Stream::read().
+
+#include <Arduino.h>
+
+class MockHttpStream : public Stream {
+ public:
+  static constexpr size_t SEGMENT_BYTES = 1460;  // one Ethernet-sized TCP segment
+
+  MockHttpStream(const uint8_t* data, size_t size, size_t segment = SEGMENT_BYTES)
+      : data_(data), size_(size), segment_(segment ? segment : 1) {}
+
+  void rewind() { position_ = 0; }
+  size_t remaining() const { return size_ - position_; }
+
+  int available() override {
+    size_t segmentLeft = segment_ - position_ % segment_;
+    return static_cast<int>(remaining() < segmentLeft ? remaining() : segmentLeft);
+  }
+  int read() override { return position_ < size_ ? data_[position_++] : -1; }
+  int peek() override { return position_ < size_ ? data_[position_] : -1; }
+  size_t write(uint8_t) override { return 0; }
+  using Print::write;
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t segment_;
+  size_t position_ = 0;
+};
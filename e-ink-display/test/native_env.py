@@ -0,0 +1,9 @@
+"""Adjusts the native (host) build, see env:native in platformio.ini."""
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+# Only the drawing core of Adafruit GFX runs on the host. Its OLED and SPI TFT
+# drivers need Adafruit BusIO and real SPI/I2C, so they are dropped from the
+# library build.
+for pattern in ("*Adafruit_SPITFT.cpp", "*Adafruit_GrayOLED.cpp"):
+    env.AddBuildMiddleware(lambda node: None, pattern)  # noqa: F821
@@ -0,0 +1,102 @@
+#include "alloc_counter.h"
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+}
+
+namespace {
+
+// The benchmarks are single-threaded
+AllocStats stats = {};
+size_t live = 0;
+size_t base = 0;
+
+void noteAlloc(void* ptr, size_t requested) {
+  if (!ptr) return;
+  ++stats.count;
+  stats.bytes += requested;
+  live += malloc_usable_size(ptr);
+  if (live > base && live - base > stats.peak) stats.peak = live - base;
+}
+
+void noteFree(void* ptr) {
+  if (ptr) live -= malloc_usable_size(ptr);
+}
+
+}  // namespace
+
+void allocCounterReset() {
+  stats = {};
+  base = live;
+}
+
+AllocStats allocCounterRead() {
+  return stats;
+}
+
+extern "C" {
+
+void* __wrap_malloc(size_t size) {
+  void* ptr = __real_malloc(size);
+  noteAlloc(ptr, size);
+  return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  void* ptr = __real_calloc(count, size);
+  noteAlloc(ptr, count * size);
+  return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  // Sized before the call: the old block may be gone afterwards
+  size_t previous = ptr ? malloc_usable_size(ptr) : 0;
+  void* next = __real_realloc(ptr, size);
+  if (next) {
+    // A failed realloc leaves the old block in place
+    live -= previous;
+    noteAlloc(next, size);
+  }
+  return next;
+}
+
+void __wrap_free(void* ptr) {
+  noteFree(ptr);
+  __real_free(ptr);
+}
+
+}  // extern "C"
+
+void* operator new(size_t size) {
+  void* ptr = malloc(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  free(ptr);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Heap accounting for the benchmarks. malloc/calloc/realloc/free are
+// wrapped at link time (-Wl,--wrap, see the native env) and operator
+// new/delete are routed through them, so allocations made by ArduinoJson
+// and the firmware code are both counted.
+struct AllocStats {
+  size_t count;  // allocations, including reallocs
+  size_t bytes;  // bytes requested
+  size_t peak;   // highest live heap above the level at reset
+};
+
+// Starts a new measurement window
+void allocCounterReset();
+AllocStats allocCounterRead();
@@ -0,0 +1,392 @@
+// Host benchmarks for the state ingestion and render path. Replays the
+// recorded /devices/state responses in test/datasets through the same
+// decoders, text layout and draw functions the firmware runs, and reports
+// time, heap allocations and peak heap per stage. Rendered frames are
+// compared pixel by pixel with the goldens in test/golden.
+//
+//   pio test -e native -v
+//
+// Environment:
+//   ZEN_BENCH_DATASET        dataset file (default test/datasets/device_state.json)
+//   ZEN_BENCH_ITERATIONS     timed runs per stage and payload (default 200)
+//   ZEN_BENCH_UPDATE_GOLDEN  set to 1 to rewrite the goldens from this build
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <GxEPD2_BW.h>
+#include <unity.h>
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "device_state.h"
+#include "mock_http_stream.h"
+#include "text_layout.h"
+#include "ui.h"
+
+// -----------------------------------------------------------------------------
+// UI inputs read by the ui.cpp screens, sized like the globals in main.cpp
+// -----------------------------------------------------------------------------
+static char calHeader[64];
+static char calSelected[96];
+static char calSlot2[64];
+static char calSlot3[64];
+static char calLocation[48];
+static char mailSelected[64];
+static char mailSlot2[64];
+static char mailSlot3[64];
+static char mailSummary[192];
+static char mailLines[UI_SUMMARY_LINES][64];
+
+// Fixed clock so frames are reproducible
+static UiTexts texts = {
+    "12:34", "",  // clock, notice
+    calSelected, calSlot2, calSlot3, calLocation,
+    mailSelected, mailSlot2, mailSlot3,
+    mailLines[0], mailLines[1], mailLines[2], mailLines[3], mailLines[4], mailLines[5],
+};
+
+static const TextFont largeFont(nullptr, UI_TEXT_SIZE_LARGE);
+static const TextFont smallFont(nullptr, UI_TEXT_SIZE_SMALL);
+
+static const CalendarBoxes calendarBoxes = {
+    {calHeader, sizeof(calHeader)},
+    {{calSelected, sizeof(calSelected)}, {calSlot2, sizeof(calSlot2)}, {calSlot3, sizeof(calSlot3)}},
+    {calLocation, sizeof(calLocation)},
+};
+static const EmailBoxes emailBoxes = {
+    {{mailSelected, sizeof(mailSelected)}, {mailSlot2, sizeof(mailSlot2)}, {mailSlot3, sizeof(mailSlot3)}},
+    {mailSummary, sizeof(mailSummary)},
+    &mailLines[0][0], sizeof(mailLines[0]),
+};
+
+// -----------------------------------------------------------------------------
+// Dataset
+// -----------------------------------------------------------------------------
+static constexpr char DEFAULT_DATASET[] = "test/datasets/device_state.json";
+static constexpr char GOLDEN_DIR[] = "test/golden";
+static constexpr char OUTPUT_DIR[] = ".pio/bench";
+static constexpr int DEFAULT_ITERATIONS = 200;
+
+struct Payload {
+  std::string id;
+  std::string json;             // application/json body
+  std::vector<uint8_t> msgpack;  // the same state in compact schema 1
+};
+
+static std::vector<Payload> payloads;
+static int iterations = DEFAULT_ITERATIONS;
+
+static const char* envOr(const char* name, const char* fallback) {
+  const char* value = getenv(name);
+  return value && value[0] ? value : fallback;
+}
+
+// Encodes a state the way the backend's build_compact_state does
+static std::vector<uint8_t> compactMsgPack(JsonObjectConst state) {
+  DynamicJsonDocument doc(8192);
+  JsonArray root = doc.to<JsonArray>();
+  root.add(STATE_SCHEMA_VERSION);
+  JsonArray calendar = root.createNestedArray();
+  calendar.add(state["calendar"]["connected"] | false);
+  JsonArray events = calendar.createNestedArray();
+  for (JsonObjectConst item : state["calendar"]["items"].as<JsonArrayConst>()) {
+    JsonArray event = events.createNestedArray();
+    event.add(item["start"]);
+    event.add(item["summary"]);
+    event.add(item["location"]);
+    event.add(item["id"]);
+  }
+  JsonArray email = root.createNestedArray();
+  email.add(state["email"]["connected"] | false);
+  JsonArray mails = email.createNestedArray();
+  for (JsonObjectConst item : state["email"]["items"].as<JsonArrayConst>()) {
+    JsonArray mail = mails.createNestedArray();
+    mail.add(item["from"]);
+    mail.add(item["snippet"]);
+    mail.add(item["id"]);
+  }
+  const char* timezone = state["timezone"]["posix"] | "";
+  if (timezone[0] != '\0') root.add(timezone);
+  std::vector<uint8_t> encoded(measureMsgPack(doc));
+  serializeMsgPack(doc, encoded.data(), encoded.size());
+  return encoded;
+}
+
+static bool loadDataset(const char* path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::stringstream content;
+  content << file.rdbuf();
+  DynamicJsonDocument doc(65536);
+  if (deserializeJson(doc, content.str())) return false;
+  for (JsonObjectConst entry : doc["payloads"].as<JsonArrayConst>()) {
+    Payload payload;
+    payload.id = entry["id"] | "unnamed";
+    serializeJson(entry["state"], payload.json);
+    payload.msgpack = compactMsgPack(entry["state"]);
+    payloads.push_back(std::move(payload));
+  }
+  return !payloads.empty();
+}
+
+// -----------------------------------------------------------------------------
+// Measurement
+// -----------------------------------------------------------------------------
+struct Measurement {
+  double meanUs;
+  double minUs;
+  AllocStats heap;  // from the first, untimed run
+};
+
+template <typename TRun>
+static Measurement measure(TRun&& run) {
+  allocCounterReset();
+  run();
+  Measurement result = {0, 0, allocCounterRead()};
+  double best = 0;
+  double total = 0;
+  for (int i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    total += us;
+    if (i == 0 || us < best) best = us;
+  }
+  result.meanUs = total / iterations;
+  result.minUs = best;
+  return result;
+}
+
+static void report(const char* stage, const Payload& payload, size_t inputBytes, const Measurement& m) {
+  printf("[bench] %-14s %-18s %6zu B  mean %9.2f us  min %9.2f us  allocs %4zu  alloc %7zu B  peak %7zu B\n",
+         stage, payload.id.c_str(), inputBytes, m.meanUs, m.minUs, m.heap.count, m.heap.bytes, m.heap.peak);
+}
+
+// -----------------------------------------------------------------------------
+// Pipeline stages
+// -----------------------------------------------------------------------------
+// The firmware's item layout with the first item of each list selected.
+// Every dated event is shown: the recorded dates are fixed, so main.cpp's
+// "today" filter is left out.
+static void layoutSnapshot(const DeviceStateSnapshot& snapshot) {
+  uint8_t shown[STATE_MAX_EVENTS > STATE_MAX_MAILS ? STATE_MAX_EVENTS : STATE_MAX_MAILS];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < snapshot.events.count; ++i) {
+    if (snapshot.events.start(i)[0] != '\0') shown[count++] = i;
+  }
+  layoutCalendarWindow(largeFont, snapshot.events, shown, count, 0, calendarBoxes);
+
+  count = 0;
+  for (uint8_t i = 0; i < snapshot.mails.count; ++i) shown[count++] = i;
+  if (count > 0) layoutEmailWindow(largeFont, smallFont, snapshot.mails, shown, count, 0, emailBoxes);
+}
+
+static bool decodeMsgPack(const Payload& payload, DeviceStateSnapshot& table) {
+  MockHttpStream stream(payload.msgpack.data(), payload.msgpack.size());
+  table.clear();
+  return decodeStateMsgPack(stream, table);
+}
+
+// Compares a rendered frame with its golden; returns the differing pixels.
+// A missing golden counts as every pixel differing.
+static size_t checkGolden(const MockEpdFrame& frame, const Payload& payload, const char* mode) {
+  char name[160];
+  snprintf(name, sizeof(name), "%s/%s_%s.pbm", OUTPUT_DIR, payload.id.c_str(), mode);
+  frame.writePbm(name);
+
+  char golden[160];
+  snprintf(golden, sizeof(golden), "%s/%s_%s.pbm", GOLDEN_DIR, payload.id.c_str(), mode);
+  if (strcmp(envOr("ZEN_BENCH_UPDATE_GOLDEN", "0"), "1") == 0) {
+    mkdir(GOLDEN_DIR, 0755);
+    frame.writePbm(golden);
+    printf("[bench] golden written: %s\n", golden);
+    return 0;
+  }
+  static uint8_t expected[MockEpdFrame::BYTES];
+  if (!MockEpdFrame::readPbm(golden, expected)) {
+    printf("[bench] no golden for %s_%s, frame saved to %s; review it and rerun with "
+           "ZEN_BENCH_UPDATE_GOLDEN=1\n", payload.id.c_str(), mode, name);
+    return MockEpdFrame::WIDTH * MockEpdFrame::HEIGHT;
+  }
+  size_t diff = frame.diffBuffer(expected);
+  printf("[bench] pixels %-18s %-8s black %5zu  diff vs golden %5zu\n", payload.id.c_str(), mode,
+         frame.blackPixels(), diff);
+  return diff;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+void setUp() {}
+void tearDown() {}
+
+static void test_decoders_agree() {
+  for (const Payload& payload : payloads) {
+    static DeviceStateSnapshot fromJson;
+    static DeviceStateSnapshot fromMsgPack;
+    fromJson.clear();
+    TEST_ASSERT_TRUE_MESSAGE(decodeStateJson(String(payload.json), fromJson), payload.id.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(decodeMsgPack(payload, fromMsgPack), payload.id.c_str());
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(&fromJson, &fromMsgPack, sizeof(fromJson), payload.id.c_str());
+  }
+}
+
+// Synthetic state with `events` and `mails` items whose texts are `textLen`
+// characters long, so the list capacities and text pools are exercised
+static Payload syntheticPayload(const char* id, size_t events, size_t mails, size_t textLen) {
+  DynamicJsonDocument doc(65536);
+  std::string text(textLen, 'x');
+  JsonObject calendar = doc.createNestedObject("calendar");
+  calendar["connected"] = true;
+  JsonArray eventItems = calendar.createNestedArray("items");
+  for (size_t i = 0; i < events; ++i) {
+    JsonObject item = eventItems.createNestedObject();
+    item["id"] = "evt-" + std::to_string(i);
+    item["start"] = "2026-01-08T09:00:00+01:00";
+    item["summary"] = std::to_string(i) + text;
+    item["location"] = text;
+  }
+  JsonObject email = doc.createNestedObject("email");
+  email["connected"] = true;
+  JsonArray mailItems = email.createNestedArray("items");
+  for (size_t i = 0; i < mails; ++i) {
+    JsonObject item = mailItems.createNestedObject();
+    item["id"] = "msg-" + std::to_string(i);
+    item["from"] = std::to_string(i) + text;
+    item["snippet"] = text + text;
+  }
+  Payload payload;
+  payload.id = id;
+  serializeJson(doc, payload.json);
+  payload.msgpack = compactMsgPack(doc.as<JsonObjectConst>());
+  return payload;
+}
+
+static void test_item_store_limits() {
+  static DeviceStateSnapshot fromJson;
+  static DeviceStateSnapshot fromMsgPack;
+  // Short texts: the list capacities bound the store
+  Payload many = syntheticPayload("many_items", 20, 20, 8);
+  fromJson.clear();
+  TEST_ASSERT_TRUE(decodeStateJson(String(many.json), fromJson));
+  TEST_ASSERT_TRUE(decodeMsgPack(many, fromMsgPack));
+  TEST_ASSERT_EQUAL_MEMORY(&fromJson, &fromMsgPack, sizeof(fromJson));
+  TEST_ASSERT_EQUAL(STATE_MAX_EVENTS, fromJson.events.count);
+  TEST_ASSERT_EQUAL(STATE_MAX_MAILS, fromJson.mails.count);
+  TEST_ASSERT_EQUAL_STRING("15xxxxxxxx", fromJson.events.summary(15));
+
+  // Texts at full length: the pools bound it, never cutting an item short
+  Payload longest = syntheticPayload("longest_items", 20, 20, 250);
+  fromJson.clear();
+  TEST_ASSERT_TRUE(decodeStateJson(String(longest.json), fromJson));
+  TEST_ASSERT_TRUE(decodeMsgPack(longest, fromMsgPack));
+  TEST_ASSERT_EQUAL_MEMORY(&fromJson, &fromMsgPack, sizeof(fromJson));
+  TEST_ASSERT_EQUAL(STATE_EVENT_TEXT_BYTES / STATE_EVENT_TEXT_MAX, fromJson.events.count);
+  TEST_ASSERT_EQUAL(STATE_MAIL_TEXT_BYTES / STATE_MAIL_TEXT_MAX, fromJson.mails.count);
+  const uint8_t last = fromJson.mails.count - 1;
+  TEST_ASSERT_EQUAL(STATE_MAIL_FIELD_CAPACITY[MAIL_FROM] - 1, strlen(fromJson.mails.from(last)));
+  TEST_ASSERT_EQUAL(STATE_MAIL_FIELD_CAPACITY[MAIL_SNIPPET] - 1, strlen(fromJson.mails.snippet(last)));
+
+  // A delta keeps unchanged items from the table and rewrites the rest
+  Payload base = syntheticPayload("delta_base", 3, 2, 8);
+  fromJson.clear();
+  TEST_ASSERT_TRUE(decodeStateJson(String(base.json), fromJson));
+  strlcpy(fromJson.version, "v1", sizeof(fromJson.version));
+  const String delta(
+      "{\"base\":\"v1\",\"calendar\":{\"connected\":true,\"order\":[\"evt-2\",\"evt-0\"],"
+      "\"changed\":[{\"id\":\"evt-2\",\"start\":\"2026-01-08T10:00:00+01:00\",\"summary\":\"Moved\"}]},"
+      "\"email\":{\"connected\":true,\"order\":[\"msg-1\",\"msg-0\"],\"changed\":[]}}");
+  TEST_ASSERT_TRUE(decodeStateJson(delta, fromJson));
+  TEST_ASSERT_EQUAL(2, fromJson.events.count);
+  TEST_ASSERT_EQUAL_STRING("Moved", fromJson.events.summary(0));
+  TEST_ASSERT_EQUAL_STRING("0xxxxxxxx", fromJson.events.summary(1));
+  TEST_ASSERT_EQUAL_STRING("1xxxxxxxx", fromJson.mails.from(0));
+  TEST_ASSERT_EQUAL_STRING("0xxxxxxxx", fromJson.mails.from(1));
+}
+
+static void test_bench_decode_json() {
+  static DeviceStateSnapshot table;
+  for (const Payload& payload : payloads) {
+    const String body(payload.json);
+    report("json/string", payload, payload.json.size(), measure([&] {
+             table.clear();
+             decodeStateJson(body, table);
+           }));
+    MockHttpStream stream(reinterpret_cast<const uint8_t*>(payload.json.data()), payload.json.size());
+    report("json/stream", payload, payload.json.size(), measure([&] {
+             stream.rewind();
+             table.clear();
+             decodeStateJson(stream, table);
+           }));
+  }
+}
+
+static void test_bench_decode_msgpack() {
+  static DeviceStateSnapshot table;
+  for (const Payload& payload : payloads) {
+    Measurement m = measure([&] { decodeMsgPack(payload, table); });
+    report("msgpack/stream", payload, payload.msgpack.size(), m);
+    // The pull decoder writes straight into the table
+    TEST_ASSERT_EQUAL_MESSAGE(0, m.heap.count, payload.id.c_str());
+  }
+}
+
+static void test_bench_layout() {
+  static DeviceStateSnapshot table;
+  for (const Payload& payload : payloads) {
+    TEST_ASSERT_TRUE(decodeMsgPack(payload, table));
+    Measurement m = measure([&] { layoutSnapshot(table); });
+    report("layout", payload, 0, m);
+    TEST_ASSERT_EQUAL_MESSAGE(0, m.heap.count, payload.id.c_str());
+  }
+}
+
+static void test_bench_render() {
+  static DeviceStateSnapshot table;
+  static MockEpdFrame frame;
+  mkdir(".pio", 0755);
+  mkdir(OUTPUT_DIR, 0755);
+  size_t mismatched = 0;
+  for (const Payload& payload : payloads) {
+    TEST_ASSERT_TRUE(decodeMsgPack(payload, table));
+    layoutSnapshot(table);
+    Measurement calendar = measure([&] { drawScreen(frame, UI_CALENDAR_SCREEN, texts); });
+    report("draw/calendar", payload, 0, calendar);
+    TEST_ASSERT_EQUAL_MESSAGE(0, calendar.heap.count, payload.id.c_str());
+    mismatched += checkGolden(frame, payload, "calendar");
+
+    Measurement email = measure([&] { drawScreen(frame, UI_EMAIL_SCREEN, texts); });
+    report("draw/email", payload, 0, email);
+    TEST_ASSERT_EQUAL_MESSAGE(0, email.heap.count, payload.id.c_str());
+    mismatched += checkGolden(frame, payload, "email");
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(0, mismatched, "rendered frames differ from test/golden");
+}
+
+int main(int, char**) {
+  iterations = atoi(envOr("ZEN_BENCH_ITERATIONS", "0"));
+  if (iterations <= 0) iterations = DEFAULT_ITERATIONS;
+  const char* dataset = envOr("ZEN_BENCH_DATASET", DEFAULT_DATASET);
+  printf("[bench] dataset %s, %d iterations, DeviceStateSnapshot %zu B\n", dataset, iterations,
+         sizeof(DeviceStateSnapshot));
+
+  UNITY_BEGIN();
+  if (!loadDataset(dataset)) {
+    printf("[bench] cannot load %s\n", dataset);
+    return UNITY_END() + 1;
+  }
+  RUN_TEST(test_decoders_agree);
+  RUN_TEST(test_item_store_limits);
+  RUN_TEST(test_bench_decode_json);
+  RUN_TEST(test_bench_decode_msgpack);
+  RUN_TEST(test_bench_layout);
+  RUN_TEST(test_bench_render);
+  return UNITY_END();
+}
@@ -16,6 +16,44 @@ final Guid _credentialsCharUuid = Guid('7c2c2002-3e64-4d89-a6fb-01bd1e78b541');
 final Guid _pairingCharUuid = Guid('7c2c2003-3e64-4d89-a6fb-01bd1e78b541');
 final Guid _statusCharUuid = Guid('7c2c2004-3e64-4d89-a6fb-01bd1e78b541');
 
+// Status codes the display notifies on the status characteristic, see
+// ProvisioningStatus in e-ink-display/src/ble_provisioning.h
+const int _statusConnecting = 1;
+const int _statusWifiFailed = 3;
+const int _statusRegistered = 4;
+const int _statusWaitingForClaim = 5;
+const int _statusReady = 6;
+const int _statusRejected = 7;
+
+// Large enough for a whole credentials frame in one write
+const int _preferredMtu = 247;
+const int _credentialsFrameVersion = 1;
+const int _maxSsidBytes = 32;
+const int _maxPasswordBytes = 64;
+const int _maxBackendUrlBytes = 127;
+
+/// `version | len | SSID | len | password [| len | backend URL]`, one
+/// length byte per field.
+List<int> _credentialsFrame(String ssid, String password, String? backendUrl) {
+  final ssidBytes = utf8.encode(ssid);
+  final passwordBytes = utf8.encode(password);
+  if (ssidBytes.length > _maxSsidBytes) {
+    throw const FormatException('Wi-Fi name is longer than 32 bytes');
+  }
+  if (passwordBytes.length > _maxPasswordBytes) {
+    throw const FormatException('Wi-Fi password is longer than 64 bytes');
+  }
+  final frame = <int>[_credentialsFrameVersion, ssidBytes.length, ...ssidBytes, passwordBytes.length, ...passwordBytes];
+  final urlBytes = backendUrl == null ? const <int>[] : utf8.encode(backendUrl);
+  // The display only talks TLS; without a usable URL it keeps its own backend
+  if (backendUrl != null && backendUrl.startsWith('https://') && urlBytes.length <= _maxBackendUrlBytes) {
+    frame
+      ..add(urlBytes.length)
+      ..addAll(urlBytes);
+  }
+  return frame;
+}
+
 class DevicePairingScreen extends ConsumerStatefulWidget {
   const DevicePairingScreen({super.key, required this.session});
 
@@ -156,60 +194,66 @@ class _DevicePairingScreenState extends ConsumerState<DevicePairingScreen> {
         (char) => char.characteristicUuid == _statusCharUuid,
       );
 
-      // Send Wi-Fi credentials first
-      setState(() {
-        _statusMessage = 'Sending Wi-Fi credentials…';
-      });
-      final payload = utf8.encode('$ssid\n$password');
-      await credentialsChar.write(payload, withoutResponse: true);
-      
-      // Wait for device to connect to Wi-Fi and register (up to 15 seconds)
-      setState(() {
-        _statusMessage = 'Waiting for device to connect…';
-      });
-      
-      // Poll the status characteristic until the device reports it's
-      // waiting_for_claim or registered. Give the device ample time to
-      // complete Wi‑Fi connection and backend registration (up to 2 minutes).
-      String? currentStatus;
-      const int pollIntervalMs = 500;
-      const int maxWaitMs = 120000; // 2 minutes
-      final int start = DateTime.now().millisecondsSinceEpoch;
-      while (DateTime.now().millisecondsSinceEpoch - start < maxWaitMs) {
-        await Future<void>.delayed(const Duration(milliseconds: pollIntervalMs));
-        try {
-          final statusBytes = await statusChar.read();
-          currentStatus = utf8.decode(statusBytes, allowMalformed: true);
-          print('Device status poll: $currentStatus');
-          if (currentStatus.contains('registered') || currentStatus.contains('waiting_for_claim')) {
-            break;
-          }
-          // Update UI every few seconds so the user sees progress
-          if (mounted && ((DateTime.now().millisecondsSinceEpoch - start) % 5000) < pollIntervalMs) {
-            setState(() {
-              _statusMessage = 'Waiting for device to register (${((DateTime.now().millisecondsSinceEpoch - start)/1000).round()}s)…';
-            });
-          }
-        } catch (e) {
-          print('Status read error: $e');
+      if (Platform.isAndroid) {
+        // iOS negotiates the MTU on its own
+        await result.device.requestMtu(_preferredMtu);
+      }
+
+      // Subscribe before writing so no status change is missed. The display
+      // reports once it joined Wi-Fi and registered, or why it could not.
+      // A display that is already running keeps reporting on its old
+      // credentials until it takes the new ones, which it acknowledges with
+      // Connecting: until then only a rejected write is an answer.
+      final outcome = Completer<int>();
+      var accepted = false;
+      await statusChar.setNotifyValue(true);
+      final statusSubscription = statusChar.onValueReceived.listen((value) {
+        if (value.isEmpty || outcome.isCompleted) return;
+        final code = value.first;
+        print('Device status: $code');
+        if (code == _statusConnecting) {
+          accepted = true;
+        } else if (code == _statusRejected) {
+          outcome.complete(code);
+        } else if (accepted &&
+            (code == _statusRegistered ||
+                code == _statusWaitingForClaim ||
+                code == _statusReady ||
+                code == _statusWifiFailed)) {
+          outcome.complete(code);
         }
+      });
+
+      int? status;
+      try {
+        setState(() {
+          _statusMessage = 'Sending Wi-Fi credentials…';
+        });
+        final backendUrl = (await ref.read(backendConfigProvider.future)).baseUrl;
+        await credentialsChar.write(_credentialsFrame(ssid, password, backendUrl));
+
+        setState(() {
+          _statusMessage = 'Waiting for device to connect…';
+        });
+        // Joining Wi-Fi and registering with the backend can take a while
+        status = await outcome.future.timeout(const Duration(minutes: 2));
+      } on TimeoutException {
+        status = null;
+      } finally {
+        await statusSubscription.cancel();
       }
 
-      // If the device never reached a claimable state within our timeout,
-      // bail out gracefully without attempting to read the token or call
-      // the claim API. This avoids racing the backend registration.
-      if (currentStatus == null || !(currentStatus.contains('registered') || currentStatus.contains('waiting_for_claim'))) {
+      if (status != _statusRegistered && status != _statusWaitingForClaim && status != _statusReady) {
         if (mounted) {
           setState(() {
-            _statusMessage = 'Timed out waiting for device to become claimable. Please try again.';
+            _statusMessage = switch (status) {
+              _statusWifiFailed => 'The display could not join $ssid. Check the password and try again.',
+              _statusRejected => 'The display did not accept the Wi-Fi details. Please try again.',
+              _ => 'Timed out waiting for device to become claimable. Please try again.',
+            };
           });
         }
-        // Do not proceed to read pairing token or call claim; disconnect and return.
-        await result.device.disconnect();
-        setState(() {
-          _isPairing = false;
-        });
-        _startScan();
+        // Do not read the pairing token or call claim; finally disconnects
         return;
       }
 